@@ -40,6 +40,8 @@ SOURCES	+= main.cpp                         \
 		dcel/barcode_template.cpp           \
 		dcel/anchor.cpp                     \
 		dcel/arrangement_message.cpp               \
+		dcel/point_locator.cpp               \
+		dcel/flat_module_invariants.cpp     \
 		dcel/grades.cpp                     \
 		#math/persistence_updater.cpp        \
 		math/template_points_matrix.cpp          \
@@ -50,6 +52,8 @@ SOURCES	+= main.cpp                         \
 		interface/configuredialog.cpp       \
 		interface/config_parameters.cpp     \
 		interface/file_input_reader.cpp \
+		interface/file_tokenizer.cpp \
+		interface/binary_array.cpp \
         interface/file_writer.cpp \
         debug.cpp \
         timer.cpp \
@@ -76,6 +80,9 @@ HEADERS  += visualizationwindow.h			\
 		dcel/barcode.h	    				\
 		dcel/barcode_template.h				\
 		dcel/anchor.h						\
+		dcel/point_locator.h					\
+		dcel/arena.h						\
+		dcel/flat_module_invariants.h		\
 		dcel/grades.h                       \
 		math/persistence_updater.h			\
 		math/template_points_matrix.h			\
@@ -87,6 +94,8 @@ HEADERS  += visualizationwindow.h			\
     interface/configuredialog.h \
     interface/config_parameters.h \
     interface/file_input_reader.h \
+    interface/file_tokenizer.h \
+    interface/binary_array.h \
     #driver.h \
     interface/file_writer.h \
     interface/console_interaction.h \
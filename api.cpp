@@ -33,6 +33,7 @@ std::unique_ptr<ComputationResult> from_istream(std::istream &file) {
         pac.next(oh);
         auto m3 = oh.get();
 //        std::cout << "arrangement message" << std::endl;
+        ArrangementMessage::check_format(m3);
         m3.convert(arrangementMessage);
 
     } else {
@@ -61,13 +62,30 @@ std::vector<std::unique_ptr<Barcode>> query_barcodes(const ComputationResult &co
                                     const std::vector<std::pair<double, double>> &offset_slopes) {
 
     Grades grades(computation.arrangement->x_exact, computation.arrangement->y_exact);
-    std::vector<std::unique_ptr<Barcode>> result;
 
-    for (auto query : offset_slopes) {
-        auto angle = query.first;
-        auto offset = query.second;
-        auto templ = computation.arrangement->get_barcode_template(angle, offset);
-        result.push_back(templ.rescale(angle, offset, computation.template_points, grades));
+    //find the barcode template for every query in one sweep of the arrangement (no copies are made)
+    std::vector<const BarcodeTemplate*> templates = computation.arrangement->get_barcode_templates(offset_slopes);
+
+    //rescaling only reads the templates, so the queries can be rescaled in parallel
+    std::vector<std::unique_ptr<Barcode>> result(offset_slopes.size());
+#pragma omp parallel for schedule(dynamic, 64)
+    for (long i = 0; i < static_cast<long>(offset_slopes.size()); i++) {
+        auto angle = offset_slopes[i].first;
+        auto offset = offset_slopes[i].second;
+        result[i] = templates[i]->rescale(angle, offset, computation.template_points, grades);
+    }
+    return result;
+}
+
+std::vector<std::unique_ptr<Barcode>> query_barcodes(const FlatModuleInvariants &flat,
+                                    const std::vector<std::pair<double, double>> &offset_slopes) {
+
+    std::vector<unsigned> faces = flat.find_faces(offset_slopes);
+
+    std::vector<std::unique_ptr<Barcode>> result(offset_slopes.size());
+#pragma omp parallel for schedule(dynamic, 64)
+    for (long i = 0; i < static_cast<long>(offset_slopes.size()); i++) {
+        result[i] = flat.rescale(faces[i], offset_slopes[i].first, offset_slopes[i].second);
     }
     return result;
 }
@@ -85,3 +103,13 @@ Bounds compute_bounds(const ComputationResult &computation_result) {
             y_high
     };
 }
+
+Bounds compute_bounds(const FlatModuleInvariants &flat) {
+    const auto& grades = flat.get_grades();
+    return Bounds {
+            grades.x.front(),
+            grades.y.front(),
+            grades.x.back(),
+            grades.y.back()
+    };
+}
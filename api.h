@@ -17,15 +17,22 @@
 #include "computation.h"
 #include "dcel/dcel.h"
 #include "dcel/arrangement_message.h"
+#include "dcel/flat_module_invariants.h"
 #include <memory>
 
 std::unique_ptr<ComputationResult> from_messages(
         const TemplatePointsMessage &templatePointsMessage,
         const ArrangementMessage &arrangementMessage);
 
+//returns the barcode of each line, given as (angle, offset) pairs; the dual points of the lines are sorted once,
+//  and the point-location index is swept from left to right, so the whole batch is located in a single pass
 std::vector<std::unique_ptr<Barcode>> query_barcodes(const ComputationResult &computation,
                                                      const std::vector<std::pair<double, double>> &offset_slopes);
 
+//returns the barcode of each line, as above, reading the barcode templates in place from a flat module invariants file
+std::vector<std::unique_ptr<Barcode>> query_barcodes(const FlatModuleInvariants &flat,
+                                                     const std::vector<std::pair<double, double>> &offset_slopes);
+
 std::unique_ptr<ComputationResult> from_istream(std::istream &file);
 
 
@@ -38,4 +45,6 @@ struct Bounds {
 
 Bounds compute_bounds(const ComputationResult &computation_result);
 
+Bounds compute_bounds(const FlatModuleInvariants &flat);
+
 #endif //RIVET_CONSOLE_API_H
@@ -141,6 +141,7 @@ void ComputationThread::load_from_file(const std::string &file_name)
     emit templatePointsReady(message);
     pac.next(oh);
     auto m3 = oh.get();
+    ArrangementMessage::check_format(m3);
     m3.convert(*arrangement);
     emit arrangementReady(arrangement);
 }
@@ -30,6 +30,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <dcel/grades.h>
 
 #include "dcel/arrangement_message.h"
+#include "dcel/flat_module_invariants.h"
 #include "api.h"
 
 static const char USAGE[] =
@@ -46,17 +47,18 @@ static const char USAGE[] =
     Usage:
       rivet_console (-h | --help)
       rivet_console --version
-      rivet_console <input_file> --minpres [-H <hom_degree>] [-x <xbins>] [-y <ybins>]
+      rivet_console <input_file> --minpres [-H <hom_degree>] [-x <xbins>] [-y <ybins>] [--xquantiles] [--yquantiles]
                     [--datatype <datatype>] [--bifil <filtration>] [--function <function>]
-                    [--maxdist <distance>] [--xreverse] [--yreverse] [--num_threads <num_threads>]
-                    [-V <verbosity>] [--koszul]
-      rivet_console <input_file> [output_file] --betti [-H <hom_degree>] [-x <xbins>] [-y <ybins>]
+                    [--maxdist <distance>] [--landmarks <num_landmarks>] [--landmark_file <landmark_file>]
+                    [--xreverse] [--yreverse] [--num_threads <num_threads>] [-V <verbosity>] [--koszul]
+      rivet_console <input_file> [output_file] --betti [-H <hom_degree>] [-x <xbins>] [-y <ybins>] [--xquantiles] [--yquantiles]
                     [--datatype <datatype>] [--bifil <filtration>] [--function <function>]
-                    [--maxdist <distance>] [--xreverse] [--yreverse] [--num_threads <num_threads>]
-                    [-V <verbosity>] [--koszul]
-      rivet_console <input_file> <module_invariants_file> [-H <hom_degree>] [-x <xbins>] [-y <ybins>]
+                    [--maxdist <distance>] [--landmarks <num_landmarks>] [--landmark_file <landmark_file>]
+                    [--xreverse] [--yreverse] [--num_threads <num_threads>] [-V <verbosity>] [--koszul]
+      rivet_console <input_file> <module_invariants_file> [-H <hom_degree>] [-x <xbins>] [-y <ybins>] [--xquantiles] [--yquantiles]
                     [--datatype <datatype>] [--bifil <filtration>] [--function <function>]
-                    [--maxdist <distance>] [--xreverse] [--yreverse] [--xlabel <label>] [--ylabel <label>]
+                    [--maxdist <distance>] [--landmarks <num_landmarks>] [--landmark_file <landmark_file>]
+                    [--xreverse] [--yreverse] [--xlabel <label>] [--ylabel <label>]
                     [--num_threads <num_threads>] [-V <verbosity>] [--koszul] [-f <format>] [--binary]
       rivet_console <module_invariants_file> --barcodes <line_file> [-V <verbosity>]
       rivet_console <module_invariants_file> --bounds [-V <verbosity>]
@@ -64,7 +66,8 @@ static const char USAGE[] =
 
     Options:
       <input_file>                             A text file with suitably formatted point cloud, bifiltration, or
-                                               finite metric space as described at https://rivet.readthedocs.io/en/latest/inputdata.html
+                                               finite metric space as described at https://rivet.readthedocs.io/en/latest/inputdata.html,
+                                               or a binary (raw or .npy) file of point coordinates or distances
       <module_invariants_file>                 A module invariants file, as generated by this program by processing an
                                                <input_file>
       -h --help                                Show this screen.
@@ -77,11 +80,17 @@ static const char USAGE[] =
       -H <hom_degree> --homology <hom_degree>  Degree of homology to compute. (Default: 0)
       -x <xbins> --xbins <xbins>               Number of bins in the x direction. (Default: 0)
       -y <ybins> --ybins <ybins>               Number of bins in the y direction. (Default: 0)
+      --xquantiles                             Choose the bins in the x direction so that each holds about the same number
+                                               of values, instead of making them equally spaced.
+      --yquantiles                             Likewise for the bins in the y direction.
       --datatype <datatype>                    Type of the input file. (Default: points)
       --bifil <filtration>                     Specify the type of bifiltration to build.
                                                (Default: degree (if no function values specified) or function (if function values specified))
       --function <function>                    Specify the type of function values to be calculated from the dataset.
       --maxdist <distance>                     Maximum distance to be considered while building the Rips complex. (Default: Infinity)
+      --landmarks <num_landmarks>              Keep only this many points of a point cloud or metric space, chosen by
+                                               farthest-point sampling. (Default: 0, which keeps all points)
+      --landmark_file <landmark_file>          Write the indexes of the chosen landmarks to this file, in the order chosen.
       --xreverse                               Reverse the direction of the values in the x-axis.
       --yreverse                               Reverse the direction of the values in the y-axis.
       --xlabel <label>                         Name of the parameter displayed along the x-axis. (Default: degree (if no function values specified))
@@ -91,7 +100,9 @@ static const char USAGE[] =
       -k --koszul                              Use koszul homology-based algorithm to compute Betti numbers, instead of
                                                an approach based on computing presentations.
       --binary                                 Include binary data (used by RIVET viewer only)
-      -f <format> --format <format>            Output format for file. (Default: msgpack)
+      -f <format> --format <format>            Output format for file: msgpack, R0, or flat.  A flat file can be
+                                               memory-mapped and queried with --barcodes or --bounds without loading
+                                               the arrangement, but cannot be opened by the viewer. (Default: msgpack)
                                                
 
                                                
@@ -152,6 +163,18 @@ void write_msgpack_file(const std::string &file_name,
     file.flush();
 }
 
+void write_flat_file(const std::string &file_name,
+                     Arrangement const& arrangement,
+                     std::vector<TemplatePoint> const& template_points)
+{
+    std::ofstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open " + file_name + " for writing.");
+    }
+    FlatModuleInvariants::write(file, arrangement, template_points);
+    file.flush();
+}
+
 void write_template_points_file(const std::string &file_name,
                         TemplatePointsMessage const& message)
 {
@@ -202,21 +225,20 @@ void print_betti(TemplatePointsMessage const& message, std::ostream& ostream)
     }
 }
 
-void process_bounds(const ComputationResult &computation_result) {
-    auto bounds = compute_bounds(computation_result);
+void print_bounds(const Bounds &bounds) {
     std::cout << std::setprecision(12) << "low: " << bounds.x_low << ", " << bounds.y_low << std::endl;
     std::cout << std::setprecision(12) << "high: " << bounds.x_high << ", " << bounds.y_high << std::endl;
 }
 
-void process_barcode_queries(const std::string &query_file_name, const ComputationResult& computation_result)
+//reads the (angle, offset) pairs in the given query file; returns false if the file cannot be read
+bool read_barcode_queries(const std::string &query_file_name, std::vector<std::pair<double, double>> &queries)
 {
     std::ifstream query_file(query_file_name);
     if (!query_file.is_open()) {
         std::clog << "Could not open " << query_file_name << " for reading";
-        return;
+        return false;
     }
     std::string line;
-    std::vector<std::pair<double, double>> queries;
     int line_number = 0;
     while (std::getline(query_file, line)) {
         line_number++;
@@ -232,17 +254,20 @@ void process_barcode_queries(const std::string &query_file_name, const Computati
         if (iss >> angle >> offset) {
             if (angle < 0 || angle > 90) {
                 std::clog << "Angle on line " << line_number << " must be between 0 and 90" << std::endl;
-                return;
+                return false;
             }
 
             queries.emplace_back(angle, offset);
         } else {
             std::clog << "Parse error on line " << line_number << std::endl;
-            return;
+            return false;
         }
     }
+    return true;
+}
 
-    auto vec = query_barcodes(computation_result, queries);
+void print_barcodes(const std::vector<std::pair<double, double>> &queries, const std::vector<std::unique_ptr<Barcode>> &vec)
+{
     for(size_t i = 0; i < queries.size(); i++) {
         auto query = queries[i];
         auto angle = query.first;
@@ -267,6 +292,30 @@ void process_barcode_queries(const std::string &query_file_name, const Computati
     }
 }
 
+void process_bounds(const ComputationResult &computation_result) {
+    print_bounds(compute_bounds(computation_result));
+}
+
+void process_bounds(const FlatModuleInvariants &flat) {
+    print_bounds(compute_bounds(flat));
+}
+
+void process_barcode_queries(const std::string &query_file_name, const ComputationResult& computation_result)
+{
+    std::vector<std::pair<double, double>> queries;
+    if (read_barcode_queries(query_file_name, queries)) {
+        print_barcodes(queries, query_barcodes(computation_result, queries));
+    }
+}
+
+void process_barcode_queries(const std::string &query_file_name, const FlatModuleInvariants& flat)
+{
+    std::vector<std::pair<double, double>> queries;
+    if (read_barcode_queries(query_file_name, queries)) {
+        print_barcodes(queries, query_barcodes(flat, queries));
+    }
+}
+
 void input_error(std::string message) {
 
     std::cerr << "INPUT ERROR: " << message << " :END" << std::endl;
@@ -305,9 +354,13 @@ int main(int argc, char* argv[])
         params.outputFile = out_file_name.asString();
     }
 
-    InputManager inputManager(params);
-    // read in arguments supplied in the input file
-    inputManager.start();
+    //a flat module invariants file has no arguments to read, and is queried in place below
+    bool flat_input = FlatModuleInvariants::is_flat_file(params.fileName);
+    if (!flat_input) {
+        InputManager inputManager(params);
+        // read in arguments supplied in the input file
+        inputManager.start();
+    }
 
     bool barcodes = args["--barcodes"].isString();
 
@@ -320,6 +373,8 @@ int main(int argc, char* argv[])
     params.koszul = (args["--koszul"].isBool() && args["--koszul"].asBool()) || params.koszul;
     params.x_reverse = (args["--xreverse"].isBool() && args["--xreverse"].asBool()) || params.x_reverse;
     params.y_reverse = (args["--yreverse"].isBool() && args["--yreverse"].asBool()) || params.y_reverse;
+    params.x_quantiles = (args["--xquantiles"].isBool() && args["--xquantiles"].asBool()) || params.x_quantiles;
+    params.y_quantiles = (args["--yquantiles"].isBool() && args["--yquantiles"].asBool()) || params.y_quantiles;
 
     // these flags have arguments
     bool max_dist = args["--maxdist"].isString();
@@ -334,6 +389,8 @@ int main(int argc, char* argv[])
     bool x_label = args["--xlabel"].isString();
     bool y_label = args["--ylabel"].isString();
     bool fil = args["--function"].isString();
+    bool landmarks = args["--landmarks"].isString();
+    bool landmark_file = args["--landmark_file"].isString();
 
     // go through each flag that was set
     // error check
@@ -360,10 +417,24 @@ int main(int argc, char* argv[])
         }
     }
 
+    if (landmarks) {
+        int m = get_uint_or_die(args, "--landmarks");
+        if (m < 0)
+            throw std::runtime_error("Invalid argument for --landmarks");
+        params.num_landmarks = m;
+    }
+
+    if (landmark_file) {
+        params.landmark_file = args["--landmark_file"].asString();
+        if (params.landmark_file == "")
+            throw std::runtime_error("Invalid argument for --landmark_file");
+    }
+
     if (type) {
         std::string str = args["--datatype"].asString();
         if (str != "points" && str != "points_fn" && 
             str != "metric" && str != "metric_fn" && 
+            str != "points_binary" && str != "metric_binary" &&
             str != "bifiltration" && str != "firep" && str != "RIVET_msgpack")
             throw std::runtime_error("Invalid argument for --datatype");
         params.type = str;
@@ -410,7 +481,7 @@ int main(int argc, char* argv[])
 
     if (out_form) {
         std::string out = args["--format"].asString();
-        if (out != "R0" && out != "msgpack")
+        if (out != "R0" && out != "msgpack" && out != "flat")
             throw std::runtime_error("Invalid argument for --format");
         params.outputFormat = out;
     }
@@ -506,6 +577,22 @@ int main(int argc, char* argv[])
     bool bounds = params.bounds; 
     bool koszul = params.koszul;
 
+    if (flat_input) {
+        if (!(barcodes || bounds)) {
+            input_error("This function requires a data file, not a RIVET module invariants file.");
+            return 1;
+        }
+        FlatModuleInvariants flat(params.fileName);
+        if (barcodes) {
+            if (!slices.empty()) {
+                process_barcode_queries(slices, flat);
+            }
+        } else {
+            process_bounds(flat);
+        }
+        return 0;
+    }
+
     std::atexit(clean_temp_files);
     
     Progress progress;
@@ -650,6 +737,8 @@ int main(int argc, char* argv[])
                 fw.write_augmented_arrangement(file);
             } else if (params.outputFormat == "msgpack") {
                 write_msgpack_file(params.outputFile, params, *points_message, *arrangement_message);
+            } else if (params.outputFormat == "flat") {
+                write_flat_file(params.outputFile, *arrangement, content.result->template_points);
             } else {
                 throw std::runtime_error("Unsupported output format: " + params.outputFormat);
             }
@@ -0,0 +1,89 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+/**
+ * \class	Arena
+ * \brief	Stores DCEL objects in large contiguous blocks, instead of allocating each object separately.
+ *
+ * Objects created one after another are adjacent in memory, which keeps traversals of the arrangement cache-friendly.
+ * Pointers to stored objects remain valid until the Arena is destroyed; objects are never freed individually.
+ */
+
+#ifndef __DCEL_ARENA_H__
+#define __DCEL_ARENA_H__
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class Arena {
+public:
+    Arena()
+        : count(0)
+    {
+    }
+
+    ~Arena()
+    {
+        clear();
+    }
+
+    Arena(const Arena& other) = delete;
+    Arena& operator=(const Arena& other) = delete;
+
+    //constructs a new object in the arena, passing the arguments to its constructor, and returns a pointer to it
+    template <typename... Args>
+    T* create(Args&&... args)
+    {
+        if (count == blocks.size() * BLOCK_SIZE)
+            blocks.push_back(static_cast<T*>(::operator new(BLOCK_SIZE * sizeof(T))));
+
+        T* object = blocks.back() + (count % BLOCK_SIZE);
+        new (object) T(std::forward<Args>(args)...);
+        count++;
+        return object;
+    }
+
+    //destroys all objects in the arena and releases its memory
+    void clear()
+    {
+        for (size_t i = 0; i < count; i++)
+            blocks[i / BLOCK_SIZE][i % BLOCK_SIZE].~T();
+        for (auto block : blocks)
+            ::operator delete(block);
+        blocks.clear();
+        count = 0;
+    }
+
+    size_t size() const //returns the number of objects in the arena
+    {
+        return count;
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 4096; //number of objects per block
+
+    std::vector<T*> blocks; //storage for the objects; every block except the last is full
+    size_t count; //number of objects in the arena
+};
+
+#endif // __DCEL_ARENA_H__
@@ -29,8 +29,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <boost/graph/graph_traits.hpp>
 #include <boost/graph/kruskal_min_spanning_tree.hpp>
 
+#include <algorithm>
 #include <cfloat> // DBL_MAX and DBL_MIN
 #include <cmath> // std::nextafter
+#include <map>
+#include <utility> // std::move
 
 using rivet::numeric::INFTY;
 
@@ -65,15 +68,15 @@ Arrangement::Arrangement(std::vector<exact> xe,
     , verbosity(verbosity)
 {
     //create vertices
-    vertices.push_back(new Vertex(0, INFTY)); //index 0
-    vertices.push_back(new Vertex(INFTY, INFTY)); //index 1
-    vertices.push_back(new Vertex(INFTY, -INFTY)); //index 2
-    vertices.push_back(new Vertex(0, -INFTY)); //index 3
+    vertices.push_back(vertex_arena.create(0, INFTY)); //index 0
+    vertices.push_back(vertex_arena.create(INFTY, INFTY)); //index 1
+    vertices.push_back(vertex_arena.create(INFTY, -INFTY)); //index 2
+    vertices.push_back(vertex_arena.create(0, -INFTY)); //index 3
 
     //create halfedges
     for (int i = 0; i < 4; i++) {
-        halfedges.push_back(new Halfedge(vertices[i], nullptr)); //index 0, 2, 4, 6 (inside halfedges)
-        halfedges.push_back(new Halfedge(vertices[(i + 1) % 4], nullptr)); //index 1, 3, 5, 7 (outside halfedges)
+        halfedges.push_back(halfedge_arena.create(vertices[i], nullptr)); //index 0, 2, 4, 6 (inside halfedges)
+        halfedges.push_back(halfedge_arena.create(vertices[(i + 1) % 4], nullptr)); //index 1, 3, 5, 7 (outside halfedges)
         halfedges[2 * i]->set_twin(halfedges[2 * i + 1]);
         halfedges[2 * i + 1]->set_twin(halfedges[2 * i]);
     }
@@ -89,7 +92,7 @@ Arrangement::Arrangement(std::vector<exact> xe,
     }
 
     //create face
-    faces.push_back(new Face(halfedges[0], faces.size()));
+    faces.push_back(face_arena.create(halfedges[0], faces.size()));
 
     //set the remaining pointers on the halfedges
     for (int i = 0; i < 4; i++) {
@@ -104,20 +107,12 @@ Arrangement::Arrangement(std::vector<exact> xe,
     }
 } //end constructor
 
+//vertices, halfedges, and faces are destroyed with their arenas
 Arrangement::~Arrangement()
 {
-    for (auto face : faces) {
-        delete face;
-    }
-    for (auto halfedge : halfedges) {
-        delete halfedge;
-    }
     for (auto anchor : all_anchors) {
         delete anchor;
     }
-    for (auto vertex : vertices) {
-        delete vertex;
-    }
 }
 //inserts a new vertex on the specified edge, with the specified coordinates, and updates all relevant pointers
 //  i.e. new vertex is between initial and termainal points of the specified edge
@@ -125,7 +120,7 @@ Arrangement::~Arrangement()
 Halfedge* Arrangement::insert_vertex(Halfedge* edge, double x, double y)
 {
     //create new vertex
-    vertices.push_back(new Vertex(x, y));
+    vertices.push_back(vertex_arena.create(x, y));
     auto new_vertex = vertices.back();
 
     //get twin and Anchor of this edge
@@ -133,9 +128,9 @@ Halfedge* Arrangement::insert_vertex(Halfedge* edge, double x, double y)
     auto anchor = edge->get_anchor();
 
     //create new halfedges
-    halfedges.push_back(new Halfedge(new_vertex, anchor));
+    halfedges.push_back(halfedge_arena.create(new_vertex, anchor));
     auto up = halfedges.back();
-    halfedges.push_back(new Halfedge(new_vertex, anchor));
+    halfedges.push_back(halfedge_arena.create(new_vertex, anchor));
     auto dn = halfedges.back();
 
     //update pointers
@@ -172,13 +167,13 @@ Halfedge* Arrangement::create_edge_left(Halfedge* edge, Anchor* anchor)
 {
     //create new halfedges
     ; //points AWAY FROM left edge
-    halfedges.push_back(new Halfedge(edge->get_origin(), anchor));
+    halfedges.push_back(halfedge_arena.create(edge->get_origin(), anchor));
     auto new_edge = halfedges.back();
-    halfedges.push_back(new Halfedge(nullptr, anchor)); //points TOWARDS left edge
+    halfedges.push_back(halfedge_arena.create(nullptr, anchor)); //points TOWARDS left edge
     auto new_twin = halfedges.back();
 
     //create new face
-    faces.push_back(new Face(new_edge, faces.size()));
+    faces.push_back(face_arena.create(new_edge, faces.size()));
     auto new_face = faces.back();
 
     //update Halfedge pointers
@@ -203,9 +198,9 @@ Halfedge* Arrangement::create_edge_left(Halfedge* edge, Anchor* anchor)
 
 //returns barcode template associated with the specified line (point)
 //REQUIREMENT: 0 <= degrees <= 90
-BarcodeTemplate& Arrangement::get_barcode_template(double degrees, double offset)
+//  NOTE: for a sequence of nearby queries, a QueryCursor seeds the search with the cell found by the previous query
+const BarcodeTemplate& Arrangement::get_barcode_template(double degrees, double offset)
 {
-    ///TODO: store some point/cell to seed the next query
     Face* cell;
     if (degrees == 90) //then line is vertical
     {
@@ -233,29 +228,140 @@ BarcodeTemplate& Arrangement::get_barcode_template(double degrees, double offset
         double intercept = offset / cos(radians);
         cell = find_point(slope, -1 * intercept); //multiply by -1 for point-line duality
     }
-    ///TODO: REPLACE THIS WITH A SEEDED SEARCH
 
     return cell->get_barcode();
 } //end get_barcode_template()
 
+Arrangement::QueryCursor::QueryCursor(Arrangement& arrangement)
+    : arrangement(arrangement)
+    , cell(nullptr)
+    , x_coord(0)
+    , y_coord(0)
+{
+}
+
+//returns barcode template associated with the specified line (point)
+//REQUIREMENT: 0 <= degrees <= 90
+const BarcodeTemplate& Arrangement::QueryCursor::get_barcode_template(double degrees, double offset)
+{
+    //horizontal and vertical lines are found by binary search, so the previous cell does not help
+    if (degrees == 90 || degrees == 0)
+        return arrangement.get_barcode_template(degrees, offset);
+
+    //else: the line is neither horizontal nor vertical
+    double radians = degrees * 3.14159265 / 180;
+    double slope = tan(radians);
+    double intercept = offset / cos(radians);
+    return find_point(slope, -1 * intercept)->get_barcode(); //multiply by -1 for point-line duality
+} //end QueryCursor::get_barcode_template()
+
+//finds a 2-cell containing the specified point
+Face* Arrangement::QueryCursor::find_point(double x, double y)
+{
+    //walk from the previous cell, if any; if the walk gets long, use the point-location index instead
+    Face* found = nullptr;
+    if (cell != nullptr)
+        found = arrangement.walk_to_point(cell, x_coord, y_coord, x, y);
+    if (found == nullptr)
+        found = arrangement.find_point(x, y);
+
+    cell = found;
+    x_coord = x;
+    y_coord = y;
+    return cell;
+} //end QueryCursor::find_point()
+
+//returns pointers to the barcode templates associated with the specified lines, in the same order
+//REQUIREMENT: 0 <= degrees <= 90 for each line
+std::vector<const BarcodeTemplate*> Arrangement::get_barcode_templates(const std::vector<std::pair<double, double>>& lines)
+{
+    std::vector<const BarcodeTemplate*> templates(lines.size(), nullptr);
+
+    //compute dual points; horizontal and vertical lines are found directly by binary search
+    std::vector<std::pair<std::pair<double, double>, unsigned>> points; //dual point of each remaining line, with the index of the line
+    points.reserve(lines.size());
+    for (unsigned i = 0; i < lines.size(); i++) {
+        double degrees = lines[i].first;
+        double offset = lines[i].second;
+        if (degrees == 90 || degrees == 0) {
+            templates[i] = &get_barcode_template(degrees, offset);
+        } else {
+            double radians = degrees * 3.14159265 / 180;
+            double slope = tan(radians);
+            double intercept = offset / cos(radians);
+            points.push_back(std::make_pair(std::make_pair(slope, -1 * intercept), i)); //multiply by -1 for point-line duality
+        }
+    }
+
+    //sort the dual points from left to right, and from bottom to top for equal x-coordinates
+    std::sort(points.begin(), points.end());
+
+    //sweep the arrangement from left to right; without the point-location index, walk from each cell to the next
+    if (point_locator.is_valid()) {
+        std::vector<std::pair<double, double>> sorted_points;
+        sorted_points.reserve(points.size());
+        for (auto& point : points)
+            sorted_points.push_back(point.first);
+
+        std::vector<long> found = point_locator.find_faces(sorted_points);
+        for (unsigned k = 0; k < points.size(); k++)
+            templates[points[k].second] = &faces[found[k]]->get_barcode();
+    } else {
+        QueryCursor cursor(*this);
+        for (auto& point : points)
+            templates[point.second] = &cursor.find_point(point.first.first, point.first.second)->get_barcode();
+    }
+
+    return templates;
+} //end get_barcode_templates()
+
 //returns the barcode template associated with faces[i]
-BarcodeTemplate& Arrangement::get_barcode_template(unsigned i)
+const BarcodeTemplate& Arrangement::get_barcode_template(unsigned i)
 {
     return faces[i]->get_barcode();
 }
 
-//stores (a copy of) the given barcode template in faces[i]
-void Arrangement::set_barcode_template(unsigned i, BarcodeTemplate& bt)
+//stores the given barcode template in the pool and refers faces[i] to it
+void Arrangement::set_barcode_template(unsigned i, const BarcodeTemplate& bt)
 {
-    faces[i]->set_barcode(bt);
+    set_barcode_template(faces[i], bt);
 }
 
+//stores the given barcode template in the pool and refers the given face to it
+void Arrangement::set_barcode_template(Face* cell, const BarcodeTemplate& bt)
+{
+#pragma omp critical(barcode_template_pool)
+    {
+        unsigned id = template_pool.intern(bt);
+        cell->set_barcode(id, template_pool.get(id));
+    }
+}
+
+//the faces refer to the templates of the new pool, which replaces the old one
+void Arrangement::renumber_barcode_templates()
+{
+    BarcodeTemplatePool renumbered;
+    std::vector<unsigned> ids(faces.size());
+    for (unsigned i = 0; i < faces.size(); i++)
+        ids[i] = renumbered.intern(faces[i]->get_barcode());
+
+    template_pool = std::move(renumbered);
+    for (unsigned i = 0; i < faces.size(); i++)
+        faces[i]->set_barcode(ids[i], template_pool.get(ids[i]));
+} //end renumber_barcode_templates()
+
 //returns the number of 2-cells, and thus the number of barcode templates, in the arrangement
 unsigned Arrangement::num_faces()
 {
     return faces.size();
 }
 
+//returns the number of distinct barcode templates
+unsigned Arrangement::num_barcode_templates() const
+{
+    return template_pool.size();
+}
+
 //creates a new anchor in the vector all_anchors
 void Arrangement::add_anchor(Anchor anchor)
 {
@@ -333,6 +439,104 @@ Face* Arrangement::find_vertical_line(double x_coord)
 
 } //end find_vertical_line()
 
+//builds the point-location index from the lines of the arrangement and its interior vertices
+void Arrangement::build_point_locator()
+{
+    //lines are indexed by their order along the left edge of the arrangement, from bottom to top
+    std::vector<double> slopes;
+    std::vector<double> intercepts;
+    std::vector<long> below;
+    std::map<Anchor*, unsigned> line_index;
+    for (auto anchor : all_anchors) {
+        line_index[anchor] = slopes.size();
+        slopes.push_back(x_grades[anchor->get_x()]);
+        intercepts.push_back(y_grades[anchor->get_y()]);
+        below.push_back(anchor->get_line()->get_face()->id()); //the leftmost halfedge points right, so its face is below the line
+    }
+    point_locator.initialize(slopes, intercepts, below, topleft->get_twin()->get_face()->id());
+
+    //for each interior vertex, collect the lines through it and the faces below them to the right of the vertex
+    //  (interior vertices do not store an incident edge, so we find them as the origins of the halfedges that point to the right)
+    std::map<Vertex*, std::vector<std::pair<unsigned, long>>> crossings;
+    for (auto edge : halfedges) {
+        Vertex* origin = edge->get_origin();
+        if (edge->get_anchor() == nullptr || origin == nullptr || origin->get_x() <= 0 || origin->get_x() >= INFTY)
+            continue;
+        if (edge->get_twin()->get_origin()->get_x() > origin->get_x()) //then edge points right, so its face is below the line
+            crossings[origin].push_back(std::make_pair(line_index[edge->get_anchor()], edge->get_face()->id()));
+    }
+    for (auto& crossing : crossings) {
+        point_locator.add_crossing(crossing.first->get_x(), crossing.second);
+    }
+
+    point_locator.build();
+
+    if (verbosity >= 2 && !point_locator.is_valid()) {
+        debug() << "WARNING: point location index is inconsistent with the arrangement; queries will use the slower face walk";
+    }
+} //end build_point_locator()
+
+//walks along the segment from (x0, y0), which must be in the cell start, to (x1, y1)
+//  at each step, the walk leaves the current cell through the first boundary edge crossed by the segment;
+//  a point on a line belongs to the cell on its left, as in find_point()
+Face* Arrangement::walk_to_point(Face* start, double x0, double y0, double x1, double y1)
+{
+    Face* cell = start;
+    unsigned examined = 0;
+
+    while (true) {
+        Halfedge* boundary = cell->get_boundary();
+        if (boundary == nullptr)
+            return nullptr;
+
+        //find the boundary edge through which the segment leaves the cell
+        Halfedge* exit_edge = nullptr;
+        double exit_t = 0;
+        bool outside = false; //becomes true if the target point is on the far side of some boundary line
+
+        Halfedge* edge = boundary;
+        do {
+            if (++examined > MAX_WALK_EDGES)
+                return nullptr;
+
+            Anchor* anchor = edge->get_anchor();
+            if (anchor != nullptr) {
+                double slope = x_grades[anchor->get_x()];
+                double intercept = y_grades[anchor->get_y()];
+                double start_x = edge->get_origin()->get_x();
+                double end_x = edge->get_twin()->get_origin()->get_x();
+
+                //the cell is to the right of the halfedge, so it is below the line iff the halfedge points right
+                bool cell_below = end_x > start_x;
+                double target_height = y1 - (slope * x1 - intercept);
+                bool target_below = target_height < 0 || (target_height == 0 && slope <= 0);
+
+                if (cell_below != target_below) {
+                    outside = true;
+
+                    //find where the segment crosses the line, and check that the crossing is on this edge
+                    double start_height = y0 - (slope * x0 - intercept);
+                    double t = (start_height == target_height) ? 0 : start_height / (start_height - target_height);
+                    double cross_x = x0 + t * (x1 - x0);
+                    if (cross_x >= std::min(start_x, end_x) && cross_x <= std::max(start_x, end_x)
+                        && (exit_edge == nullptr || t < exit_t)) {
+                        exit_edge = edge;
+                        exit_t = t;
+                    }
+                }
+            }
+            edge = edge->get_next();
+        } while (edge != boundary);
+
+        if (!outside) //then the target point is in this cell
+            return cell;
+        if (exit_edge == nullptr) //then rounding error hides the exit, so give up
+            return nullptr;
+
+        cell = exit_edge->get_twin()->get_face();
+    }
+} //end walk_to_point()
+
 void Arrangement::announce_next_point(Halfedge* finger, Vertex* next_pt)
 {
 
@@ -347,7 +551,16 @@ void Arrangement::announce_next_point(Halfedge* finger, Vertex* next_pt)
 //find a 2-cell containing the specified point
 Face* Arrangement::find_point(double x_coord, double y_coord)
 {
-    //start on the left edge of the arrangement, at the correct y-coordinate
+    //if the slab decomposition is available, then use it to find the cell in logarithmic time
+    if (point_locator.is_valid()) {
+        Face* cell = faces[point_locator.find_face(x_coord, y_coord)];
+        if (verbosity >= 10) {
+            debug() << "  Point location index found cell " << FID(cell);
+        }
+        return cell;
+    }
+
+    //otherwise, start on the left edge of the arrangement, at the correct y-coordinate
     auto start = find_least_upper_anchor(-1 * y_coord);
 
     Halfedge* finger = nullptr; //for use in finding the cell
@@ -446,7 +659,7 @@ Face* Arrangement::find_point(double x_coord, double y_coord)
 //prints a summary of the arrangement information, such as the number of anchors, vertices, halfedges, and faces
 void Arrangement::print_stats()
 {
-    debug() << "The arrangement contains: " << all_anchors.size() << " anchors, " << vertices.size() << " vertices, " << halfedges.size() << " halfedges, and " << faces.size() << " faces";
+    debug() << "The arrangement contains: " << all_anchors.size() << " anchors, " << vertices.size() << " vertices, " << halfedges.size() << " halfedges, and " << faces.size() << " faces, with " << template_pool.size() << " distinct barcode templates";
 }
 
 //print all the data from the arrangement
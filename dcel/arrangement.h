@@ -37,9 +37,12 @@ class PersistenceUpdater;
 class Vertex;
 
 #include "anchor.h"
+#include "arena.h"
+#include "barcode_template.h"
 #include "interface/progress.h"
 #include "math/template_point.h"
 #include "numerics.h"
+#include "point_locator.h"
 #include "pointer_comparator.h"
 #include <boost/numeric/interval.hpp>
 #include <set>
@@ -52,6 +55,7 @@ class Arrangement {
     friend class PersistenceUpdater;
     friend class ArrangementBuilder;
     friend class ArrangementMessage;
+    friend class FlatModuleInvariants;
     friend Arrangement to_arrangement(ArrangementMessage const& msg);
 
 public:
@@ -66,14 +70,40 @@ public:
     Arrangement(const Arrangement& that) = delete;
 
     //returns barcode template associated with the specified line (point)
-    BarcodeTemplate& get_barcode_template(double degrees, double offset);
+    const BarcodeTemplate& get_barcode_template(double degrees, double offset);
 
     //returns the barcode template associated with faces[i]
-    BarcodeTemplate& get_barcode_template(unsigned i);
+    const BarcodeTemplate& get_barcode_template(unsigned i);
+
+    //returns pointers to the barcode templates associated with the specified lines, given as (degrees, offset) pairs, in the same order
+    //  the dual points are sorted from left to right and located in a single sweep of the arrangement
+    std::vector<const BarcodeTemplate*> get_barcode_templates(const std::vector<std::pair<double, double>>& lines);
+
+    //answers a sequence of queries by walking from the cell found by the previous query;
+    //  intended for nearby queries, such as a sweep of slowly-varying lines, and falls back to find_point() when the walk gets long
+    class QueryCursor {
+    public:
+        QueryCursor(Arrangement& arrangement);
+
+        //returns barcode template associated with the specified line (point), as Arrangement::get_barcode_template()
+        const BarcodeTemplate& get_barcode_template(double degrees, double offset);
+
+        //finds a 2-cell containing the specified point, as Arrangement::find_point()
+        Face* find_point(double x, double y);
+
+    private:
+        Arrangement& arrangement;
+        Face* cell; //cell containing the previous query point, or nullptr if there is no previous query
+        double x_coord; //x-coordinate of the previous query point
+        double y_coord; //y-coordinate of the previous query point
+    };
 
     //returns the number of 2-cells, and thus the number of barcode templates, in the arrangement
     unsigned num_faces();
 
+    //returns the number of distinct barcode templates, which are shared between cells
+    unsigned num_barcode_templates() const;
+
     //creates a new anchor in the vector all_anchors
     void add_anchor(Anchor anchor);
 
@@ -98,6 +128,11 @@ private:
     std::vector<Halfedge*> halfedges; //all halfedges in the arrangement
     std::vector<Face*> faces; //all faces in the arrangement
 
+    //contiguous storage for the objects listed in vertices, halfedges, and faces; the arrangement owns these objects
+    Arena<Vertex> vertex_arena;
+    Arena<Halfedge> halfedge_arena;
+    Arena<Face> face_arena;
+
     unsigned verbosity;
 
     //set of Anchors that are represented in the arrangement, ordered by position of curve along left side of the arrangement, from bottom to top
@@ -111,6 +146,12 @@ private:
     //stores a pointer to the rightmost Halfedge of the "top" line of each unique slope, ordered from small slopes to big slopes (each Halfedge points to Anchor and Face for vertical-line queries)
     std::vector<Halfedge*> vertical_line_query_list;
 
+    //slab decomposition of the arrangement, used by find_point()
+    PointLocator point_locator;
+
+    //distinct barcode templates; each face refers to one of these
+    BarcodeTemplatePool template_pool;
+
     ///// functions for creating the arrangement /////
 
     //creates the first pair of Halfedges in an anchor line, anchored on the left edge of the strip
@@ -125,8 +166,18 @@ private:
     //builds the path recursively
     void find_subpath(unsigned cur_node, std::vector<std::vector<unsigned>>& adj, std::vector<Halfedge*>& pathvec, bool return_path);
 
-    //stores (a copy of) the given barcode template in faces[i]; used for re-building the arrangement from a RIVET data file
-    void set_barcode_template(unsigned i, BarcodeTemplate& bt);
+    //builds the point-location index; must be called once the interior of the arrangement is complete
+    void build_point_locator();
+
+    //stores the given barcode template in the pool (if it is not there already) and refers faces[i] to it; used for re-building the arrangement from a RIVET data file
+    void set_barcode_template(unsigned i, const BarcodeTemplate& bt);
+
+    //as above, for the given face; may be called concurrently
+    void set_barcode_template(Face* cell, const BarcodeTemplate& bt);
+
+    //numbers the barcode templates in order of their first appearance in faces, so that the IDs do not depend on
+    //  the order in which concurrent workers stored them; templates that no face refers to are dropped
+    void renumber_barcode_templates();
 
     ///// functions for searching the arrangement /////
 
@@ -140,6 +191,13 @@ private:
     //finds a 2-cell containing the specified point
     Face* find_point(double x_coord, double y_coord);
 
+    //maximum number of halfedges examined by walk_to_point() before giving up
+    static const unsigned MAX_WALK_EDGES = 64;
+
+    //walks along the segment from (x0, y0), which must be in the cell start, to (x1, y1)
+    //  returns the 2-cell containing (x1, y1), or nullptr if the walk examines more than MAX_WALK_EDGES halfedges
+    Face* walk_to_point(Face* start, double x0, double y0, double x1, double y1);
+
     ///// functions for testing /////
 
     long HID(Halfedge* h) const; //halfedge ID, for printing and debugging
@@ -274,7 +274,7 @@ void ArrangementBuilder::build_interior(Arrangement& arrangement)
         }
 
         //create new vertex
-        auto new_vertex = new Vertex(intersect_x, intersect_y);
+        auto new_vertex = arrangement.vertex_arena.create(intersect_x, intersect_y);
         arrangement.vertices.push_back(new_vertex);
 
         //anchor edges to vertex and create new face(s) and edges	//TODO: check this!!!
@@ -287,9 +287,9 @@ void ArrangementBuilder::build_interior(Arrangement& arrangement)
             incoming->get_twin()->set_origin(new_vertex);
 
             //create next pair of twin halfedges along the current curve (i.e. curves[incident_edges[i]] )
-            auto new_edge = new Halfedge(new_vertex, incoming->get_anchor()); //points AWAY FROM new_vertex
+            auto new_edge = arrangement.halfedge_arena.create(new_vertex, incoming->get_anchor()); //points AWAY FROM new_vertex
             arrangement.halfedges.push_back(new_edge);
-            auto new_twin = new Halfedge(NULL, incoming->get_anchor()); //points TOWARDS new_vertex
+            auto new_twin = arrangement.halfedge_arena.create(nullptr, incoming->get_anchor()); //points TOWARDS new_vertex
             arrangement.halfedges.push_back(new_twin);
 
             //update halfedge pointers
@@ -307,7 +307,7 @@ void ArrangementBuilder::build_interior(Arrangement& arrangement)
                 incoming->set_next(prev_incoming->get_twin());
                 incoming->get_next()->set_prev(incoming);
 
-                auto new_face = new Face(new_twin, arrangement.faces.size());
+                auto new_face = arrangement.face_arena.create(new_twin, arrangement.faces.size());
                 arrangement.faces.push_back(new_face);
 
                 new_twin->set_face(new_face);
@@ -430,6 +430,12 @@ void ArrangementBuilder::build_interior(Arrangement& arrangement)
         rightedge->get_twin()->set_face(incoming->get_twin()->get_face());
     }
 
+    // PART 4: BUILD THE POINT-LOCATION INDEX USED FOR BARCODE QUERIES
+    if (verbosity >= 8) {
+        debug() << "PART 4: POINT-LOCATION INDEX";
+    }
+    arrangement.build_point_locator();
+
 } //end build_interior()
 
 //computes and stores the edge weight for each anchor line
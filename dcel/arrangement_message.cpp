@@ -40,7 +40,8 @@ struct Ptr_Compare {
 };
 
 ArrangementMessage::ArrangementMessage(Arrangement const& arrangement)
-    : x_grades(arrangement.x_grades)
+    : format_version(FORMAT_VERSION)
+    , x_grades(arrangement.x_grades)
     , y_grades(arrangement.y_grades)
     , x_exact(arrangement.x_exact)
     , y_exact(arrangement.y_exact)
@@ -49,6 +50,7 @@ ArrangementMessage::ArrangementMessage(Arrangement const& arrangement)
     , vertices()
     , anchors()
     , faces()
+    , barcode_templates()
 {
     std::map<const Face*, long, Ptr_Compare<Face>> face_map;
     std::map<const Halfedge*, long, Ptr_Compare<Halfedge>> halfedge_map;
@@ -94,7 +96,10 @@ ArrangementMessage::ArrangementMessage(Arrangement const& arrangement)
     //build data structures
 
     for (auto face : arrangement.faces) {
-        faces.push_back(FaceM{ HalfedgeId(HID(face->get_boundary())), face->get_barcode() });
+        faces.push_back(FaceM{ HalfedgeId(HID(face->get_boundary())), face->get_barcode_id() });
+    }
+    for (unsigned i = 0; i < arrangement.template_pool.size(); i++) {
+        barcode_templates.push_back(arrangement.template_pool.get(i));
     }
     for (auto half : arrangement.halfedges) {
         half_edges.push_back(HalfedgeM{
@@ -133,7 +138,8 @@ ArrangementMessage::ArrangementMessage(Arrangement const& arrangement)
 }
 
 ArrangementMessage::ArrangementMessage()
-    : x_grades()
+    : format_version(FORMAT_VERSION)
+    , x_grades()
     , y_grades()
     , topleft()
     , topright()
@@ -144,9 +150,24 @@ ArrangementMessage::ArrangementMessage()
     , vertices()
     , anchors()
     , faces()
+    , barcode_templates()
 {
 }
 
+//files written before the format version was introduced start the arrangement with the array of x-grades
+void ArrangementMessage::check_format(const msgpack::object& obj)
+{
+    if (obj.type != msgpack::type::ARRAY || obj.via.array.size == 0)
+        throw std::runtime_error("Could not process arrangement section, bad encoding?");
+
+    const msgpack::object& version = obj.via.array.ptr[0];
+    if (version.type != msgpack::type::POSITIVE_INTEGER || version.via.u64 < FORMAT_VERSION)
+        throw std::runtime_error("This module invariants file was written by an older version of RIVET and can no longer be read; please recompute it.");
+    if (version.via.u64 > FORMAT_VERSION)
+        throw std::runtime_error("This module invariants file was written by a newer version of RIVET (format version "
+            + std::to_string(version.via.u64) + ", expected " + std::to_string(FORMAT_VERSION) + ").");
+} //end check_format()
+
 //finds the first anchor that intersects the left edge of the arrangement at a point not less than the specified y-coordinate
 //  if no such anchor, returns nullptr
 boost::optional<ArrangementMessage::AnchorM> ArrangementMessage::find_least_upper_anchor(double y_coord)
@@ -216,10 +237,50 @@ ArrangementMessage::FaceId ArrangementMessage::find_vertical_line(double x_coord
 
 } //end find_vertical_line()
 
+//builds point_locator from the halfedges and vertices of the arrangement
+//  lines are indexed by their order along the left edge of the arrangement, which is the order of the vector anchors
+void ArrangementMessage::build_point_locator()
+{
+    std::vector<double> slopes;
+    std::vector<double> intercepts;
+    std::vector<long> below;
+    for (auto& anchor : anchors) {
+        slopes.push_back(x_grades[anchor.x_coord]);
+        intercepts.push_back(y_grades[anchor.y_coord]);
+        below.push_back(static_cast<long>(get(anchor.dual_line).face));
+    }
+    point_locator.initialize(slopes, intercepts, below, static_cast<long>(get(get(topleft).twin).face));
+
+    //for each interior vertex, collect the lines through it and the faces below them to the right of the vertex
+    //  (interior vertices do not store an incident edge, so we find them as the origins of the halfedges that point to the right)
+    std::vector<std::vector<std::pair<unsigned, long>>> crossings(vertices.size());
+    for (auto& half : half_edges) {
+        if (half.anchor == AnchorId::invalid() || half.origin == VertexId::invalid())
+            continue;
+        VertexM& origin = get(half.origin);
+        if (origin.x <= 0 || origin.x >= rivet::numeric::INFTY)
+            continue;
+        if (get(get(half.twin).origin).x > origin.x) //then the halfedge points right, so its face is below the line
+            crossings[static_cast<long>(half.origin)].push_back(std::make_pair(static_cast<unsigned>(static_cast<long>(half.anchor)), static_cast<long>(half.face)));
+    }
+    for (size_t i = 0; i < vertices.size(); i++) {
+        if (!crossings[i].empty())
+            point_locator.add_crossing(vertices[i].x, crossings[i]);
+    }
+
+    point_locator.build();
+} //end build_point_locator()
+
 ////find a 2-cell containing the specified point
 ArrangementMessage::FaceId ArrangementMessage::find_point(double x_coord, double y_coord)
 {
-    //start on the left edge of the arrangement, at the correct y-coordinate
+    //if the slab decomposition is available, then use it to find the cell in logarithmic time
+    if (!point_locator.is_built())
+        build_point_locator();
+    if (point_locator.is_valid())
+        return FaceId(point_locator.find_face(x_coord, y_coord));
+
+    //otherwise, start on the left edge of the arrangement, at the correct y-coordinate
     boost::optional<AnchorM> start = find_least_upper_anchor(-1 * y_coord);
 
     HalfedgeId finger; //for use in finding the cell
@@ -334,7 +395,7 @@ BarcodeTemplate ArrangementMessage::get_barcode_template(double degrees, double
     }
     ///TODO: REPLACE THIS WITH A SEEDED SEARCH
 
-    return get(cell).dbc;
+    return barcode_templates[get(cell).dbc];
 } //end get_barcode_template()
 
 bool check(bool condition, std::string message)
@@ -394,6 +455,8 @@ bool operator==(ArrangementMessage const& left, ArrangementMessage const& right)
         return false;
     if (!check(left.faces == right.faces, "faces"))
         return false;
+    if (!check(left.barcode_templates == right.barcode_templates, "barcode templates"))
+        return false;
     if (!check(left.half_edges == right.half_edges, "edges"))
         return false;
     if (!check(left.x_grades == right.x_grades, "x_grades"))
@@ -409,13 +472,13 @@ Arrangement* ArrangementMessage::to_arrangement() const
     Arrangement* arrangement = new Arrangement();
     //First create all the objects
     for (auto vertex : vertices) {
-        arrangement->vertices.push_back(new ::Vertex(vertex.x, vertex.y));
+        arrangement->vertices.push_back(arrangement->vertex_arena.create(vertex.x, vertex.y));
     }
     for (size_t i = 0; i < faces.size(); i++) {
-        arrangement->faces.push_back(new ::Face(nullptr, i));
+        arrangement->faces.push_back(arrangement->face_arena.create(nullptr, i));
     }
     for (size_t i = 0; i < half_edges.size(); i++) {
-        arrangement->halfedges.push_back(new ::Halfedge());
+        arrangement->halfedges.push_back(arrangement->halfedge_arena.create());
     }
     std::vector<::Anchor*> temp_anchors; //For indexing, since arrangement.all_anchors is a set
     for (auto anchor : anchors) {
@@ -455,7 +518,7 @@ Arrangement* ArrangementMessage::to_arrangement() const
         if (faces[i].boundary != HalfedgeId::invalid()) {
             mface->set_boundary(arrangement->halfedges[static_cast<long>(face.boundary)]);
         }
-        mface->set_barcode(face.dbc);
+        arrangement->set_barcode_template(mface, barcode_templates.at(face.dbc));
     }
     for (size_t i = 0; i < half_edges.size(); i++) {
         ::Halfedge& edge = *(arrangement->halfedges[i]);
@@ -516,6 +579,8 @@ Arrangement* ArrangementMessage::to_arrangement() const
     arrangement->x_grades = x_grades;
     arrangement->y_grades = y_grades;
 
+    arrangement->build_point_locator();
+
     it = arrangement->all_anchors.begin();
     for (size_t i = 0; i < anchors.size(); i++) {
         assert(anchors[i].x_coord == temp_anchors[i]->get_x());
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "dcel/barcode_template.h"
 #include "dcel/dcel.h"
 #include "dcel/msgpack_adapters.h"
+#include "dcel/point_locator.h"
 #include "type_tag.h"
 #include <boost/optional.hpp>
 #include <boost/serialization/split_member.hpp>
@@ -40,7 +41,14 @@ public:
 
     ArrangementMessage();
 
-    MSGPACK_DEFINE(x_grades, y_grades, x_exact, y_exact, half_edges, vertices, anchors, faces, topleft, topright, bottomleft, bottomright, vertical_line_query_list);
+    //version of the serialized layout, written first so that files from older versions of RIVET can be recognized;
+    //  increment it whenever the packed fields change
+    static const unsigned FORMAT_VERSION = 2;
+
+    //throws std::runtime_error if obj is not an arrangement packed in the current format
+    static void check_format(const msgpack::object& obj);
+
+    MSGPACK_DEFINE(format_version, x_grades, y_grades, x_exact, y_exact, half_edges, vertices, anchors, faces, topleft, topright, bottomleft, bottomright, vertical_line_query_list, barcode_templates);
 
     BarcodeTemplate get_barcode_template(double degrees, double offset);
 
@@ -58,6 +66,8 @@ private:
     typedef ID<Face, long, -1> FaceId;
     typedef ID<Halfedge, long, -1> HalfedgeId;
 
+    unsigned format_version; //layout version of this message, FORMAT_VERSION unless read from an older file
+
     std::vector<double> x_grades; //floating-point values for x-grades
     std::vector<double> y_grades; //floating-point values for y-grades
 
@@ -109,7 +119,7 @@ private:
 
     struct FaceM {
         HalfedgeId boundary; //pointer to one halfedge in the boundary of this cell
-        BarcodeTemplate dbc; //barcode template stored in this cell
+        unsigned dbc; //index of the barcode template of this cell in barcode_templates
 
         MSGPACK_DEFINE(boundary, dbc);
     };
@@ -129,6 +139,13 @@ private:
     std::vector<VertexM> vertices;
     std::vector<AnchorM> anchors;
     std::vector<FaceM> faces;
+    std::vector<BarcodeTemplate> barcode_templates; //distinct barcode templates, each stored once and shared by faces
+
+    //slab decomposition used by find_point(); not serialized, but built on the first query
+    PointLocator point_locator;
+
+    //builds point_locator from the halfedges and vertices of the arrangement
+    void build_point_locator();
 
     //finds the first anchor that intersects the left edge of the arrangement at a point not less than the specified y-coordinate
     //  if no such anchor, returns nullptr
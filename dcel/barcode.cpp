@@ -41,7 +41,7 @@ MultiBar::MultiBar(const MultiBar& other)
 //uses approximate comparisons to avoid "flickering" of bars of nearly equal length
 bool MultiBar::operator<(const MultiBar other) const
 {
-    double epsilon = pow(10, -8);
+    const double epsilon = 1e-8; //a constant rather than pow(10, -8), since this comparison is made for every bar inserted into a barcode
 
     //first, sort by length of bar
     if ((death - birth) > (other.death - other.birth + epsilon))
@@ -19,8 +19,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 **********************************************************************/
 
 #include "barcode_template.h"
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <functional>
 #include <dcel/barcode.h>
 #include <map>
 #include <math/template_point.h>
@@ -44,13 +46,6 @@ BarTemplate::BarTemplate(unsigned a, unsigned b, unsigned m)
 {
 }
 
-BarTemplate::BarTemplate(const BarTemplate& other)
-    : begin(other.begin)
-    , end(other.end)
-    , multiplicity(other.multiplicity)
-{
-}
-
 BarTemplate::BarTemplate()
     : begin(0)
     , end(0)
@@ -68,61 +63,72 @@ BarcodeTemplate::BarcodeTemplate()
 {
 }
 
-//adds a bar to the barcode (updating multiplicity, if necessary)
+//adds a bar to the barcode template; duplicates are merged by finalize()
 void BarcodeTemplate::add_bar(unsigned a, unsigned b)
 {
-    //look for the bar
-    BarTemplate bar(a, b);
-    std::set<BarTemplate>::iterator it = bars.find(bar);
-
-    if (it == bars.end()) //then the bar doesn't already exist, so insert it
-    {
-        bars.insert(bar);
-    } else //then the bar already exists, so increment its multiplicity
-    {
-        (*it).multiplicity++;
-    }
+    bars.push_back(BarTemplate(a, b));
 }
 
-//adds a bar with multiplicity to the barcode template
+//adds a bar with multiplicity to the barcode template; duplicates are merged by finalize()
 void BarcodeTemplate::add_bar(unsigned a, unsigned b, unsigned m)
 {
-    //look for the bar
-    BarTemplate bar(a, b, m);
-    std::set<BarTemplate>::iterator it = bars.find(bar);
+    bars.push_back(BarTemplate(a, b, m));
+}
+
+//sorts the bars and merges bars with the same endpoints, adding their multiplicities
+void BarcodeTemplate::finalize()
+{
+    std::sort(bars.begin(), bars.end());
 
-    if (it == bars.end()) //then the bar doesn't already exist, so insert it
-    {
-        bars.insert(bar);
-    } else //then the bar already exists, so increment its multiplicity
-    {
-        (*it).multiplicity += m;
+    std::vector<BarTemplate>::iterator last = bars.begin(); //last distinct bar found so far
+    for (std::vector<BarTemplate>::iterator it = bars.begin(); it != bars.end(); ++it) {
+        if (it == bars.begin())
+            continue;
+        if (*last < *it) //then this bar is new
+            *(++last) = *it;
+        else //then this bar has the same endpoints as the last one, so increment its multiplicity
+            last->multiplicity += it->multiplicity;
     }
-}
+    if (!bars.empty())
+        bars.erase(last + 1, bars.end());
+} //end finalize()
 
 //returns an iterator to the first bar in the barcode
-std::set<BarTemplate>::iterator BarcodeTemplate::begin()
+std::vector<BarTemplate>::const_iterator BarcodeTemplate::begin() const
 {
     return bars.begin();
 }
 
 //returns an iterator to the past-the-end element of the barcode
-std::set<BarTemplate>::iterator BarcodeTemplate::end()
+std::vector<BarTemplate>::const_iterator BarcodeTemplate::end() const
 {
     return bars.end();
 }
 
 //returns true iff this barcode has no bars
-bool BarcodeTemplate::is_empty()
+bool BarcodeTemplate::is_empty() const
 {
     return bars.empty();
 }
 
+//returns a hash of the bars and their multiplicities
+std::size_t BarcodeTemplate::hash() const
+{
+    std::size_t h = bars.size();
+    for (auto& bar : bars) {
+        //combine as in boost::hash_combine
+        h ^= std::hash<unsigned>()(bar.begin) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<unsigned>()(bar.end) + 0x9e3779b9 + (h << 6) + (h >> 2);
+        h ^= std::hash<unsigned>()(bar.multiplicity) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
 //for testing only
 void BarcodeTemplate::print()
 {
     debug() << "      barcode template: ";
-    for (std::set<BarTemplate>::iterator it = bars.begin(); it != bars.end(); ++it) {
+    for (std::vector<BarTemplate>::const_iterator it = bars.begin(); it != bars.end(); ++it) {
         BarTemplate b = *it;
         debug(true) << "(" << b.begin << "," << b.end << ")x" << b.multiplicity << ", ";
     }
@@ -145,57 +151,9 @@ bool operator==(BarTemplate const& left, BarTemplate const& right)
 // NOTE: angle in DEGREES
 std::unique_ptr<Barcode> BarcodeTemplate::rescale(double angle, double offset,
     const std::vector<TemplatePoint>& template_points,
-    const Grades& grades)
-{
-    std::unique_ptr<Barcode> bc = std::unique_ptr<Barcode>(new Barcode());
-
-    std::map<unsigned, unsigned> infinite_bars; //used for combining infinite bars (only necessary for vertical or horizontal lines)
-
-    //loop through bars
-    for (std::set<BarTemplate>::iterator it = this->begin(); it != this->end(); ++it) {
-        assert(it->begin < template_points.size());
-        TemplatePoint begin = template_points[it->begin];
-        double birth = project(begin, angle, offset, grades);
-
-        if (birth != rivet::numeric::INFTY) { //then bar exists in this rescaling
-            if (it->end >= template_points.size()) { //then endpoint is at infinity
-                if (angle == 0 || angle == 90) { //then add bar to the list of infinite bars, since we may need to combine bars
-                    std::map<unsigned, unsigned>::iterator ibit = infinite_bars.find(it->begin);
-                    if (ibit == infinite_bars.end()) { //add a new item
-                        infinite_bars.insert(std::pair<unsigned, unsigned>(it->begin, it->multiplicity));
-                    } else { //increment the multiplicity
-                        ibit->second += it->multiplicity;
-                    }
-                } else { //then add the bar to the barcode -- no combining will be necessary
-                    bc->add_bar(birth, rivet::numeric::INFTY, it->multiplicity);
-                }
-            } else { //then compute endpoint of bar (may still be infinite, but only for for horizontal or vertical lines)
-                assert(it->end < template_points.size());
-                TemplatePoint end = template_points[it->end];
-                double death = project(end, angle, offset, grades);
-                if (death == rivet::numeric::INFTY) { //add bar to the list of infinite bars
-                    std::map<unsigned, unsigned>::iterator ibit = infinite_bars.find(it->begin);
-                    if (ibit == infinite_bars.end()) { //add a new item
-                        infinite_bars.insert(std::pair<unsigned, unsigned>(it->begin, it->multiplicity));
-                    } else { //increment the multiplicity
-                        ibit->second += it->multiplicity;
-                    }
-                } else { //then add (finite) bar to the barcode
-                    bc->add_bar(birth, death, it->multiplicity);
-                }
-            }
-        }
-    }
-
-    //if the line is vertical or horizontal, we must now add the infinite bars
-    if (angle == 0 || angle == 90) {
-        for (std::map<unsigned, unsigned>::iterator it = infinite_bars.begin(); it != infinite_bars.end(); ++it) {
-            double birth = project(template_points[it->first], angle, offset, grades);
-            bc->add_bar(birth, rivet::numeric::INFTY, it->second);
-        }
-    }
-
-    return bc;
+    const Grades& grades) const
+{
+    return rescale(bars.begin(), bars.end(), angle, offset, template_points, grades);
 } //end rescale_barcode_template()
 
 //computes the projection of an xi support point onto the line specificed by angle and offset
@@ -217,21 +175,52 @@ double BarcodeTemplate::project(const TemplatePoint& pt, double angle, double of
     }
 
     //if we get here, then line is neither horizontal nor vertical
+    return project(grades.x[pt.x], grades.y[pt.y], ObliqueLine(angle, offset));
+} //end project()
+
+BarcodeTemplate::ObliqueLine::ObliqueLine(double angle, double offset)
+    : offset(offset)
+{
     double radians = angle * rivet::numeric::PI / 180;
-    double x = grades.x[pt.x];
-    double y = grades.y[pt.y];
-
-    double yL = x * tan(radians) + offset / cos(radians); // the point (x, yL) is on the line
-
-    if (y >= yL) { //then point is above line, so project to the right
-        if (offset >= 0) {
-            return (y * cos(radians) - offset) / (sin(radians) * cos(radians));
-        } //else
-        return y / sin(radians);
-    } //else: point is below the line, so project up
-    if (offset >= 0) {
-        return x / cos(radians);
-    } //else
-    return yL / sin(radians);
+    tan_angle = tan(radians);
+    cos_angle = cos(radians);
+    sin_angle = sin(radians);
+    sin_cos = sin_angle * cos_angle;
+    offset_cos = offset / cos_angle;
+}
 
-} //end project()
+BarcodeTemplatePool::BarcodeTemplatePool()
+    : templates(1)
+    , ids()
+{
+    ids.insert(std::make_pair(templates[EMPTY].hash(), EMPTY));
+}
+
+//returns the ID of the template equal to bt, adding a copy of bt to the pool if there is none
+unsigned BarcodeTemplatePool::intern(const BarcodeTemplate& bt)
+{
+    std::size_t h = bt.hash();
+    auto range = ids.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (templates[it->second] == bt)
+            return it->second;
+    }
+
+    //if we get here, then the template is new
+    unsigned id = templates.size();
+    templates.push_back(bt);
+    ids.insert(std::make_pair(h, id));
+    return id;
+} //end intern()
+
+//returns the template with the given ID
+const BarcodeTemplate& BarcodeTemplatePool::get(unsigned id) const
+{
+    return templates[id];
+}
+
+//returns the number of distinct templates
+unsigned BarcodeTemplatePool::size() const
+{
+    return templates.size();
+}
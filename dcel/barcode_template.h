@@ -24,18 +24,23 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "barcode.h"
 #include "grades.h"
 #include "math/template_point.h"
+#include "numerics.h"
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <map>
 #include <memory>
 #include <msgpack.hpp>
-#include <set>
+#include <unordered_map>
 #include <vector>
 struct BarTemplate {
     unsigned begin; //index of TemplatePointsMatrixEntry of the equivalence class corresponding to the beginning of this bar
     unsigned end; //index of TemplatePointsMatrixEntry of the equivalence class corresponding to the end of this bar
-    mutable unsigned multiplicity; //maybe this is bad style, but multiplicity is not involved in comparisons
+    unsigned multiplicity; //not involved in comparisons
 
     BarTemplate(unsigned a, unsigned b);
     BarTemplate(unsigned a, unsigned b, unsigned m);
-    BarTemplate(const BarTemplate& other);
     BarTemplate(); // for serialization
 
     bool operator<(const BarTemplate other) const;
@@ -49,25 +54,59 @@ class BarcodeTemplate {
 public:
     BarcodeTemplate();
 
-    void add_bar(unsigned a, unsigned b); //adds a bar to the barcode template (updating multiplicity, if necessary)
-    void add_bar(unsigned a, unsigned b, unsigned m); //adds a bar with multiplicity to the barcode template
+    void add_bar(unsigned a, unsigned b); //adds a bar to the barcode template; duplicates are merged by finalize()
+    void add_bar(unsigned a, unsigned b, unsigned m); //adds a bar with multiplicity to the barcode template; duplicates are merged by finalize()
 
-    std::set<BarTemplate>::iterator begin(); //returns an iterator to the first bar in the barcode
-    std::set<BarTemplate>::iterator end(); //returns an iterator to the past-the-end element of the barcode
-    bool is_empty(); //returns true iff this barcode has no bars
+    //sorts the bars and merges bars with the same endpoints, adding their multiplicities
+    //  must be called after the last call to add_bar(), before the template is compared, hashed, or stored
+    void finalize();
+
+    std::vector<BarTemplate>::const_iterator begin() const; //returns an iterator to the first bar in the barcode
+    std::vector<BarTemplate>::const_iterator end() const; //returns an iterator to the past-the-end element of the barcode
+    bool is_empty() const; //returns true iff this barcode has no bars
+
+    std::size_t hash() const; //returns a hash of the bars and their multiplicities, used to find identical templates
 
     //rescales a barcode template by projecting points onto the line specificed by angle and offset
     //  NOTE: parametrization of the line is as in the RIVET paper
     //  NOTE: angle in DEGREES
     std::unique_ptr<Barcode> rescale(double angle, double offset,
+        const std::vector<TemplatePoint>& template_points,
+        const Grades& grades) const;
+
+    //rescales the bars in the range [first, last), as above; the bars need only have the fields begin, end, and multiplicity,
+    //  so that bars stored outside of a BarcodeTemplate (e.g. in a memory-mapped file) can be rescaled
+    template <typename BarIterator>
+    static std::unique_ptr<Barcode> rescale(BarIterator first, BarIterator last, double angle, double offset,
         const std::vector<TemplatePoint>& template_points,
         const Grades& grades);
 
+    //trigonometric values of a line that is neither horizontal nor vertical, computed once per line rather than once per point
+    struct ObliqueLine {
+        ObliqueLine(double angle, double offset); //angle in DEGREES, strictly between 0 and 90
+
+        double offset;
+        double tan_angle;
+        double cos_angle;
+        double sin_angle;
+        double sin_cos; //sin_angle * cos_angle
+        double offset_cos; //offset / cos_angle
+    };
+
     //computes the projection of an xi support point onto the line specificed by angle and offset
     //  NOTE: parametrization of the line is as in the RIVET paper
     //  NOTE: returns INFTY if the point has no projection (can happen only for horizontal and vertical lines)
     //  NOTE: angle in DEGREES
-    double project(const TemplatePoint& pt, double angle, double offset, const Grades& grades);
+    static double project(const TemplatePoint& pt, double angle, double offset, const Grades& grades);
+
+    //computes the projection of the point (x, y) onto the given line, as above; written without branches so that it can be vectorized
+    static double project(double x, double y, const ObliqueLine& line)
+    {
+        double yL = x * line.tan_angle + line.offset_cos; // the point (x, yL) is on the line
+        double right = (line.offset >= 0) ? (y * line.cos_angle - line.offset) / line.sin_cos : y / line.sin_angle; //projection to the right, if the point is above the line
+        double up = (line.offset >= 0) ? x / line.cos_angle : yL / line.sin_angle; //projection upwards, if the point is below the line
+        return (y >= yL) ? right : up;
+    }
 
     void print(); //for testing only
 
@@ -75,7 +114,129 @@ public:
     friend bool operator==(BarcodeTemplate const& left, BarcodeTemplate const& right);
 
 private:
-    std::set<BarTemplate> bars;
+    std::vector<BarTemplate> bars; //sorted by endpoints, without duplicates, once finalize() has been called
 };
 
+//stores each distinct barcode template once, so that cells of the arrangement with identical templates share them
+//  templates are identified by their index in the pool; ID 0 is always the empty template
+//  NOTE: not thread-safe; concurrent callers of intern() must synchronize
+class BarcodeTemplatePool {
+public:
+    BarcodeTemplatePool(); //creates a pool containing only the empty template
+
+    static const unsigned EMPTY = 0; //ID of the empty template
+
+    unsigned intern(const BarcodeTemplate& bt); //returns the ID of the template equal to bt, adding a copy of bt to the pool if there is none
+
+    const BarcodeTemplate& get(unsigned id) const; //returns the template with the given ID; references remain valid as templates are added
+
+    unsigned size() const; //returns the number of distinct templates
+
+private:
+    std::deque<BarcodeTemplate> templates; //a deque, so that adding templates does not move the existing ones
+    std::unordered_multimap<std::size_t, unsigned> ids; //ID of each template, keyed by hash
+};
+
+//rescales the bars in the range [first, last) by projecting points onto the line specificed by angle and offset
+// NOTE: parametrization of the line is as in the RIVET paper
+// NOTE: angle in DEGREES
+template <typename BarIterator>
+std::unique_ptr<Barcode> BarcodeTemplate::rescale(BarIterator first, BarIterator last, double angle, double offset,
+    const std::vector<TemplatePoint>& template_points,
+    const Grades& grades)
+{
+    std::unique_ptr<Barcode> bc = std::unique_ptr<Barcode>(new Barcode());
+
+    if (angle != 0 && angle != 90) {
+        //the line is neither horizontal nor vertical, so every point has a projection, and only bars that end at infinity are infinite
+        ObliqueLine line(angle, offset);
+
+        //gather the coordinates of the endpoints of the bars into contiguous arrays, then project them all in one loop
+        unsigned n = std::distance(first, last);
+        std::vector<double> coords(6 * n);
+        double* begin_x = coords.data();
+        double* begin_y = begin_x + n;
+        double* end_x = begin_y + n;
+        double* end_y = end_x + n;
+        double* births = end_y + n;
+        double* deaths = births + n;
+        unsigned k = 0;
+        for (BarIterator it = first; it != last; ++it, ++k) {
+            assert(it->begin < template_points.size());
+            begin_x[k] = grades.x[template_points[it->begin].x];
+            begin_y[k] = grades.y[template_points[it->begin].y];
+            if (it->end < template_points.size()) {
+                end_x[k] = grades.x[template_points[it->end].x];
+                end_y[k] = grades.y[template_points[it->end].y];
+            } else { //the endpoint is at infinity; project an arbitrary point instead
+                end_x[k] = 0;
+                end_y[k] = 0;
+            }
+        }
+
+#pragma omp simd
+        for (unsigned j = 0; j < n; j++) {
+            births[j] = project(begin_x[j], begin_y[j], line);
+            deaths[j] = project(end_x[j], end_y[j], line);
+        }
+
+        k = 0;
+        for (BarIterator it = first; it != last; ++it, ++k) {
+            double death = (it->end < template_points.size()) ? deaths[k] : rivet::numeric::INFTY;
+            bc->add_bar(births[k], death, it->multiplicity);
+        }
+        return bc;
+    }
+
+    //if we get here, then the line is horizontal or vertical
+
+    std::map<unsigned, unsigned> infinite_bars; //used for combining infinite bars (only necessary for vertical or horizontal lines)
+
+    //loop through bars
+    for (BarIterator it = first; it != last; ++it) {
+        assert(it->begin < template_points.size());
+        TemplatePoint begin = template_points[it->begin];
+        double birth = project(begin, angle, offset, grades);
+
+        if (birth != rivet::numeric::INFTY) { //then bar exists in this rescaling
+            if (it->end >= template_points.size()) { //then endpoint is at infinity
+                if (angle == 0 || angle == 90) { //then add bar to the list of infinite bars, since we may need to combine bars
+                    std::map<unsigned, unsigned>::iterator ibit = infinite_bars.find(it->begin);
+                    if (ibit == infinite_bars.end()) { //add a new item
+                        infinite_bars.insert(std::pair<unsigned, unsigned>(it->begin, it->multiplicity));
+                    } else { //increment the multiplicity
+                        ibit->second += it->multiplicity;
+                    }
+                } else { //then add the bar to the barcode -- no combining will be necessary
+                    bc->add_bar(birth, rivet::numeric::INFTY, it->multiplicity);
+                }
+            } else { //then compute endpoint of bar (may still be infinite, but only for for horizontal or vertical lines)
+                assert(it->end < template_points.size());
+                TemplatePoint end = template_points[it->end];
+                double death = project(end, angle, offset, grades);
+                if (death == rivet::numeric::INFTY) { //add bar to the list of infinite bars
+                    std::map<unsigned, unsigned>::iterator ibit = infinite_bars.find(it->begin);
+                    if (ibit == infinite_bars.end()) { //add a new item
+                        infinite_bars.insert(std::pair<unsigned, unsigned>(it->begin, it->multiplicity));
+                    } else { //increment the multiplicity
+                        ibit->second += it->multiplicity;
+                    }
+                } else { //then add (finite) bar to the barcode
+                    bc->add_bar(birth, death, it->multiplicity);
+                }
+            }
+        }
+    }
+
+    //if the line is vertical or horizontal, we must now add the infinite bars
+    if (angle == 0 || angle == 90) {
+        for (std::map<unsigned, unsigned>::iterator it = infinite_bars.begin(); it != infinite_bars.end(); ++it) {
+            double birth = project(template_points[it->first], angle, offset, grades);
+            bc->add_bar(birth, rivet::numeric::INFTY, it->second);
+        }
+    }
+
+    return bc;
+} //end rescale()
+
 #endif // __BARCODE_TEMPLATE_H__
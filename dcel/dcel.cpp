@@ -168,8 +168,15 @@ Debug& operator<<(Debug& qd, const Halfedge& e)
 
 /*** implementation of class Face ***/
 
+namespace {
+//template of cells that have not been given one
+const BarcodeTemplate empty_barcode_template;
+}
+
 Face::Face(Halfedge* e, unsigned long id)
     : boundary(e)
+    , dbc(&empty_barcode_template)
+    , dbc_id(BarcodeTemplatePool::EMPTY)
     , visited(false)
     , identifier(id)
 {
@@ -177,6 +184,8 @@ Face::Face(Halfedge* e, unsigned long id)
 
 Face::Face()
     : boundary()
+    , dbc(&empty_barcode_template)
+    , dbc_id(BarcodeTemplatePool::EMPTY)
     , visited(false)
     , identifier(-1)
 {
@@ -196,14 +205,20 @@ Halfedge* Face::get_boundary()
     return boundary;
 }
 
-BarcodeTemplate& Face::get_barcode()
+const BarcodeTemplate& Face::get_barcode() const
+{
+    return *dbc;
+}
+
+unsigned Face::get_barcode_id() const
 {
-    return dbc;
+    return dbc_id;
 }
 
-void Face::set_barcode(const BarcodeTemplate& bt)
+void Face::set_barcode(unsigned id, const BarcodeTemplate& bt)
 {
-    dbc = bt; ///TODO: is this good design???
+    dbc = &bt;
+    dbc_id = id;
 }
 
 bool Face::has_been_visited()
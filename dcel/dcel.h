@@ -104,13 +104,14 @@ class Face {
 public:
     Face(Halfedge* e, unsigned long id); //constructor: requires pointer to a boundary halfedge
     Face(); // For serialization
-    ~Face(); //destructor: destroys barcode template
+    ~Face(); //destructor (the barcode template belongs to the arrangement's BarcodeTemplatePool)
 
     void set_boundary(Halfedge* e); //set the pointer to a halfedge on the boundary of this face
     Halfedge* get_boundary(); //get the (pointer to the) boundary halfedge
 
-    BarcodeTemplate& get_barcode(); //returns a reference to the barcode template stored in this cell
-    void set_barcode(const BarcodeTemplate& bt); //stores (a copy of) the specified barcode template in this cell
+    const BarcodeTemplate& get_barcode() const; //returns a reference to the barcode template of this cell
+    unsigned get_barcode_id() const; //returns the ID of the barcode template of this cell in the arrangement's BarcodeTemplatePool
+    void set_barcode(unsigned id, const BarcodeTemplate& bt); //refers this cell to the pooled barcode template bt, which has the given ID
 
     bool has_been_visited(); //true iff cell has been visited in the vineyard-update process (so that we can distinguish a cell with an empty barcode from an unvisited cell)
     void mark_as_visited(); //marks this cell as visited
@@ -121,7 +122,8 @@ public:
 
 private:
     Halfedge* boundary; //pointer to one halfedge in the boundary of this cell
-    BarcodeTemplate dbc; //barcode template stored in this cell
+    const BarcodeTemplate* dbc; //barcode template of this cell, shared with all cells that have the same template
+    unsigned dbc_id; //ID of dbc in the arrangement's BarcodeTemplatePool
     bool visited; //initially false, set to true after this cell has been visited in the vineyard-update process (so that we can distinguish a cell with an empty barcode from an unvisited cell)
     unsigned long identifier; // Arrangement-specific ID for this face
 }; //end class Face
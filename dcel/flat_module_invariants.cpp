@@ -0,0 +1,421 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "flat_module_invariants.h"
+
+#include "dcel/anchor.h"
+#include "dcel/arrangement.h"
+#include "dcel/barcode_template.h"
+#include "dcel/dcel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char FlatModuleInvariants::MAGIC[16] = "RIVET_flat\n";
+
+namespace {
+//returns the given size rounded up to a multiple of 8 bytes
+std::size_t align(std::size_t size)
+{
+    return (size + 7) & ~static_cast<std::size_t>(7);
+}
+
+//writes the given elements, followed by padding to a multiple of 8 bytes
+template <typename T>
+void write_section(std::ostream& stream, const std::vector<T>& elements)
+{
+    std::size_t size = elements.size() * sizeof(T);
+    if (size > 0)
+        stream.write(reinterpret_cast<const char*>(elements.data()), size);
+    static const char zeros[8] = { 0 };
+    stream.write(zeros, align(size) - size);
+}
+
+//returns the offset just past a section of count elements of the given size that starts at the given offset
+//  the counts are read from the file, so overflow is checked rather than allowed to wrap around
+std::size_t section_end(std::size_t offset, uint64_t count, std::size_t element_size)
+{
+    const std::size_t max = std::numeric_limits<std::size_t>::max() - 7; //largest size that can be aligned
+    if (count > max / element_size || offset > max - count * element_size)
+        throw std::runtime_error("Flat module invariants file is corrupt");
+    return offset + align(count * element_size);
+}
+
+//throws unless the given index is less than the given bound
+void check_index(uint64_t index, uint64_t bound)
+{
+    if (index >= bound)
+        throw std::runtime_error("Index out of range in flat module invariants file");
+}
+}
+
+//maps the given file into memory
+FlatModuleInvariants::FlatModuleInvariants(const std::string& file_name)
+    : data(nullptr)
+    , length(0)
+    , mapping(nullptr)
+{
+#ifdef _WIN32
+    //no memory mapping; read the file into an aligned buffer instead
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Could not open " + file_name + " for reading.");
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    length = bytes.size();
+    buffer.resize(length / sizeof(uint64_t) + 1);
+    std::memcpy(buffer.data(), bytes.data(), length);
+    data = reinterpret_cast<const char*>(buffer.data());
+#else
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Could not open " + file_name + " for reading.");
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not read " + file_name);
+    }
+    length = info.st_size;
+    mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); //the mapping remains valid after the file is closed
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        throw std::runtime_error("Could not map " + file_name + " into memory");
+    }
+    data = static_cast<const char*>(mapping);
+#endif
+    try {
+        open();
+    } catch (...) {
+#ifndef _WIN32
+        munmap(mapping, length);
+#endif
+        throw;
+    }
+}
+
+//reads a file from the given bytes
+FlatModuleInvariants::FlatModuleInvariants(const char* bytes, std::size_t len)
+    : data(nullptr)
+    , length(len)
+    , mapping(nullptr)
+    , buffer(len / sizeof(uint64_t) + 1)
+{
+    std::memcpy(buffer.data(), bytes, len);
+    data = reinterpret_cast<const char*>(buffer.data());
+    open();
+}
+
+FlatModuleInvariants::~FlatModuleInvariants()
+{
+#ifndef _WIN32
+    if (mapping != nullptr)
+        munmap(mapping, length);
+#endif
+}
+
+//returns the byte offsets of the sections described by the given header
+FlatModuleInvariants::Layout FlatModuleInvariants::layout(const Header& h)
+{
+    if (h.num_templates == std::numeric_limits<uint64_t>::max())
+        throw std::runtime_error("Flat module invariants file is corrupt");
+
+    Layout l;
+    l.x_grades = sizeof(MAGIC) + align(sizeof(Header));
+    l.y_grades = section_end(l.x_grades, h.num_x_grades, sizeof(double));
+    l.template_points = section_end(l.y_grades, h.num_y_grades, sizeof(double));
+    l.anchors = section_end(l.template_points, h.num_template_points, sizeof(FlatTemplatePoint));
+    l.vertical_queries = section_end(l.anchors, h.num_anchors, sizeof(FlatAnchor));
+    l.face_templates = section_end(l.vertical_queries, h.num_vertical_queries, sizeof(FlatVerticalQuery));
+    l.bar_offsets = section_end(l.face_templates, h.num_faces, sizeof(uint32_t));
+    l.bars = section_end(l.bar_offsets, h.num_templates + 1, sizeof(uint64_t));
+    l.slopes = section_end(l.bars, h.num_bars, sizeof(FlatBar));
+    l.intercepts = section_end(l.slopes, h.num_anchors, sizeof(double)); //the lines of the index are the anchor lines
+    l.nodes = section_end(l.intercepts, h.num_anchors, sizeof(double));
+    l.slab_x = section_end(l.nodes, h.num_nodes, sizeof(PointLocator::Node));
+    l.slab_root = section_end(l.slab_x, h.num_slabs, sizeof(double));
+    l.size = section_end(l.slab_root, h.num_slabs, sizeof(unsigned));
+    return l;
+} //end layout()
+
+//writes the module invariants of the given arrangement to a stream opened in binary mode
+void FlatModuleInvariants::write(std::ostream& stream, const Arrangement& arrangement, const std::vector<TemplatePoint>& template_points)
+{
+    if (!arrangement.point_locator.is_valid())
+        throw std::runtime_error("Cannot write a flat module invariants file: the point-location index of the arrangement is not available");
+
+    PointLocator::View view = arrangement.point_locator.view();
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header)); //so that padding bytes are written as zeros
+    header.version = VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.num_x_grades = arrangement.x_grades.size();
+    header.num_y_grades = arrangement.y_grades.size();
+    header.num_template_points = template_points.size();
+    header.num_anchors = arrangement.all_anchors.size();
+    header.num_vertical_queries = arrangement.vertical_line_query_list.size();
+    header.num_faces = arrangement.faces.size();
+    header.num_nodes = view.num_nodes;
+    header.num_slabs = view.num_slabs;
+    header.top_face = arrangement.topleft->get_twin()->get_face()->id();
+    header.right_face = arrangement.bottomright->get_twin()->get_face()->id();
+
+    std::vector<FlatTemplatePoint> points;
+    points.reserve(template_points.size());
+    for (auto& point : template_points)
+        points.push_back(FlatTemplatePoint{ point.x, point.y });
+
+    std::vector<FlatAnchor> anchors;
+    anchors.reserve(arrangement.all_anchors.size());
+    for (auto anchor : arrangement.all_anchors)
+        anchors.push_back(FlatAnchor{ anchor->get_x(), anchor->get_y(), static_cast<uint32_t>(anchor->get_line()->get_face()->id()) });
+
+    std::vector<FlatVerticalQuery> vertical_queries;
+    vertical_queries.reserve(arrangement.vertical_line_query_list.size());
+    for (auto query : arrangement.vertical_line_query_list)
+        vertical_queries.push_back(FlatVerticalQuery{ query->get_anchor()->get_x(), static_cast<uint32_t>(query->get_face()->id()) });
+
+    std::vector<uint32_t> face_templates;
+    face_templates.reserve(arrangement.faces.size());
+    for (auto face : arrangement.faces)
+        face_templates.push_back(face->get_barcode_id());
+
+    std::vector<uint64_t> bar_offsets;
+    std::vector<FlatBar> bars;
+    bar_offsets.reserve(arrangement.template_pool.size() + 1);
+    for (unsigned i = 0; i < arrangement.template_pool.size(); i++) {
+        bar_offsets.push_back(bars.size());
+        const BarcodeTemplate& bt = arrangement.template_pool.get(i);
+        for (auto it = bt.begin(); it != bt.end(); ++it)
+            bars.push_back(FlatBar{ it->begin, it->end, it->multiplicity });
+    }
+    bar_offsets.push_back(bars.size());
+    header.num_templates = arrangement.template_pool.size();
+    header.num_bars = bars.size();
+
+    stream.write(MAGIC, sizeof(MAGIC));
+    write_section(stream, std::vector<Header>(1, header));
+    write_section(stream, arrangement.x_grades);
+    write_section(stream, arrangement.y_grades);
+    write_section(stream, points);
+    write_section(stream, anchors);
+    write_section(stream, vertical_queries);
+    write_section(stream, face_templates);
+    write_section(stream, bar_offsets);
+    write_section(stream, bars);
+    write_section(stream, std::vector<double>(view.slopes, view.slopes + view.num_lines));
+    write_section(stream, std::vector<double>(view.intercepts, view.intercepts + view.num_lines));
+    write_section(stream, std::vector<PointLocator::Node>(view.nodes, view.nodes + view.num_nodes));
+    write_section(stream, std::vector<double>(view.slab_x, view.slab_x + view.num_slabs));
+    write_section(stream, std::vector<unsigned>(view.slab_root, view.slab_root + view.num_slabs));
+    if (!stream)
+        throw std::runtime_error("Error writing flat module invariants file");
+} //end write()
+
+//returns true iff the given file begins with the flat file header
+bool FlatModuleInvariants::is_flat_file(const std::string& file_name)
+{
+    std::ifstream file(file_name, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    return file.read(magic, sizeof(MAGIC)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+//checks the header and sets up the sections of the file
+void FlatModuleInvariants::open()
+{
+    if (length < sizeof(MAGIC) + sizeof(Header) || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error("Not a flat module invariants file");
+    header = reinterpret_cast<const Header*>(data + sizeof(MAGIC));
+    if (header->byte_order != BYTE_ORDER_MARK)
+        throw std::runtime_error("Flat module invariants file was written on a machine with a different byte order");
+    if (header->version != VERSION)
+        throw std::runtime_error("Unsupported flat module invariants file version");
+
+    Layout l = layout(*header);
+    if (length < l.size)
+        throw std::runtime_error("Flat module invariants file is truncated");
+    if (header->num_x_grades == 0 || header->num_y_grades == 0)
+        throw std::runtime_error("Flat module invariants file has no grades");
+    if (header->num_anchors > std::numeric_limits<unsigned>::max() || header->num_nodes > std::numeric_limits<unsigned>::max()
+        || header->num_slabs > std::numeric_limits<unsigned>::max() || (header->num_anchors > 0 && header->num_slabs == 0))
+        throw std::runtime_error("Flat module invariants file is corrupt");
+
+    anchors = reinterpret_cast<const FlatAnchor*>(data + l.anchors);
+    vertical_queries = reinterpret_cast<const FlatVerticalQuery*>(data + l.vertical_queries);
+    face_templates = reinterpret_cast<const uint32_t*>(data + l.face_templates);
+    bar_offsets = reinterpret_cast<const uint64_t*>(data + l.bar_offsets);
+    bars = reinterpret_cast<const FlatBar*>(data + l.bars);
+
+    locator.slopes = reinterpret_cast<const double*>(data + l.slopes);
+    locator.intercepts = reinterpret_cast<const double*>(data + l.intercepts);
+    locator.num_lines = header->num_anchors;
+    locator.nodes = reinterpret_cast<const PointLocator::Node*>(data + l.nodes);
+    locator.num_nodes = header->num_nodes;
+    locator.slab_x = reinterpret_cast<const double*>(data + l.slab_x);
+    locator.slab_root = reinterpret_cast<const unsigned*>(data + l.slab_root);
+    locator.num_slabs = header->num_slabs;
+    locator.top_face = header->top_face;
+
+    const double* x = reinterpret_cast<const double*>(data + l.x_grades);
+    const double* y = reinterpret_cast<const double*>(data + l.y_grades);
+    grades.x.assign(x, x + header->num_x_grades);
+    grades.y.assign(y, y + header->num_y_grades);
+
+    const FlatTemplatePoint* points = reinterpret_cast<const FlatTemplatePoint*>(data + l.template_points);
+
+    //check every index stored in the file once, so that queries and rescaling can use them without checks
+    check_index(header->top_face, header->num_faces);
+    check_index(header->right_face, header->num_faces);
+    for (uint64_t i = 0; i < header->num_template_points; i++) {
+        check_index(points[i].x, header->num_x_grades);
+        check_index(points[i].y, header->num_y_grades);
+    }
+    for (uint64_t i = 0; i < header->num_anchors; i++)
+        check_index(anchors[i].face, header->num_faces);
+    for (uint64_t i = 0; i < header->num_vertical_queries; i++) {
+        check_index(vertical_queries[i].x, header->num_x_grades);
+        check_index(vertical_queries[i].face, header->num_faces);
+    }
+    for (uint64_t i = 0; i < header->num_faces; i++)
+        check_index(face_templates[i], header->num_templates);
+
+    //the bars of the templates must partition the bars section; an end not less than num_template_points denotes infinity
+    if (bar_offsets[0] != 0 || bar_offsets[header->num_templates] != header->num_bars)
+        throw std::runtime_error("Flat module invariants file is corrupt");
+    for (uint64_t i = 0; i < header->num_templates; i++) {
+        if (bar_offsets[i] > bar_offsets[i + 1])
+            throw std::runtime_error("Flat module invariants file is corrupt");
+    }
+    for (uint64_t i = 0; i < header->num_bars; i++)
+        check_index(bars[i].begin, header->num_template_points);
+
+    //the trees of the point-location index, and the slabs, which must be sorted for the binary search
+    for (uint64_t i = 0; i < header->num_nodes; i++) {
+        const PointLocator::Node& node = locator.nodes[i];
+        check_index(node.left, header->num_nodes);
+        check_index(node.right, header->num_nodes);
+        check_index(node.line, header->num_anchors);
+        check_index(node.face, header->num_faces);
+    }
+    for (uint64_t i = 0; i < header->num_slabs; i++) {
+        check_index(locator.slab_root[i], header->num_nodes);
+        if (i > 0 && !(locator.slab_x[i - 1] <= locator.slab_x[i]))
+            throw std::runtime_error("Flat module invariants file is corrupt");
+    }
+
+    template_points.clear();
+    template_points.reserve(header->num_template_points);
+    for (uint64_t i = 0; i < header->num_template_points; i++)
+        template_points.push_back(TemplatePoint(points[i].x, points[i].y, 0, 0, 0));
+} //end open()
+
+//returns the face containing each of the given lines, given as (angle, offset) pairs
+//REQUIREMENT: 0 <= degrees <= 90 for each line
+std::vector<unsigned> FlatModuleInvariants::find_faces(const std::vector<std::pair<double, double>>& lines) const
+{
+    std::vector<unsigned> found(lines.size(), 0);
+
+    //compute dual points; horizontal and vertical lines are found directly by binary search
+    std::vector<std::pair<std::pair<double, double>, unsigned>> points; //dual point of each remaining line, with the index of the line
+    points.reserve(lines.size());
+    for (unsigned i = 0; i < lines.size(); i++) {
+        double degrees = lines[i].first;
+        double offset = lines[i].second;
+        if (degrees == 90) {
+            found[i] = find_vertical_line(-1 * offset); //multiply by -1 to correct for orientation of offset
+        } else if (degrees == 0) {
+            found[i] = find_horizontal_line(offset);
+        } else {
+            double radians = degrees * 3.14159265 / 180;
+            double slope = tan(radians);
+            double intercept = offset / cos(radians);
+            points.push_back(std::make_pair(std::make_pair(slope, -1 * intercept), i)); //multiply by -1 for point-line duality
+        }
+    }
+
+    //sort the dual points from left to right, so that the slabs are visited in a single sweep
+    std::sort(points.begin(), points.end());
+    std::vector<std::pair<double, double>> sorted_points;
+    sorted_points.reserve(points.size());
+    for (auto& point : points)
+        sorted_points.push_back(point.first);
+
+    std::vector<long> faces = locator.find_faces(sorted_points);
+    for (unsigned k = 0; k < points.size(); k++)
+        found[points[k].second] = faces[k];
+    return found;
+} //end find_faces()
+
+//rescales the barcode template of the given face
+std::unique_ptr<Barcode> FlatModuleInvariants::rescale(unsigned face, double angle, double offset) const
+{
+    if (face >= header->num_faces)
+        throw std::runtime_error("Face index out of range in flat module invariants file");
+    uint32_t id = face_templates[face];
+    return BarcodeTemplate::rescale(bars + bar_offsets[id], bars + bar_offsets[id + 1], angle, offset, template_points, grades);
+}
+
+//returns the (floating-point) grades
+const Grades& FlatModuleInvariants::get_grades() const
+{
+    return grades;
+}
+
+//finds the face containing the dual point of the horizontal line with the given offset
+//  as Arrangement::find_least_upper_anchor(): the face below the first anchor line that meets the left edge of the arrangement at or above the corresponding grade
+unsigned FlatModuleInvariants::find_horizontal_line(double y_coord) const
+{
+    //find the greatest y-grade not greater than y_coord
+    auto grade = std::upper_bound(grades.y.begin(), grades.y.end(), y_coord);
+    if (grade == grades.y.begin())
+        return header->top_face;
+    unsigned best = (grade - grades.y.begin()) - 1;
+
+    //anchors are ordered by decreasing y-coordinate; find the first whose y-coordinate is not greater than best
+    const FlatAnchor* end = anchors + header->num_anchors;
+    const FlatAnchor* it = std::partition_point(anchors, end, [best](const FlatAnchor& a) { return a.y > best; });
+    if (it == end)
+        return header->top_face;
+    return it->face;
+} //end find_horizontal_line()
+
+//finds the face associated to the dual point of the vertical line with the given x-coordinate, as Arrangement::find_vertical_line()
+unsigned FlatModuleInvariants::find_vertical_line(double x_coord) const
+{
+    //find the last query whose anchor x-coordinate is not greater than x_coord
+    const FlatVerticalQuery* end = vertical_queries + header->num_vertical_queries;
+    const FlatVerticalQuery* it = std::partition_point(vertical_queries, end,
+        [this, x_coord](const FlatVerticalQuery& q) { return grades.x[q.x] <= x_coord; });
+    if (it == vertical_queries)
+        return header->right_face;
+    return (it - 1)->face;
+} //end find_vertical_line()
@@ -0,0 +1,162 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	FlatModuleInvariants
+ * \brief	Read-only module invariants file that answers barcode queries without deserializing the arrangement.
+ * \author	The RIVET Developers
+ * \date	2026
+ *
+ * The file stores the grades, the template points, the distinct barcode templates of the faces, and the arrays of the
+ * point-location index (see PointLocator) in fixed-layout sections, so that it can be memory-mapped and queried in place.
+ * The DCEL itself is not stored; such files cannot be opened by the viewer.
+ */
+
+#ifndef __FLAT_MODULE_INVARIANTS_H__
+#define __FLAT_MODULE_INVARIANTS_H__
+
+#include "dcel/barcode.h"
+#include "dcel/grades.h"
+#include "dcel/point_locator.h"
+#include "math/template_point.h"
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Arrangement;
+
+class FlatModuleInvariants {
+public:
+    //maps the given file into memory
+    explicit FlatModuleInvariants(const std::string& file_name);
+
+    //reads a file from the given bytes; the bytes are copied, since the sections must be suitably aligned
+    FlatModuleInvariants(const char* bytes, std::size_t length);
+
+    ~FlatModuleInvariants();
+
+    FlatModuleInvariants(const FlatModuleInvariants&) = delete;
+    FlatModuleInvariants& operator=(const FlatModuleInvariants&) = delete;
+
+    //writes the module invariants of the given arrangement to a stream opened in binary mode
+    //  throws if the point-location index of the arrangement is not available
+    static void write(std::ostream& stream, const Arrangement& arrangement, const std::vector<TemplatePoint>& template_points);
+
+    static bool is_flat_file(const std::string& file_name); //returns true iff the given file begins with the flat file header
+
+    //returns the face containing each of the given lines, given as (angle, offset) pairs, as Arrangement::get_barcode_templates()
+    std::vector<unsigned> find_faces(const std::vector<std::pair<double, double>>& lines) const;
+
+    //rescales the barcode template of the given face, as BarcodeTemplate::rescale()
+    std::unique_ptr<Barcode> rescale(unsigned face, double angle, double offset) const;
+
+    const Grades& get_grades() const; //returns the (floating-point) grades
+
+private:
+    struct Header {
+        uint32_t version;
+        uint32_t byte_order; //BYTE_ORDER_MARK, as written
+        uint64_t num_x_grades;
+        uint64_t num_y_grades;
+        uint64_t num_template_points;
+        uint64_t num_anchors;
+        uint64_t num_vertical_queries;
+        uint64_t num_faces;
+        uint64_t num_templates; //distinct barcode templates, shared between faces as in BarcodeTemplatePool
+        uint64_t num_bars;
+        uint64_t num_nodes;
+        uint64_t num_slabs;
+        uint32_t top_face; //face above all anchor lines (default for horizontal queries)
+        uint32_t right_face; //face containing the dual points of vertical lines left of all anchors
+    };
+
+    struct FlatTemplatePoint {
+        uint32_t x;
+        uint32_t y;
+    };
+
+    struct FlatAnchor {
+        uint32_t x;
+        uint32_t y;
+        uint32_t face; //face below the anchor line at the left edge of the arrangement
+    };
+
+    struct FlatVerticalQuery {
+        uint32_t x; //discrete x-coordinate of the anchor
+        uint32_t face;
+    };
+
+    struct FlatBar {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t multiplicity;
+    };
+
+    //byte offsets of the sections, each aligned to 8 bytes
+    struct Layout {
+        std::size_t x_grades;
+        std::size_t y_grades;
+        std::size_t template_points;
+        std::size_t anchors;
+        std::size_t vertical_queries;
+        std::size_t face_templates;
+        std::size_t bar_offsets;
+        std::size_t bars;
+        std::size_t slopes;
+        std::size_t intercepts;
+        std::size_t nodes;
+        std::size_t slab_x;
+        std::size_t slab_root;
+        std::size_t size; //total size of the file
+    };
+
+    static const char MAGIC[16];
+    static const uint32_t VERSION = 2;
+    static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    static Layout layout(const Header& header);
+
+    const char* data; //start of the file
+    std::size_t length;
+    void* mapping; //memory mapping of the file, if any
+    std::vector<uint64_t> buffer; //copy of the file, if it was not mapped
+
+    const Header* header;
+    const FlatAnchor* anchors; //ordered as Arrangement::all_anchors
+    const FlatVerticalQuery* vertical_queries; //ordered as Arrangement::vertical_line_query_list
+    const uint32_t* face_templates; //barcode template of each face
+    const uint64_t* bar_offsets; //bars of template i are bars[bar_offsets[i]] through bars[bar_offsets[i + 1] - 1]
+    const FlatBar* bars;
+    PointLocator::View locator;
+
+    //grades and template points are copied, as they are small and are used in the form expected by BarcodeTemplate::rescale()
+    Grades grades;
+    std::vector<TemplatePoint> template_points;
+
+    void open(); //checks the header and sets up the sections of the file
+
+    unsigned find_horizontal_line(double y_coord) const; //as Arrangement::find_least_upper_anchor(), returning the face
+    unsigned find_vertical_line(double x_coord) const; //as Arrangement::find_vertical_line()
+};
+
+#endif // __FLAT_MODULE_INVARIANTS_H__
@@ -30,7 +30,7 @@ Grades::Grades()
 {
 }
 
-Grades::Grades(std::vector<exact> x, std::vector<exact> y)
+Grades::Grades(const std::vector<exact>& x, const std::vector<exact>& y)
     : x(rivet::numeric::to_doubles(x))
     , y(rivet::numeric::to_doubles(y))
 {
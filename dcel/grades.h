@@ -34,7 +34,7 @@ struct Grades {
 
     Grades();
 
-    Grades(std::vector<exact> x, std::vector<exact> y);
+    Grades(const std::vector<exact>& x, const std::vector<exact>& y);
 
     double min_offset() const;
     double max_offset() const;
@@ -0,0 +1,258 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "point_locator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+PointLocator::PointLocator()
+    : top_face(0)
+    , built(false)
+    , valid(false)
+{
+}
+
+//starts a new index for the lines y = slopes[i]*x - intercepts[i], which must be ordered from bottom to top just to the right of the left edge (x = 0)
+void PointLocator::initialize(const std::vector<double>& s, const std::vector<double>& c, const std::vector<long>& below, long top)
+{
+    slopes = s;
+    intercepts = c;
+    left_faces.assign(below.begin(), below.end());
+    top_face = top;
+
+    nodes.clear();
+    slab_x.clear();
+    slab_root.clear();
+    crossings.clear();
+    built = false;
+    valid = false;
+}
+
+//records an interior vertex of the arrangement with the given x-coordinate
+void PointLocator::add_crossing(double x, const std::vector<std::pair<unsigned, long>>& lines)
+{
+    crossings.push_back(Crossing{ x, lines });
+}
+
+//builds the slabs from the recorded crossings
+//  the crossings are swept from left to right; if some crossing does not reorder a contiguous block of lines
+//  (which would mean that the floating-point vertex coordinates disagree with the combinatorial arrangement), the index is marked invalid
+void PointLocator::build()
+{
+    built = true;
+    valid = true;
+
+    unsigned n = slopes.size();
+    if (n == 0) {
+        crossings.clear();
+        return;
+    }
+
+    //order of the lines and faces just to the right of the left edge
+    std::vector<unsigned> line_at(n); //line_at[p] is the line at position p (counting from the bottom)
+    std::vector<unsigned> pos(n); //pos[i] is the position of line i
+    std::vector<unsigned> face_at(left_faces); //face_at[p] is the face below the line at position p
+    for (unsigned i = 0; i < n; i++) {
+        line_at[i] = i;
+        pos[i] = i;
+    }
+
+    nodes.reserve(2 * n + 2 * crossings.size() * (2 + std::log2(n)));
+    slab_x.reserve(crossings.size() + 1);
+    slab_root.reserve(crossings.size() + 1);
+
+    slab_x.push_back(-std::numeric_limits<double>::infinity());
+    slab_root.push_back(create(0, n - 1, line_at, face_at));
+
+    //sweep the crossings from left to right; crossings with the same x-coordinate involve disjoint sets of lines, so they share one slab
+    std::stable_sort(crossings.begin(), crossings.end(),
+        [](const Crossing& a, const Crossing& b) { return a.x < b.x; });
+
+    for (unsigned i = 0; i < crossings.size() && valid;) {
+        double x = crossings[i].x;
+        unsigned root = slab_root.back();
+
+        for (; i < crossings.size() && crossings[i].x == x; i++) {
+            std::vector<std::pair<unsigned, long>>& lines = crossings[i].lines;
+
+            //to the right of the vertex, the lines through it are ordered by slope
+            std::sort(lines.begin(), lines.end(),
+                [this](const std::pair<unsigned, long>& a, const std::pair<unsigned, long>& b) { return slopes[a.first] < slopes[b.first]; });
+
+            unsigned a = n, b = 0;
+            for (auto& line : lines) {
+                a = std::min(a, pos[line.first]);
+                b = std::max(b, pos[line.first]);
+            }
+
+            if (lines.size() < 2 || b - a + 1 != lines.size()) {
+                valid = false;
+                break;
+            }
+
+            for (unsigned k = 0; k < lines.size(); k++) {
+                if (k > 0 && slopes[lines[k - 1].first] == slopes[lines[k].first]) {
+                    valid = false;
+                    break;
+                }
+                line_at[a + k] = lines[k].first;
+                face_at[a + k] = lines[k].second;
+                pos[lines[k].first] = a + k;
+            }
+            if (!valid)
+                break;
+
+            root = update(root, 0, n - 1, a, b, line_at, face_at);
+        }
+
+        slab_x.push_back(x);
+        slab_root.push_back(root);
+    }
+
+    if (!valid) {
+        nodes.clear();
+        slab_x.clear();
+        slab_root.clear();
+    }
+
+    //release memory used only for building
+    std::vector<Crossing>().swap(crossings);
+    std::vector<unsigned>().swap(left_faces);
+} //end build()
+
+bool PointLocator::is_built() const
+{
+    return built;
+}
+
+bool PointLocator::is_valid() const
+{
+    return built && valid;
+}
+
+//returns a view of this index
+PointLocator::View PointLocator::view() const
+{
+    return View{ slopes.data(), intercepts.data(), static_cast<unsigned>(slopes.size()),
+        nodes.data(), static_cast<unsigned>(nodes.size()),
+        slab_x.data(), slab_root.data(), static_cast<unsigned>(slab_x.size()),
+        top_face };
+}
+
+//returns the ID of the face containing the point (x_coord, y_coord)
+long PointLocator::find_face(double x_coord, double y_coord) const
+{
+    return view().find_face(x_coord, y_coord);
+}
+
+//finds the face containing each of the given points, which must be sorted by x-coordinate
+std::vector<long> PointLocator::find_faces(const std::vector<std::pair<double, double>>& points) const
+{
+    return view().find_faces(points);
+}
+
+//returns the ID of the face containing the point (x_coord, y_coord)
+long PointLocator::View::find_face(double x_coord, double y_coord) const
+{
+    if (num_lines == 0)
+        return top_face;
+
+    //find the slab containing x_coord: the last slab whose left boundary is not greater than x_coord
+    const double* it = std::upper_bound(slab_x, slab_x + num_slabs, x_coord);
+    return find_face_in_slab((it == slab_x) ? 0 : (it - slab_x - 1), x_coord, y_coord);
+} //end find_face()
+
+//finds the face containing each of the given points, which must be sorted by x-coordinate
+std::vector<long> PointLocator::View::find_faces(const std::vector<std::pair<double, double>>& points) const
+{
+    std::vector<long> found(points.size(), top_face);
+    if (num_lines == 0)
+        return found;
+
+    unsigned slab = 0;
+    for (unsigned i = 0; i < points.size(); i++) {
+        //advance to the last slab whose left boundary is not greater than the x-coordinate of this point;
+        //  as the points are sorted, only the slabs to the right of the current one need to be searched
+        slab = std::upper_bound(slab_x + slab + 1, slab_x + num_slabs, points[i].first) - slab_x - 1;
+        found[i] = find_face_in_slab(slab, points[i].first, points[i].second);
+    }
+    return found;
+} //end find_faces()
+
+//returns the ID of the face containing the point (x_coord, y_coord), which must be in the given slab
+long PointLocator::View::find_face_in_slab(unsigned slab, double x_coord, double y_coord) const
+{
+    unsigned node = slab_root[slab];
+
+    //find the lowest line that is above the point
+    unsigned lo = 0;
+    unsigned hi = num_lines - 1;
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        if (is_below(nodes[node].line, x_coord, y_coord)) {
+            node = nodes[node].left;
+            hi = mid;
+        } else {
+            node = nodes[node].right;
+            lo = mid + 1;
+        }
+    }
+
+    if (is_below(nodes[node].line, x_coord, y_coord))
+        return nodes[node].face;
+
+    //if we get here, then the point is above all lines
+    return top_face;
+} //end find_face_in_slab()
+
+//creates the tree for the positions lo through hi
+unsigned PointLocator::create(unsigned lo, unsigned hi, const std::vector<unsigned>& line_at, const std::vector<unsigned>& face_at)
+{
+    Node node{ 0, 0, line_at[lo], face_at[lo] };
+    if (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        node.left = create(lo, mid, line_at, face_at);
+        node.right = create(mid + 1, hi, line_at, face_at);
+        node.line = line_at[mid];
+    }
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+//copies the nodes of the given tree that cover positions a through b; all other subtrees are shared with the old tree
+unsigned PointLocator::update(unsigned node, unsigned lo, unsigned hi, unsigned a, unsigned b, const std::vector<unsigned>& line_at, const std::vector<unsigned>& face_at)
+{
+    Node copy = nodes[node];
+    if (lo == hi) {
+        copy.line = line_at[lo];
+        copy.face = face_at[lo];
+    } else {
+        unsigned mid = (lo + hi) / 2;
+        if (a <= mid)
+            copy.left = update(copy.left, lo, mid, a, b, line_at, face_at);
+        if (b > mid)
+            copy.right = update(copy.right, mid + 1, hi, a, b, line_at, face_at);
+        copy.line = line_at[mid];
+    }
+    nodes.push_back(copy);
+    return nodes.size() - 1;
+}
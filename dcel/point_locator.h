@@ -0,0 +1,126 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+/**
+ * \class	PointLocator
+ * \brief	Answers point-location queries in the line arrangement in logarithmic time.
+ *
+ * The strip x >= 0 of the dual plane is cut into vertical slabs at the x-coordinates of the interior vertices of the arrangement.
+ * Within a slab, the anchor lines have a fixed order from bottom to top, and crossing a vertex only reorders the lines through that vertex.
+ * Each slab therefore stores its order as a persistent binary tree over line positions, sharing all unchanged subtrees with the previous slab,
+ * so the index uses O(V log n) memory for V vertices and n lines, and a query is a binary search for the slab followed by a descent of its tree.
+ */
+
+#ifndef __POINT_LOCATOR_H__
+#define __POINT_LOCATOR_H__
+
+#include <utility>
+#include <vector>
+
+class PointLocator {
+public:
+    PointLocator(); //creates an empty index
+
+    //starts a new index for the lines y = slopes[i]*x - intercepts[i], which must be ordered from bottom to top just to the right of the left edge (x = 0)
+    //  below[i] is the ID of the face directly below line i at the left edge, and top is the ID of the face above all lines
+    void initialize(const std::vector<double>& slopes, const std::vector<double>& intercepts, const std::vector<long>& below, long top);
+
+    //records an interior vertex of the arrangement with the given x-coordinate
+    //  lines contains, for each line through the vertex, the index of the line and the ID of the face directly below it just to the right of the vertex
+    void add_crossing(double x, const std::vector<std::pair<unsigned, long>>& lines);
+
+    //builds the slabs from the recorded crossings; must be called after all crossings have been added
+    void build();
+
+    bool is_built() const; //returns true iff build() has been called since the last call to initialize()
+    bool is_valid() const; //returns true iff the index was built and is consistent with the arrangement, so that find_face() may be used
+
+    //returns the ID of the face containing the point (x_coord, y_coord), where x_coord >= 0
+    long find_face(double x_coord, double y_coord) const;
+
+    //finds the face containing each of the given points, which must be sorted by x-coordinate;
+    //  the slabs are visited in a single left-to-right sweep, each point searching only the slabs from that of the previous point
+    std::vector<long> find_faces(const std::vector<std::pair<double, double>>& points) const;
+
+    //node of the persistent tree; the layout is fixed, since nodes are written to flat module invariants files
+    struct Node {
+        unsigned left; //child covering the lower half of the positions (internal nodes only)
+        unsigned right; //child covering the upper half of the positions (internal nodes only)
+        unsigned line; //for a leaf, the line at this position; for an internal node, the line at the last position of the left child
+        unsigned face; //face directly below the line at this position (leaves only)
+    };
+
+    //read-only arrays describing a built index, which may belong to a PointLocator or to a memory-mapped file
+    struct View {
+        const double* slopes; //slope of each line
+        const double* intercepts; //each line is y = slope*x - intercept
+        unsigned num_lines;
+        const Node* nodes; //all tree nodes, shared between slabs
+        unsigned num_nodes;
+        const double* slab_x; //x-coordinate of the left boundary of each slab, in increasing order
+        const unsigned* slab_root; //root node of the tree for each slab
+        unsigned num_slabs;
+        unsigned top_face; //face above all lines (the same in every slab)
+
+        //as PointLocator::find_face() and PointLocator::find_faces()
+        long find_face(double x_coord, double y_coord) const;
+        std::vector<long> find_faces(const std::vector<std::pair<double, double>>& points) const;
+
+        //returns true iff the point (x, y) is in a face below the given line
+        //  a point on the line is in the face to its left, as in the face walk of Arrangement::find_point(); this is the face below the line unless the slope is positive
+        bool is_below(unsigned line, double x, double y) const
+        {
+            double line_y = slopes[line] * x - intercepts[line];
+            return y < line_y || (y == line_y && slopes[line] <= 0);
+        }
+
+        //returns the ID of the face containing the point (x_coord, y_coord), which must be in the given slab
+        long find_face_in_slab(unsigned slab, double x_coord, double y_coord) const;
+    };
+
+    View view() const; //returns a view of this index, valid until the index is modified or destroyed
+
+private:
+    struct Crossing {
+        double x; //x-coordinate of the vertex
+        std::vector<std::pair<unsigned, long>> lines; //lines through the vertex, with the faces below them to the right of the vertex
+    };
+
+    std::vector<double> slopes; //slope of each line
+    std::vector<double> intercepts; //each line is y = slope*x - intercept
+    std::vector<unsigned> left_faces; //face below each line at the left edge; cleared by build()
+    unsigned top_face; //face above all lines (the same in every slab)
+
+    std::vector<Node> nodes; //all tree nodes, shared between slabs
+    std::vector<double> slab_x; //x-coordinate of the left boundary of each slab, in increasing order
+    std::vector<unsigned> slab_root; //root node of the tree for each slab
+
+    std::vector<Crossing> crossings; //crossings recorded since initialize(); cleared by build()
+    bool built;
+    bool valid;
+
+    //creates the tree for the positions lo through hi, using the given lines and faces at each position
+    unsigned create(unsigned lo, unsigned hi, const std::vector<unsigned>& line_at, const std::vector<unsigned>& face_at);
+
+    //copies the nodes of the given tree that cover positions a through b, taking new values from line_at and face_at; returns the new root
+    unsigned update(unsigned node, unsigned lo, unsigned hi, unsigned a, unsigned b, const std::vector<unsigned>& line_at, const std::vector<unsigned>& face_at);
+};
+
+#endif // __POINT_LOCATOR_H__
@@ -0,0 +1,318 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "binary_array.h"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char BinaryArray::RAW_MAGIC[8] = { 'R', 'I', 'V', 'E', 'T', 'b', 'i', 'n' };
+const char BinaryArray::NPY_MAGIC[6] = { '\x93', 'N', 'U', 'M', 'P', 'Y' };
+
+namespace {
+
+bool host_is_little_endian()
+{
+    const uint16_t one = 1;
+    unsigned char first;
+    std::memcpy(&first, &one, 1);
+    return first == 1;
+}
+
+//reads an unsigned integer of the given size (at most 8 bytes) stored little-endian at p
+uint64_t read_little_endian(const char* p, unsigned size)
+{
+    uint64_t value = 0;
+    for (unsigned i = size; i > 0; i--)
+        value = (value << 8) | static_cast<unsigned char>(p[i - 1]);
+    return value;
+}
+
+void write_little_endian(std::ostream& out, uint64_t value, unsigned size)
+{
+    for (unsigned i = 0; i < size; i++) {
+        out.put(static_cast<char>(value & 0xff));
+        value >>= 8;
+    }
+}
+
+//reads a value of the given size (4 or 8 bytes) and byte order at p
+double read_value(const char* p, unsigned size, bool swap)
+{
+    char bytes[8];
+    for (unsigned i = 0; i < size; i++)
+        bytes[i] = swap ? p[size - 1 - i] : p[i];
+
+    if (size == 4) {
+        float value;
+        std::memcpy(&value, bytes, 4);
+        return value;
+    }
+    double value;
+    std::memcpy(&value, bytes, 8);
+    return value;
+}
+
+//returns the text following 'key': in the header of a .npy file, or throws if the key is missing
+std::string npy_field(const std::string& header, const std::string& key)
+{
+    std::size_t pos = header.find("'" + key + "'");
+    if (pos == std::string::npos)
+        throw std::runtime_error("Invalid .npy file: the header has no " + key + " field.");
+    pos = header.find(':', pos);
+    if (pos == std::string::npos)
+        throw std::runtime_error("Invalid .npy file: could not read the " + key + " field.");
+    pos = header.find_first_not_of(" ", pos + 1);
+    return (pos == std::string::npos) ? std::string() : header.substr(pos);
+}
+
+} //end anonymous namespace
+
+//maps the given file into memory and reads its header
+BinaryArray::BinaryArray(const std::string& file_name)
+    : bytes(nullptr)
+    , length(0)
+    , mapping(nullptr)
+    , data_kind(UNKNOWN)
+    , num_rows(0)
+    , num_cols(0)
+    , one_dimensional(false)
+    , values(nullptr)
+{
+#ifdef _WIN32
+    //no memory mapping; read the file into a buffer of 8-byte words, so that the values are aligned
+    std::ifstream file(file_name, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        throw std::runtime_error("Could not open input file.");
+    length = file.tellg();
+    file.seekg(0);
+    file_buffer.resize((length + 7) / 8);
+    if (!file.read(reinterpret_cast<char*>(file_buffer.data()), length))
+        throw std::runtime_error("Could not read input file.");
+    bytes = reinterpret_cast<const char*>(file_buffer.data());
+#else
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Could not open input file.");
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not read input file.");
+    }
+    length = info.st_size;
+    if (length > 0) {
+        mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            mapping = nullptr;
+            throw std::runtime_error("Could not map input file into memory.");
+        }
+        bytes = static_cast<const char*>(mapping);
+    }
+    ::close(fd); //the mapping remains valid after the file is closed
+#endif
+
+    try {
+        if (length >= sizeof(RAW_MAGIC) && std::memcmp(bytes, RAW_MAGIC, sizeof(RAW_MAGIC)) == 0)
+            read_raw();
+        else if (length >= sizeof(NPY_MAGIC) && std::memcmp(bytes, NPY_MAGIC, sizeof(NPY_MAGIC)) == 0)
+            read_npy();
+        else
+            throw std::runtime_error("Input file is not a binary array.");
+    } catch (...) {
+#ifndef _WIN32
+        if (mapping != nullptr)
+            munmap(mapping, length);
+#endif
+        throw;
+    }
+}
+
+BinaryArray::~BinaryArray()
+{
+#ifndef _WIN32
+    if (mapping != nullptr)
+        munmap(mapping, length);
+#endif
+}
+
+bool BinaryArray::is_binary_array(const std::string& file_name)
+{
+    std::ifstream file(file_name, std::ios::binary);
+    char start[sizeof(RAW_MAGIC)];
+    if (!file.read(start, sizeof(start)))
+        return false;
+    return std::memcmp(start, RAW_MAGIC, sizeof(RAW_MAGIC)) == 0
+        || std::memcmp(start, NPY_MAGIC, sizeof(NPY_MAGIC)) == 0;
+}
+
+void BinaryArray::write(std::ostream& out, Kind kind, uint64_t rows, uint64_t cols, const double* values)
+{
+    out.write(RAW_MAGIC, sizeof(RAW_MAGIC));
+    write_little_endian(out, RAW_VERSION, 4);
+    write_little_endian(out, kind, 4);
+    write_little_endian(out, rows, 8);
+    write_little_endian(out, cols, 8);
+    for (uint64_t i = 0; i < rows * cols; i++) {
+        uint64_t bits;
+        std::memcpy(&bits, &values[i], 8);
+        write_little_endian(out, bits, 8);
+    }
+}
+
+BinaryArray::Kind BinaryArray::kind() const
+{
+    return data_kind;
+}
+
+std::size_t BinaryArray::rows() const
+{
+    return num_rows;
+}
+
+std::size_t BinaryArray::cols() const
+{
+    return num_cols;
+}
+
+bool BinaryArray::is_one_dimensional() const
+{
+    return one_dimensional;
+}
+
+const double* BinaryArray::data() const
+{
+    return values;
+}
+
+//reads the header of a file in RIVET's raw format
+void BinaryArray::read_raw()
+{
+    if (length < RAW_HEADER_SIZE)
+        throw std::runtime_error("Invalid binary file: the header is incomplete.");
+
+    uint64_t version = read_little_endian(bytes + 8, 4);
+    if (version != RAW_VERSION)
+        throw std::runtime_error("Unsupported version " + std::to_string(version) + " of the binary file format.");
+
+    uint64_t kind = read_little_endian(bytes + 12, 4);
+    if (kind != POINTS && kind != DISTANCES)
+        throw std::runtime_error("Invalid binary file: unknown kind of data " + std::to_string(kind) + ".");
+    data_kind = static_cast<Kind>(kind);
+
+    num_rows = read_little_endian(bytes + 16, 8);
+    num_cols = read_little_endian(bytes + 24, 8);
+    read_payload(RAW_HEADER_SIZE, 8, false, false);
+}
+
+//reads the header of a .npy file; see https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+void BinaryArray::read_npy()
+{
+    if (length < 10)
+        throw std::runtime_error("Invalid .npy file: the header is incomplete.");
+
+    unsigned major = static_cast<unsigned char>(bytes[6]);
+    unsigned size_length = (major == 1) ? 2 : 4; //versions 2 and 3 store the header length in 4 bytes
+    if (major < 1 || major > 3)
+        throw std::runtime_error("Unsupported version " + std::to_string(major) + " of the .npy file format.");
+    if (length < 8 + size_length)
+        throw std::runtime_error("Invalid .npy file: the header is incomplete.");
+
+    std::size_t header_start = 8 + size_length;
+    std::size_t header_length = read_little_endian(bytes + 8, size_length);
+    if (header_length > length - header_start)
+        throw std::runtime_error("Invalid .npy file: the header is incomplete.");
+    std::string header(bytes + header_start, header_length);
+
+    //data type: a byte order ('<', '>', '|' or '=') followed by f4 or f8
+    std::string descr = npy_field(header, "descr");
+    if (descr.size() < 5 || (descr[0] != '\'' && descr[0] != '"') || descr[4] != descr[0]
+        || descr[2] != 'f' || (descr[3] != '4' && descr[3] != '8'))
+        throw std::runtime_error("Unsupported .npy data type " + descr.substr(0, descr.find(',')) + "; the values must be float64 or float32.");
+    bool big_endian = (descr[1] == '>') || (descr[1] == '=' && !host_is_little_endian());
+    unsigned elt_size = descr[3] - '0';
+
+    bool fortran_order = (npy_field(header, "fortran_order").compare(0, 4, "True") == 0);
+
+    //shape: (m,) or (m, n)
+    std::string shape = npy_field(header, "shape");
+    std::size_t close = shape.find(')');
+    if (shape.empty() || shape[0] != '(' || close == std::string::npos)
+        throw std::runtime_error("Invalid .npy file: could not read the shape field.");
+    std::vector<std::size_t> dims;
+    for (std::size_t pos = 1; pos < close;) {
+        pos = shape.find_first_not_of(" ,", pos);
+        if (pos >= close)
+            break;
+        std::size_t stop = shape.find_first_not_of("0123456789", pos);
+        if (stop == pos)
+            throw std::runtime_error("Invalid .npy file: could not read the shape field.");
+        dims.push_back(std::stoull(shape.substr(pos, stop - pos)));
+        pos = stop;
+    }
+    if (dims.size() == 1) {
+        num_rows = dims[0];
+        num_cols = 1;
+        one_dimensional = true;
+    } else if (dims.size() == 2) {
+        num_rows = dims[0];
+        num_cols = dims[1];
+    } else {
+        throw std::runtime_error("Unsupported .npy array with " + std::to_string(dims.size()) + " dimensions; the array must have one or two dimensions.");
+    }
+
+    read_payload(header_start + header_length, elt_size, big_endian, fortran_order);
+}
+
+//uses the values in place if possible, and converts them to row-major doubles in native byte order otherwise
+void BinaryArray::read_payload(std::size_t offset, unsigned elt_size, bool big_endian, bool fortran_order)
+{
+    if (num_cols != 0 && num_rows > std::numeric_limits<std::size_t>::max() / num_cols / elt_size)
+        throw std::runtime_error("Invalid binary file: the array is too large.");
+    std::size_t count = num_rows * num_cols;
+    if (length < offset || (length - offset) / elt_size < count)
+        throw std::runtime_error("Invalid binary file: expected " + std::to_string(count) + " values, but the file is too short.");
+
+    const char* payload = bytes + offset;
+    bool swap = (big_endian == host_is_little_endian());
+
+    if (elt_size == 8 && !swap && (!fortran_order || num_rows <= 1 || num_cols <= 1)
+        && reinterpret_cast<std::uintptr_t>(payload) % alignof(double) == 0) {
+        values = reinterpret_cast<const double*>(payload);
+        return;
+    }
+
+    converted.resize(count);
+    for (std::size_t i = 0; i < num_rows; i++)
+        for (std::size_t j = 0; j < num_cols; j++) {
+            std::size_t k = fortran_order ? j * num_rows + i : i * num_cols + j;
+            converted[i * num_cols + j] = read_value(payload + k * elt_size, elt_size, swap);
+        }
+    values = converted.data();
+}
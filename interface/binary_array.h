@@ -0,0 +1,93 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	BinaryArray
+ * \brief	Reads a two-dimensional array of floating-point values from a binary file, for point-cloud and distance-matrix input.
+ *
+ * Two formats are recognized by their first bytes:
+ *  - RIVET's raw format: the 8 characters "RIVETbin", then the format version, the kind of data (POINTS or DISTANCES),
+ *    the number of rows and the number of columns (as unsigned 32-, 32-, 64- and 64-bit integers), then the values as
+ *    float64, row by row; all numbers are little-endian.
+ *  - NumPy's .npy format, with dtype float64 or float32 in either byte order; a one-dimensional array of length m
+ *    is read as m rows of one column. A .npy file does not say what kind of data it holds, so its kind is UNKNOWN.
+ * The file is memory-mapped, and little-endian float64 values are used in place; other values are converted.
+ */
+
+#ifndef BINARY_ARRAY_H
+#define BINARY_ARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class BinaryArray {
+public:
+    enum Kind {
+        POINTS = 0, //one point per row
+        DISTANCES = 1, //a full distance matrix, or the entries above its diagonal in a single row, row by row
+        UNKNOWN = 2
+    };
+
+    BinaryArray(const std::string& file_name); //maps the file into memory; throws std::runtime_error if it is not a valid binary array
+    ~BinaryArray();
+
+    BinaryArray(const BinaryArray&) = delete;
+    BinaryArray& operator=(const BinaryArray&) = delete;
+
+    //returns true iff the file begins with the signature of one of the binary formats
+    static bool is_binary_array(const std::string& file_name);
+
+    //writes values, which has rows * cols entries stored row by row, in RIVET's raw format
+    static void write(std::ostream& out, Kind kind, uint64_t rows, uint64_t cols, const double* values);
+
+    Kind kind() const;
+    std::size_t rows() const;
+    std::size_t cols() const;
+    bool is_one_dimensional() const; //returns true iff the file stores a one-dimensional array, which is read as a single column
+    const double* data() const; //the value in row i and column j is data()[i * cols() + j]
+
+private:
+    static const char RAW_MAGIC[8];
+    static const char NPY_MAGIC[6];
+    static const uint32_t RAW_VERSION = 1;
+    static const std::size_t RAW_HEADER_SIZE = 32;
+
+    const char* bytes; //start of the file
+    std::size_t length;
+    void* mapping; //memory mapping of the file, if any
+    std::vector<uint64_t> file_buffer; //copy of the file, if it was not mapped
+
+    Kind data_kind;
+    std::size_t num_rows;
+    std::size_t num_cols;
+    bool one_dimensional; //true iff the array has shape (m,), rather than (m, 1) or (1, m)
+    const double* values;
+    std::vector<double> converted; //values, if they could not be used in place
+
+    void read_raw();
+    void read_npy();
+
+    //reads the payload, which starts at offset and has element size elt_size (4 or 8), byte order big_endian, and is stored column by column iff fortran_order
+    void read_payload(std::size_t offset, unsigned elt_size, bool big_endian, bool fortran_order);
+};
+
+#endif // BINARY_ARRAY_H
@@ -40,53 +40,129 @@ extern "C" void free_rivet_computation_result(RivetComputationResult result)
     }
 }
 
+namespace {
+//converts the results of a barcode query into the C representation
+BarCodesResult to_barcodes_result(std::vector<std::unique_ptr<Barcode>>& query_results, double* angles, double* offsets)
+{
+    BarCodesResult result;
+    auto barcodes = new BarCode[query_results.size()];
+    for (size_t i = 0; i < query_results.size(); i++) {
+        auto query_barcode = std::shared_ptr<Barcode>(std::move(query_results[i]));
+        barcodes[i].bars = new Bar[query_barcode->size()];
+        auto it = query_barcode->begin();
+        for (size_t b = 0; b < query_barcode->size(); b++) {
+            barcodes[i].bars[b] = Bar{ it->birth, it->death, it->multiplicity };
+            it++;
+        }
+        barcodes[i].length = query_barcode->size();
+        barcodes[i].angle = angles[i];
+        barcodes[i].offset = offsets[i];
+    }
+    result.barcodes = barcodes;
+    result.length = query_results.size();
+    result.error = nullptr;
+    result.error_length = 0;
+    return result;
+}
+
+BarCodesResult barcodes_error(std::exception& e)
+{
+    BarCodesResult result;
+    size_t len = strlen(e.what());
+    result.barcodes = nullptr;
+    result.length = 0;
+    result.error = new char[len];
+    result.error_length = len;
+    strncpy(result.error, e.what(), len);
+    return result;
+}
+
+std::vector<std::pair<double, double>> to_queries(double* angles, double* offsets, size_t query_length)
+{
+    std::vector<std::pair<double, double>> pos;
+    for (size_t i = 0; i < query_length; i++) {
+        pos.emplace_back(angles[i], offsets[i]);
+    }
+    return pos;
+}
+}
+
 extern "C" BarCodesResult barcodes_from_computation(RivetComputation* rivet_computation,
     double* angles,
     double* offsets,
     size_t query_length)
 {
-    BarCodesResult result;
     try {
         ComputationResult* computation = reinterpret_cast<ComputationResult*>(rivet_computation);
-
-        std::vector<std::pair<double, double>> pos;
-        for (size_t i = 0; i < query_length; i++) {
-            pos.emplace_back(angles[i], offsets[i]);
-        }
-        auto query_results = query_barcodes(*computation, pos);
-        auto barcodes = new BarCode[query_results.size()];
-        for (size_t i = 0; i < query_length; i++) {
-            auto query_barcode = std::shared_ptr<Barcode>(std::move(query_results[i]));
-            barcodes[i].bars = new Bar[query_barcode->size()];
-            auto it = query_barcode->begin();
-            for (size_t b = 0; b < query_barcode->size(); b++) {
-                barcodes[i].bars[b] = Bar{ it->birth, it->death, it->multiplicity };
-                it++;
-            }
-            barcodes[i].length = query_barcode->size();
-            barcodes[i].angle = angles[i];
-            barcodes[i].offset = offsets[i];
-        }
+        auto query_results = query_barcodes(*computation, to_queries(angles, offsets, query_length));
         //        Bounds bounds = compute_bounds(*computation);
-        result.barcodes = barcodes;
-        result.length = query_results.size();
+        return to_barcodes_result(query_results, angles, offsets);
+    } catch (std::exception& e) {
+        return barcodes_error(e);
+    }
+}
+
+extern "C" ArrangementBounds bounds_from_computation(RivetComputation* rivet_computation)
+{
+    ComputationResult* computation = reinterpret_cast<ComputationResult*>(rivet_computation);
+    auto bounds = compute_bounds(*computation);
+    return ArrangementBounds{
+        bounds.x_low,
+        bounds.y_low,
+        bounds.x_high,
+        bounds.y_high
+    };
+}
+
+namespace {
+//creates a FlatModuleInvariants with the given function, catching any error
+template <typename Source>
+RivetFlatResult make_flat_result(Source source)
+{
+    RivetFlatResult result;
+    try {
+        result.flat = reinterpret_cast<RivetFlat*>(source());
         result.error = nullptr;
         result.error_length = 0;
     } catch (std::exception& e) {
+        result.flat = nullptr;
         size_t len = strlen(e.what());
-        result.barcodes = nullptr;
-        result.length = 0;
         result.error = new char[len];
         result.error_length = len;
         strncpy(result.error, e.what(), len);
     }
     return result;
 }
+}
 
-extern "C" ArrangementBounds bounds_from_computation(RivetComputation* rivet_computation)
+extern "C" RivetFlatResult open_rivet_flat(const char* file_name)
 {
-    ComputationResult* computation = reinterpret_cast<ComputationResult*>(rivet_computation);
-    auto bounds = compute_bounds(*computation);
+    return make_flat_result([file_name] { return new FlatModuleInvariants(std::string(file_name)); });
+}
+
+extern "C" RivetFlatResult read_rivet_flat(const char* bytes, size_t length)
+{
+    return make_flat_result([bytes, length] { return new FlatModuleInvariants(bytes, length); });
+}
+
+extern "C" BarCodesResult barcodes_from_flat(RivetFlat* rivet_flat,
+    double* angles,
+    double* offsets,
+    size_t query_length)
+{
+    try {
+        FlatModuleInvariants* flat = reinterpret_cast<FlatModuleInvariants*>(rivet_flat);
+        auto query_results = query_barcodes(*flat, to_queries(angles, offsets, query_length));
+        return to_barcodes_result(query_results, angles, offsets);
+    } catch (std::exception& e) {
+        return barcodes_error(e);
+    }
+}
+
+extern "C" ArrangementBounds bounds_from_flat(RivetFlat* rivet_flat)
+{
+    FlatModuleInvariants* flat = reinterpret_cast<FlatModuleInvariants*>(rivet_flat);
+    auto bounds = compute_bounds(*flat);
     return ArrangementBounds{
         bounds.x_low,
         bounds.y_low,
@@ -95,6 +171,15 @@ extern "C" ArrangementBounds bounds_from_computation(RivetComputation* rivet_com
     };
 }
 
+extern "C" void free_rivet_flat_result(RivetFlatResult result)
+{
+    if (result.flat != nullptr) {
+        delete reinterpret_cast<FlatModuleInvariants*>(result.flat);
+    } else {
+        delete[] result.error;
+    }
+}
+
 extern "C" void free_barcodes_result(BarCodesResult result)
 {
     if (result.barcodes != nullptr) {
@@ -74,6 +74,28 @@ void free_rivet_computation_result(RivetComputationResult rivet_computation);
 
 void free_barcodes_result(BarCodesResult result);
 
+//flat module invariants files (written by rivet_console -f flat) are queried in place, without building the arrangement
+struct rivet_flat;
+typedef rivet_flat RivetFlat;
+
+typedef struct {
+    RivetFlat* flat;
+    char* error;
+    size_t error_length;
+} RivetFlatResult;
+
+RivetFlatResult open_rivet_flat(const char* file_name); //maps the file into memory
+RivetFlatResult read_rivet_flat(const char* bytes, size_t length); //copies the bytes
+
+BarCodesResult barcodes_from_flat(RivetFlat* rivet_flat,
+    double* angles,
+    double* offsets,
+    size_t query_length);
+
+ArrangementBounds bounds_from_flat(RivetFlat* rivet_flat);
+
+void free_rivet_flat_result(RivetFlatResult result);
+
 typedef struct {
     int64_t nom;
     int64_t denom;
@@ -23,13 +23,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "../debug.h"
 #include "../math/bifiltration_data.h"
 #include "../math/distance_matrix.h"
-#include "file_input_reader.h"
+#include "../math/grade_discretizer.h"
+#include "../math/greedy_permutation.h"
+#include "binary_array.h"
+#include "file_tokenizer.h"
 #include "input_parameters.h"
 
 #include <algorithm>
 #include <api.h>
 #include <boost/algorithm/string.hpp>
+#include <cmath>
 #include <dcel/arrangement_message.h>
+#include <fstream>
+#include <iterator>
+#include <limits>
 #include <map>
 #include <memory>
 #include <set>
@@ -37,9 +44,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 
 #include <ctime>
+#include <exception>
 
-//epsilon value for use in comparisons
-double ExactValue::epsilon = pow(2, -30);
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 // FileContent stores the data
 FileContent::FileContent()
@@ -83,6 +92,96 @@ FileContent::FileContent(const FileContent& other)
 //==================== DataReader class ====================
 using namespace rivet::numeric;
 
+namespace {
+
+//number of parts into which the lines of a text file are split, so that the parts can be read in parallel
+//  there are more parts than threads, since the lines of a file may differ in length
+unsigned num_text_parts()
+{
+    unsigned num_threads = 1;
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+    return (num_threads > 1) ? 4 * num_threads : 1;
+}
+
+//simplices read from consecutive lines of a bifiltration file
+struct SimplexPart {
+    std::vector<std::pair<std::vector<int>, unsigned>> simplices; //vertices and number of grades of appearance of each simplex
+    std::vector<SmallRational> x_values, y_values; //grades of appearance of the simplices, in order
+    std::exception_ptr error; //the first error in these lines, if any
+};
+
+//reads one line of a bifiltration file, which gives the vertices of a simplex and its grades of appearance
+void read_simplex(const std::vector<FileTokenizer::Token>& tokens, unsigned line_number, bool x_reverse, bool y_reverse, SimplexPart& part)
+{
+    try {
+        if (tokens.size() > std::numeric_limits<unsigned>::max()) {
+            throw InputError(line_number,
+                "line longer than " + std::to_string(std::numeric_limits<unsigned>::max()) + " tokens");
+        }
+
+        //read vertices
+        unsigned pos = 0;
+        std::vector<int> verts;
+        while (tokens.at(pos).at(0) != ';') {
+            int v = tokens[pos].to_int();
+            verts.push_back(v);
+            pos++;
+        }
+        pos++;
+        unsigned grades = (tokens.size() - pos) / 2; //remaining tokens are xy pairs
+        for (unsigned i = 0; i < grades; i++) {
+            SmallRational x = tokens.at(pos).to_rational();
+            SmallRational y = tokens.at(pos + 1).to_rational();
+            part.x_values.push_back(x_reverse ? -x : x);
+            part.y_values.push_back(y_reverse ? -y : y);
+            pos += 2;
+        }
+
+        part.simplices.push_back({ std::move(verts), grades });
+    } catch (std::exception& e) {
+        throw InputError(line_number, "Could not read vertex: " + std::string(e.what()));
+    }
+}
+
+//columns read from consecutive lines of a FIRep file
+struct ColumnPart {
+    std::vector<SmallRational> x_values, y_values; //grade of each column
+    std::vector<std::vector<unsigned>> columns; //row indexes of the nonzero entries of each column, not yet checked against the number of rows
+    std::vector<unsigned> line_numbers; //line of the file that gives each column
+    std::exception_ptr error; //the first error in these lines, if any
+    unsigned error_line = 0; //line of the first error
+};
+
+//reads one line of a FIRep file, which gives the grade of a column of a matrix and its nonzero entries
+void read_column(const std::vector<FileTokenizer::Token>& row, unsigned line_number, bool x_reverse, bool y_reverse, ColumnPart& part)
+{
+    try {
+        SmallRational x = row.at(0).to_rational();
+        SmallRational y = row.at(1).to_rational();
+        if (row.at(2).at(0) != ';') {
+            throw InputError(line_number, "Expected ';' after coordinates");
+        }
+        std::vector<unsigned> column;
+        for (unsigned pos = 3; pos < row.size(); pos++) {
+            int v = row[pos].to_int();
+            if (v < 0) {
+                throw InputError(line_number, "Matrix index input out of bounds.");
+            }
+            column.push_back(v);
+        }
+        part.x_values.push_back(x_reverse ? -x : x);
+        part.y_values.push_back(y_reverse ? -y : y);
+        part.columns.push_back(std::move(column));
+        part.line_numbers.push_back(line_number);
+    } catch (std::exception& e) {
+        throw InputError(line_number, "Could not read matrix: " + std::string(e.what()));
+    }
+}
+
+} //end anonymous namespace
+
 //constructor
 DataReader::DataReader(InputParameters& params)
     : input_params(params)
@@ -95,6 +194,10 @@ DataReader::DataReader(InputParameters& params)
         std::bind(&DataReader::read_discrete_metric_space, this, std::placeholders::_1, std::placeholders::_2) });
     register_file_type(FileType{ "metric_fn", "metric data with function", true,
         std::bind(&DataReader::read_discrete_metric_space, this, std::placeholders::_1, std::placeholders::_2) });
+    register_file_type(FileType{ "points_binary", "binary point-cloud data", true,
+        std::bind(&DataReader::read_binary_point_cloud, this, std::placeholders::_1, std::placeholders::_2) });
+    register_file_type(FileType{ "metric_binary", "binary metric data", true,
+        std::bind(&DataReader::read_binary_metric_space, this, std::placeholders::_1, std::placeholders::_2) });
     register_file_type(FileType{ "bifiltration", "bifiltration data", true,
         std::bind(&DataReader::read_bifiltration, this, std::placeholders::_1, std::placeholders::_2) });
     register_file_type(FileType{ "firep", "free implicit representation data", true,
@@ -122,18 +225,17 @@ FileContent DataReader::process(Progress& progress)
     if (verbosity >= 2) {
         debug() << "READING FILE:" << input_params.fileName.c_str();
     }
-    std::ifstream infile(input_params.fileName); //input file
-    if (!infile.is_open()) {
-        throw std::runtime_error("Could not open input file.");
-    }
-    // register_file_type() determines what function the parser is
-    auto data = file_type.parser(infile, progress);
+    // register_file_type() determines what function the parser is; each parser opens the file itself
+    auto data = file_type.parser(input_params.fileName, progress);
     return data;
 }
 
-FileContent DataReader::read_messagepack(std::ifstream& stream, Progress& progress)
+FileContent DataReader::read_messagepack(const std::string& file_name, Progress& progress)
 {
-
+    std::ifstream stream(file_name, std::ios::binary);
+    if (!stream.is_open()) {
+        throw std::runtime_error("Could not open input file.");
+    }
     std::string type;
     std::getline(stream, type);
     InputParameters params;
@@ -166,8 +268,9 @@ FileContent DataReader::read_messagepack(std::ifstream& stream, Progress& progre
         throw std::runtime_error("Could not process template points section, bad encoding?");
     }
     pac.next(oh);
+    auto m3 = oh.get();
+    ArrangementMessage::check_format(m3);
     try {
-        auto m3 = oh.get();
         m3.convert(arrangementMessage);
         progress.progress(100);
     } catch (const std::exception& e) {
@@ -180,9 +283,9 @@ FileContent DataReader::read_messagepack(std::ifstream& stream, Progress& progre
 //reads a point cloud
 //  points are given by coordinates in Euclidean space, and each point has a "birth time" unless no function specified
 //  stores the bifiltered Bifiltration/Vietoris-Rips complex in BifiltrationData
-FileContent DataReader::read_point_cloud(std::ifstream& stream, Progress& progress)
+FileContent DataReader::read_point_cloud(const std::string& file_name, Progress& progress)
 {
-    FileInputReader reader(stream);
+    FileTokenizer reader(file_name);
     auto data = new InputData();
     if (verbosity >= 6) {
         debug() << "DataReader: Found a point cloud file.";
@@ -215,18 +318,12 @@ FileContent DataReader::read_point_cloud(std::ifstream& stream, Progress& progre
 
     std::vector<DataPoint> points;
 
-    std::pair<std::vector<std::string>, unsigned> line_info;
-
     // if a function values exist, read in the function values
-    std::vector<std::string> values;
+    std::vector<FileTokenizer::Token> values;
     if (input_params.new_function) {
         input_params.to_skip++;
         for (int i = 0; i < input_params.to_skip; i++)
-            line_info = reader.next_line(0);
-
-        for (unsigned i = 0; i < line_info.first.size(); i++) {
-            values.push_back(line_info.first[i]);
-        }
+            values = reader.next_line(0);
     } else {
         for (int i = 0; i < input_params.to_skip; i++)
             reader.next_line(0);
@@ -237,12 +334,11 @@ FileContent DataReader::read_point_cloud(std::ifstream& stream, Progress& progre
     try {
         int k = 0;
         while (reader.has_next_line()) {
-            line_info = reader.next_line(0);
+            const std::vector<FileTokenizer::Token>& tokens = reader.next_line(0);
             if (input_params.new_function && k == 0) {
-                dimension = line_info.first.size();
+                dimension = tokens.size();
                 expectedNumTokens = dimension;
             }
-            std::vector<std::string> tokens = line_info.first;
             if (tokens.size() != expectedNumTokens) {
                 std::stringstream ss;
                 ss << "invalid line (should be " << expectedNumTokens << " tokens but was " << tokens.size() << ")"
@@ -257,15 +353,18 @@ FileContent DataReader::read_point_cloud(std::ifstream& stream, Progress& progre
             }
 
             // Add function values if supplied
+            unsigned num_coords = tokens.size();
+            exact birth = 0; //artificial birth value of 0 if no function value provided
             if (input_params.new_function && input_params.bifil == "function") {
-                tokens.push_back(values[k]);
+                birth = values[k].to_exact();
             }
-            else if (!input_params.old_function) {
-                //Add artificial birth value of 0 if no function value provided
-                tokens.push_back("0");
+            else if (input_params.old_function) {
+                //last token is the birth value
+                num_coords--;
+                birth = tokens.back().to_exact();
             }
             k++;
-            DataPoint p(tokens);
+            DataPoint p(tokens, num_coords, birth);
             if (x_reverse && hasFunction) {
                 p.birth *= -1;
             }
@@ -274,7 +373,7 @@ FileContent DataReader::read_point_cloud(std::ifstream& stream, Progress& progre
         }
 
     } catch (std::exception& e) {
-        throw InputError(line_info.second, e.what());
+        throw InputError(reader.line_number(), e.what());
     }
     if (verbosity >= 4) {
         debug() << "  Finished reading" << points.size() << "points. Input finished.";
@@ -284,6 +383,21 @@ FileContent DataReader::read_point_cloud(std::ifstream& stream, Progress& progre
         throw std::runtime_error("No points loaded.");
     }
 
+    // if a number of landmarks is given, keep only the landmarks
+    if (input_params.num_landmarks > 0) {
+        std::vector<double> coords;
+        coords.reserve((size_t)points.size() * dimension);
+        for (const DataPoint& p : points)
+            coords.insert(coords.end(), p.coords.begin(), p.coords.begin() + dimension);
+
+        GreedyPermutation permutation;
+        permutation.build(coords.data(), points.size(), dimension, input_params.num_landmarks);
+        std::vector<DataPoint> landmarks;
+        for (unsigned i : keep_landmarks(permutation, points.size()))
+            landmarks.push_back(std::move(points[i]));
+        points.swap(landmarks);
+    }
+
     // STEP 2: compute distance matrix, and create ordered lists of all unique distance and time values and build grade vectors
 
     if (verbosity >= 4) {
@@ -309,45 +423,7 @@ FileContent DataReader::read_point_cloud(std::ifstream& stream, Progress& progre
     progress.progress(30);
 
     // STEP 3: build the bifiltration
-
-    //bifiltration_data stores only DISCRETE information!
-    //this only requires (suppose there are k points):
-    //  1. a list of k discrete times (if a function is included)
-    //  2. a list of k(k-1)/2 discrete distances
-    //  3. max dimension of simplices to construct, which is one more than the dimension of homology to be computed
-
-    if (verbosity >= 4) {
-        if (input_params.bifil == "degree") {
-            debug() << "  Building Degree-Rips bifiltration.";
-        } else {
-            debug() << "  Building Vietoris-Rips bifiltration.";
-        }
-        debug() << "     x-grades: " << data->x_exact.size();
-        debug() << "     y-grades: " << data->y_exact.size();
-    }
-
-    data->bifiltration_data.reset(new BifiltrationData(input_params.hom_degree, input_params.verbosity));
-    if (input_params.bifil == "degree") {
-        data->bifiltration_data->build_DR_complex(num_points, dist_mat.dist_indexes, dist_mat.degree_indexes, data->x_exact.size(), data->y_exact.size());
-        //convert data->x_exact from codegree sequence to negative degree sequence
-        exact max_x_exact = *(data->x_exact.end() - 1); //should it be max_degree instead?
-        std::transform(data->x_exact.begin(), data->x_exact.end(), data->x_exact.begin(), [max_x_exact](exact x) { return x - max_x_exact; });
-
-    } else {
-        data->bifiltration_data->build_VR_complex(dist_mat.function_indexes, dist_mat.dist_indexes, data->x_exact.size(), data->y_exact.size());
-    }
-
-    if (verbosity >= 8) {
-        int size;
-        size = data->bifiltration_data->get_size(input_params.hom_degree - 1);
-        debug() << "There are" << size << "simplices of dimension" << input_params.hom_degree - 1;
-        size = data->bifiltration_data->get_size(input_params.hom_degree);
-        debug() << "There are" << size << "simplices of dimension" << input_params.hom_degree;
-        size = data->bifiltration_data->get_size(input_params.hom_degree + 1);
-        debug() << "There are" << size << "simplices of dimension" << input_params.hom_degree + 1;
-    }
-
-    data->free_implicit_rep.reset(new FIRep(*(data->bifiltration_data), input_params.verbosity));
+    build_rips_bifiltration(data, dist_mat);
 
     //remember the axis directions
     data->x_reverse = x_reverse;
@@ -358,17 +434,13 @@ FileContent DataReader::read_point_cloud(std::ifstream& stream, Progress& progre
 } //end read_point_cloud()
 
 //reads data representing a discrete metric space with a real-valued function and stores in a BifiltrationData
-FileContent DataReader::read_discrete_metric_space(std::ifstream& stream, Progress& progress)
+FileContent DataReader::read_discrete_metric_space(const std::string& file_name, Progress& progress)
 {
     if (verbosity >= 2) {
         debug() << "DataReader: Found a discrete metric space file.";
     }
     auto data = new InputData();
-    FileInputReader reader(stream);
-
-    //prepare data structures
-    ExactSet value_set; //stores all unique values of the function; must DELETE all elements later
-    ExactSet dist_set; //stores all unique values of the distance metric; must DELETE all elements later
+    FileTokenizer reader(file_name);
 
     // set variables from input parameters
     unsigned num_points = input_params.dimension;
@@ -387,33 +459,38 @@ FileContent DataReader::read_discrete_metric_space(std::ifstream& stream, Progre
 
     exact max_dist = input_params.max_dist;
 
-    std::pair<std::vector<std::string>, unsigned> line_info;
-
     // store function values if supplied
 
-    std::vector<std::string> val;
+    std::vector<FileTokenizer::Token> val;
     if (input_params.old_function) {
         for (int i = 0; i < 3; i++)
-            line_info = reader.next_line(0);
+            val = reader.next_line(0);
 
-        num_points = line_info.first.size();
-        for (unsigned i = 0; i < num_points; i++) {
-            val.push_back(line_info.first[i]);
-        }
+        num_points = val.size();
         for (int i = 0; i < input_params.to_skip - 3; i++)
-            line_info = reader.next_line(0);
+            reader.next_line(0);
     } else if (input_params.new_function) {
         input_params.to_skip++;
         for (int i = 0; i < input_params.to_skip; i++)
-            line_info = reader.next_line(0);
+            val = reader.next_line(0);
 
-        num_points = line_info.first.size();
-        for (unsigned i = 0; i < num_points; i++) {
-            val.push_back(line_info.first[i]);
-        }
+        num_points = val.size();
     } else {
         for (int i = 0; i < input_params.to_skip; i++)
-            line_info = reader.next_line(0);
+            reader.next_line(0);
+    }
+
+    // if a number of landmarks is given, choose them from a first reading of the distances, and keep only their distances below
+    std::vector<unsigned> landmarks;
+    unsigned file_points = num_points;
+    if (input_params.num_landmarks > 0) {
+        std::vector<double> distances;
+        DistanceMatrix::read_distances(input_params, num_points, distances);
+
+        GreedyPermutation permutation;
+        permutation.build_metric(distances.data(), num_points, false, input_params.num_landmarks);
+        landmarks = keep_landmarks(permutation, num_points);
+        num_points = landmarks.size();
     }
 
     // DistanceMatrix builds or reads in the DistanceMatrix
@@ -436,7 +513,7 @@ FileContent DataReader::read_discrete_metric_space(std::ifstream& stream, Progre
             values.reserve(val.size());
 
             for (size_t i = 0; i < val.size(); i++) {
-                values.push_back(xrev_sign * str_to_exact(val.at(i)));
+                values.push_back(xrev_sign * val.at(i).to_exact());
             }
 
         } else {
@@ -454,13 +531,16 @@ FileContent DataReader::read_discrete_metric_space(std::ifstream& stream, Progre
             debug() << "  Maximum distance of edges in Rips complex:" << oss.str().c_str();
         }
 
-        dist_mat.read_distance_matrix(values);
+        if (landmarks.empty())
+            dist_mat.read_distance_matrix(values);
+        else
+            dist_mat.read_distance_matrix(values, landmarks, file_points);
         dist_mat.build_all_vectors(data);
 
     } catch (InputError& e) {
         throw;
     } catch (std::exception& e) {
-        throw InputError(line_info.second, e.what());
+        throw InputError(reader.line_number(), e.what());
     }
     if (verbosity >= 4) {
         debug() << "  Finished reading data.";
@@ -472,6 +552,22 @@ FileContent DataReader::read_discrete_metric_space(std::ifstream& stream, Progre
     progress.progress(30);
 
     // build the bifiltration
+    build_rips_bifiltration(data, dist_mat);
+
+    data->x_reverse = x_reverse;
+    data->y_reverse = y_reverse;
+
+    return FileContent(data);
+} //end read_discrete_metric_space()
+
+//builds the Vietoris-Rips or degree-Rips bifiltration, and its FIRep, from the discrete index vectors of the distance matrix
+void DataReader::build_rips_bifiltration(InputData* data, DistanceMatrix& dist_mat)
+{
+    //bifiltration_data stores only DISCRETE information!
+    //this only requires (suppose there are k points):
+    //  1. a list of k discrete times (if a function is included)
+    //  2. a list of k(k-1)/2 discrete distances, or of the discrete distances of the edges of a NeighborGraph
+    //  3. max dimension of simplices to construct, which is one more than the dimension of homology to be computed
 
     if (verbosity >= 4) {
         if (input_params.bifil == "degree") {
@@ -483,16 +579,20 @@ FileContent DataReader::read_discrete_metric_space(std::ifstream& stream, Progre
         debug() << "     y-grades: " << data->y_exact.size();
     }
 
-    //build the Vietoris-Rips bifiltration from the discrete index vectors
     data->bifiltration_data.reset(new BifiltrationData(input_params.hom_degree, input_params.verbosity));
     if (input_params.bifil == "degree") {
-        data->bifiltration_data->build_DR_complex(num_points, dist_mat.dist_indexes, dist_mat.degree_indexes, data->x_exact.size(), data->y_exact.size());
-
+        //the degree-Rips construction works on the lists of neighbors of the points
+        dist_mat.make_sparse();
+        data->bifiltration_data->build_DR_complex(dist_mat.neighbor_graph, dist_mat.degree_indexes, data->x_exact.size(), data->y_exact.size());
         //convert data->x_exact from codegree sequence to negative degree sequence
         exact max_x_exact = *(data->x_exact.end() - 1); //should it be max_degree instead?
         std::transform(data->x_exact.begin(), data->x_exact.end(), data->x_exact.begin(), [max_x_exact](exact x) { return x - max_x_exact; });
+
     } else {
-        data->bifiltration_data->build_VR_complex(dist_mat.function_indexes, dist_mat.dist_indexes, data->x_exact.size(), data->y_exact.size());
+        if (dist_mat.is_sparse())
+            data->bifiltration_data->build_VR_complex(dist_mat.function_indexes, dist_mat.neighbor_graph, data->x_exact.size(), data->y_exact.size());
+        else
+            data->bifiltration_data->build_VR_complex(dist_mat.function_indexes, dist_mat.dist_indexes, data->x_exact.size(), data->y_exact.size());
     }
 
     if (verbosity >= 8) {
@@ -506,17 +606,194 @@ FileContent DataReader::read_discrete_metric_space(std::ifstream& stream, Progre
     }
 
     data->free_implicit_rep.reset(new FIRep(*(data->bifiltration_data), input_params.verbosity));
-    data->x_reverse = x_reverse;
-    data->y_reverse = y_reverse;
+} //end build_rips_bifiltration()
+
+//reports the landmarks chosen by a greedy permutation, writes them to input_params.landmark_file if it is set, and returns them in
+//  increasing order, so that the points that are kept stay in the order of the input file
+std::vector<unsigned> DataReader::keep_landmarks(const GreedyPermutation& permutation, unsigned num_points)
+{
+    if (verbosity >= 4) {
+        debug() << "  Keeping" << permutation.landmarks.size() << "landmarks among" << num_points << "points; each point is within distance"
+                << permutation.covering_radius << "of a landmark.";
+    }
+
+    if (!input_params.landmark_file.empty()) {
+        std::ofstream file(input_params.landmark_file);
+        if (!file.is_open())
+            throw std::runtime_error("Unable to write the landmarks to " + input_params.landmark_file);
+        //one index per line, counting the points of the input file from 0
+        for (unsigned i : permutation.landmarks)
+            file << i << "\n";
+        if (!file)
+            throw std::runtime_error("Unable to write the landmarks to " + input_params.landmark_file);
+    }
+
+    return permutation.sorted_landmarks();
+} //end keep_landmarks()
+
+//reads a point cloud from a binary file (see BinaryArray) and stores the Vietoris-Rips or degree-Rips bifiltration in BifiltrationData
+//  the coordinates are used as they are stored in the file, without converting each of them from text
+FileContent DataReader::read_binary_point_cloud(const std::string& file_name, Progress& progress)
+{
+    if (verbosity >= 6) {
+        debug() << "DataReader: Found a binary point cloud file.";
+    }
+    if (input_params.bifil == "function" && input_params.function_type == "user")
+        throw std::runtime_error("Binary point-cloud files do not contain function values; choose a function with --function, or use the degree bifiltration.");
+
+    // force set parameters here
+    if (input_params.bifil == "degree") {
+        input_params.x_label = "degree";
+        input_params.x_reverse = true;
+    }
+
+    BinaryArray array(file_name);
+    if (array.rows() == 0)
+        throw std::runtime_error("No points loaded.");
+    if (array.cols() == 0)
+        throw std::runtime_error("The points in the binary file have no coordinates.");
+    if (array.rows() > std::numeric_limits<unsigned>::max())
+        throw std::runtime_error("Too many points in the binary file.");
+
+    unsigned num_points = array.rows();
+    input_params.dimension = array.cols();
+    if (verbosity >= 4) {
+        debug() << "  Read" << num_points << "points of dimension" << input_params.dimension << ". Input finished.";
+    }
+
+    // if a number of landmarks is given, keep only the landmarks
+    const double* coords = array.data();
+    std::vector<double> landmark_coords;
+    if (input_params.num_landmarks > 0) {
+        GreedyPermutation permutation;
+        permutation.build(array.data(), num_points, input_params.dimension, input_params.num_landmarks);
+        std::vector<unsigned> landmarks = keep_landmarks(permutation, num_points);
+
+        landmark_coords.reserve((size_t)landmarks.size() * input_params.dimension);
+        for (unsigned i : landmarks)
+            landmark_coords.insert(landmark_coords.end(), coords + (size_t)i * input_params.dimension, coords + (size_t)(i + 1) * input_params.dimension);
+        coords = landmark_coords.data();
+        num_points = landmarks.size();
+    }
+
+    if (verbosity >= 4) {
+        debug() << "  Building lists of grade values.";
+    }
+    progress.advanceProgressStage();
+
+    auto data = new InputData();
+    data->x_label = input_params.x_label;
+    data->y_label = input_params.y_label;
+
+    DistanceMatrix dist_mat(input_params, num_points);
+    dist_mat.build_distance_matrix(coords);
+    dist_mat.build_all_vectors(data);
+
+    if (verbosity >= 4) {
+        debug() << "  Finished reading data.";
+    }
+    progress.progress(30);
+
+    build_rips_bifiltration(data, dist_mat);
+
+    data->x_reverse = input_params.x_reverse;
+    data->y_reverse = input_params.y_reverse;
 
     return FileContent(data);
-} //end read_discrete_metric_space()
+} //end read_binary_point_cloud()
+
+//reads a distance matrix from a binary file (see BinaryArray) and stores the Vietoris-Rips or degree-Rips bifiltration in BifiltrationData
+//  the array is either the full matrix, or a single row or column with the entries above the diagonal, row by row
+FileContent DataReader::read_binary_metric_space(const std::string& file_name, Progress& progress)
+{
+    if (verbosity >= 2) {
+        debug() << "DataReader: Found a binary discrete metric space file.";
+    }
+    if (input_params.bifil == "function" && input_params.function_type == "user")
+        throw std::runtime_error("Binary metric files do not contain function values; choose a function with --function, or use the degree bifiltration.");
+
+    // force set parameters here
+    if (input_params.bifil == "degree") {
+        input_params.x_label = "degree";
+        input_params.x_reverse = true;
+    }
+
+    BinaryArray array(file_name);
+
+    //determine the number of points; a one-dimensional array always holds the distances above the diagonal, even if it
+    //  has a single entry, so only a two-dimensional square array is a full matrix
+    bool full = !array.is_one_dimensional() && array.rows() == array.cols();
+    std::size_t num_points = array.rows();
+    if (!full) {
+        if (array.rows() != 1 && array.cols() != 1)
+            throw std::runtime_error("A binary distance matrix must be square, or have a single row or column of distances.");
+        std::size_t count = array.rows() * array.cols();
+        num_points = (std::size_t)((1 + std::sqrt(1 + 8.0 * count)) / 2 + 0.5);
+        if (num_points * (num_points - 1) / 2 != count)
+            throw std::runtime_error("A single row of " + std::to_string(count) + " distances is not the part above the diagonal of any distance matrix.");
+    }
+    if (num_points == 0)
+        throw std::runtime_error("No points loaded.");
+    if (num_points > std::numeric_limits<unsigned>::max())
+        throw std::runtime_error("Too many points in the binary file.");
+
+    // if a number of landmarks is given, keep only the distances between the landmarks, above the diagonal, row by row
+    const double* distances = array.data();
+    std::vector<double> landmark_distances;
+    if (input_params.num_landmarks > 0) {
+        GreedyPermutation permutation;
+        permutation.build_metric(array.data(), num_points, full, input_params.num_landmarks);
+        std::vector<unsigned> landmarks = keep_landmarks(permutation, num_points);
+
+        landmark_distances.reserve((size_t)landmarks.size() * (landmarks.size() - 1) / 2);
+        for (std::size_t a = 0; a < landmarks.size(); a++) {
+            std::size_t i = landmarks[a];
+            //without the lower triangle, the distances from point i to the following points start after those from points 0, ..., i - 1
+            //  so the distance from point i to point j > i is entry row + j, computed modulo the size of std::size_t
+            std::size_t row = full ? i * num_points : i * num_points - i * (i + 1) / 2 - i - 1;
+            for (std::size_t b = a + 1; b < landmarks.size(); b++)
+                landmark_distances.push_back(distances[row + landmarks[b]]);
+        }
+        distances = landmark_distances.data();
+        full = false;
+        num_points = landmarks.size();
+    }
+
+    input_params.dimension = num_points;
+    if (verbosity >= 4) {
+        debug() << "  Number of points:" << num_points;
+        std::ostringstream oss;
+        oss << input_params.max_dist;
+        debug() << "  Maximum distance of edges in Rips complex:" << oss.str().c_str();
+    }
+
+    auto data = new InputData();
+    data->x_label = input_params.x_label;
+    data->y_label = input_params.y_label;
+
+    DistanceMatrix dist_mat(input_params, num_points);
+    dist_mat.read_distance_matrix(distances, full);
+    dist_mat.build_all_vectors(data);
+
+    if (verbosity >= 4) {
+        debug() << "  Finished reading data.";
+    }
+    progress.advanceProgressStage(); //advance progress box to stage 2: building bifiltration
+    progress.progress(30);
+
+    build_rips_bifiltration(data, dist_mat);
+
+    data->x_reverse = input_params.x_reverse;
+    data->y_reverse = input_params.y_reverse;
+
+    return FileContent(data);
+} //end read_binary_metric_space()
 
 //reads a bifiltration and stores in BifiltrationData
-FileContent DataReader::read_bifiltration(std::ifstream& stream, Progress& progress)
+FileContent DataReader::read_bifiltration(const std::string& file_name, Progress& progress)
 {
     auto data = new InputData();
-    FileInputReader reader(stream);
+    FileTokenizer reader(file_name);
     if (verbosity >= 2) {
         debug() << "DataReader: Found a bifiltration file.\n";
     }
@@ -527,9 +804,6 @@ FileContent DataReader::read_bifiltration(std::ifstream& stream, Progress& progr
     bool y_reverse = input_params.y_reverse;
     data->y_label = input_params.y_label;
 
-    exact xrev_sign = x_reverse ? -1 : 1;
-    exact yrev_sign = y_reverse ? -1 : 1;
-
     // skip lines with flags
     for (int i = 0; i < input_params.to_skip; i++)
         reader.next_line(0);
@@ -537,47 +811,42 @@ FileContent DataReader::read_bifiltration(std::ifstream& stream, Progress& progr
     data->bifiltration_data.reset(new BifiltrationData(input_params.hom_degree, input_params.verbosity));
 
     //temporary data structures to store grades
-    ExactSet x_set; //stores all unique x-values; must DELETE all elements later!
-    ExactSet y_set; //stores all unique y-values; must DELETE all elements later!
-    std::pair<ExactSet::iterator, bool> ret; //for return value upon insert()
+    GradeDiscretizer x_grades; //stores the x-values, with the indexes of their grades of appearance
+    GradeDiscretizer y_grades; //stores the y-values, with the indexes of their grades of appearance
 
     //read simplices
-    std::vector<std::pair<std::vector<int>, unsigned>> simplexList;
-    unsigned num_grades = 0;
-    while (reader.has_next_line()) {
-        auto line_info = reader.next_line();
+    //  the first line is read on its own, since it may be split at commas; the other lines are split into parts read in parallel
+    std::vector<SimplexPart> parts(1);
+    if (reader.has_next_line()) {
+        const std::vector<FileTokenizer::Token>& tokens = reader.next_line();
+        read_simplex(tokens, reader.line_number(), x_reverse, y_reverse, parts[0]);
+    }
+    std::vector<FileTokenizer::Lines> lines = reader.split_remaining(num_text_parts());
+    parts.resize(lines.size() + 1);
+#pragma omp parallel for schedule(dynamic)
+    for (long k = 0; k < (long)lines.size(); k++) {
+        SimplexPart& part = parts[k + 1];
         try {
-            std::vector<std::string> tokens = line_info.first;
-
-            if (tokens.size() > std::numeric_limits<unsigned>::max()) {
-                throw InputError(line_info.second,
-                    "line longer than " + std::to_string(std::numeric_limits<unsigned>::max()) + " tokens");
-            }
-
-            //read vertices
-            unsigned pos = 0;
-            std::vector<int> verts;
-            while (tokens[pos].at(0) != ';') {
-                int v = std::stoi(tokens[pos]);
-                verts.push_back(v);
-                pos++;
-            }
-            pos++;
-            unsigned grades = (tokens.size() - pos) / 2; //remaining tokens are xy pairs
-            for (unsigned i = 0; i < grades; i++) {
-                //read multigrade and remember that it corresponds to this grade
-                ret = x_set.insert(ExactValue(xrev_sign * str_to_exact(tokens.at(pos))));
-                (ret.first)->indexes.push_back(num_grades);
-                ret = y_set.insert(ExactValue(yrev_sign * str_to_exact(tokens.at(pos + 1))));
-                (ret.first)->indexes.push_back(num_grades);
-                num_grades++;
-                pos += 2;
-            }
+            while (lines[k].next_line())
+                read_simplex(lines[k].tokens(), lines[k].line_number(), x_reverse, y_reverse, part);
+        } catch (...) {
+            part.error = std::current_exception();
+        }
+    }
 
-            simplexList.push_back({ verts, grades });
-        } catch (std::exception& e) {
-            throw InputError(line_info.second, "Could not read vertex: " + std::string(e.what()));
+    //collect the parts in the order of the file, so that the first error in the file is the one reported
+    std::vector<std::pair<std::vector<int>, unsigned>> simplexList;
+    unsigned num_grades = 0;
+    for (SimplexPart& part : parts) {
+        if (part.error)
+            std::rethrow_exception(part.error);
+        for (std::size_t i = 0; i < part.x_values.size(); i++) {
+            x_grades.add(part.x_values[i], num_grades);
+            y_grades.add(part.y_values[i], num_grades);
+            num_grades++;
         }
+        std::move(part.simplices.begin(), part.simplices.end(), std::back_inserter(simplexList));
+        part = SimplexPart();
     }
 
     if (verbosity >= 4) {
@@ -591,8 +860,23 @@ FileContent DataReader::read_bifiltration(std::ifstream& stream, Progress& progr
     std::vector<unsigned> x_indexes(num_grades, max_unsigned); //x_indexes[i] gives the discrete x-index for simplex i in the input order
     std::vector<unsigned> y_indexes(num_grades, max_unsigned); //y_indexes[i] gives the discrete y-index for simplex i in the input order
 
-    build_grade_vectors(*data, x_set, x_indexes, data->x_exact, input_params.x_bins);
-    build_grade_vectors(*data, y_set, y_indexes, data->y_exact, input_params.y_bins);
+    x_grades.discretize(x_indexes, data->x_exact, input_params.x_bins, input_params.x_quantiles);
+    y_grades.discretize(y_indexes, data->y_exact, input_params.y_bins, input_params.y_quantiles);
+
+    //number the vertices consecutively, in the order of their labels, so that the simplices have small indexes
+    //  in the combinatorial number system used by BifiltrationData, which also requires the vertices to be sorted
+    std::vector<int> labels;
+    for (const auto& simplex : simplexList)
+        labels.insert(labels.end(), simplex.first.begin(), simplex.first.end());
+    std::sort(labels.begin(), labels.end());
+    labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+    for (auto& simplex : simplexList) {
+        for (int& v : simplex.first)
+            v = std::lower_bound(labels.begin(), labels.end(), v) - labels.begin();
+        std::sort(simplex.first.begin(), simplex.first.end());
+    }
+    data->bifiltration_data->set_num_vertices(labels.size());
+    std::vector<int>().swap(labels);
 
     int current_grade = 0;
     for (std::vector<std::pair<std::vector<int>, unsigned>>::iterator it = simplexList.begin(); it != simplexList.end(); it++) {
@@ -622,10 +906,10 @@ FileContent DataReader::read_bifiltration(std::ifstream& stream, Progress& progr
 } //end read_bifiltration()
 
 //reads a firep and stores in FIRep, does not create BifiltrationData
-FileContent DataReader::read_firep(std::ifstream& stream, Progress& progress)
+FileContent DataReader::read_firep(const std::string& file_name, Progress& progress)
 {
     auto data = new InputData;
-    FileInputReader reader(stream);
+    FileTokenizer reader(file_name);
     if (verbosity >= 2) {
         debug() << "DataReader: Found a firep file.\n";
     }
@@ -644,102 +928,84 @@ FileContent DataReader::read_firep(std::ifstream& stream, Progress& progress)
     data->bifiltration_data.reset(new BifiltrationData(input_params.hom_degree, input_params.verbosity)); //Will be dummy bifiltration with no stored data
 
     //temporary data structures to store grades
-    ExactSet x_set; //stores all unique x-values; must DELETE all elements later!
-    ExactSet y_set; //stores all unique x-values; must DELETE all elements later!
-    std::pair<ExactSet::iterator, bool> ret; //for return value upon insert()
+    GradeDiscretizer x_grades; //stores the x-values, with the indexes of their columns
+    GradeDiscretizer y_grades; //stores the y-values, with the indexes of their columns
 
     //Temporary data structures to store matrices
-    int num_high_simplices, num_mid_simplices, num_low_simplices;
-    std::vector<exact> x_values, y_values;
     std::vector<std::vector<unsigned>> boundary_mat_2, boundary_mat_1; //matrices boundary_mat_2: hom_dim+1->hom_dim, boundary_mat_1: hom_dim->hom_dim-1
 
-    //read simplices
-    while (reader.has_next_line()) {
-        auto line_info = reader.next_line();
+    //read the dimensions of the matrices
+    int num_high_simplices = 0, num_mid_simplices = 0, num_low_simplices = 0;
+    if (reader.has_next_line()) {
+        const std::vector<FileTokenizer::Token>& tokens = reader.next_line();
         try {
-            //read the label for x-axis
-            exact xrev_sign = x_reverse ? -1 : 1;
-
-            //read the label for y-axis
-            exact yrev_sign = y_reverse ? -1 : 1;
-
-            //Read dimensions of matrices
-            std::vector<std::string> tokens = line_info.first;
-
             if (tokens.size() != 3) {
-                throw InputError(line_info.second,
+                throw InputError(reader.line_number(),
                     "Expected 3 tokens");
             }
 
-            num_high_simplices = std::stoi(line_info.first[0]);
-            num_mid_simplices = std::stoi(line_info.first[1]);
-            num_low_simplices = std::stoi(line_info.first[2]);
-
-            //read matrices
-            //Read boundary_mat_2 first
-            x_values.reserve(num_high_simplices + num_mid_simplices);
-            y_values.reserve(num_high_simplices + num_mid_simplices);
-            for (int i = 0; i < num_high_simplices; i++) {
-                boundary_mat_2.push_back(std::vector<unsigned>());
-                line_info = reader.next_line();
-                tokens = line_info.first;
-                x_values.push_back(xrev_sign * str_to_exact(tokens.at(0)));
-                y_values.push_back(yrev_sign * str_to_exact(tokens.at(1)));
-                //store value, if it doesn't exist already
-                ret = x_set.insert(ExactValue(x_values[i]));
-                //remember that point i has this value
-                (ret.first)->indexes.push_back(i);
-
-                //store value, if it doesn't exist already
-                ret = y_set.insert(ExactValue(y_values[i]));
-                //remember that point i has this value
-                (ret.first)->indexes.push_back(i);
-
-                //Process ith column
-                if (tokens.at(2).at(0) != ';') {
-                    throw InputError(line_info.second, "Expected ';' after coordinates");
-                }
-                for (unsigned pos = 3; pos < tokens.size(); pos++) {
-                    int v = std::stoi(tokens[pos]);
-                    if (v < 0 || v >= num_mid_simplices) {
-                        throw InputError(line_info.second, "Matrix index input out of bounds.");
-                    }
-                    boundary_mat_2[i].push_back(v);
+            num_high_simplices = tokens[0].to_int();
+            num_mid_simplices = tokens[1].to_int();
+            num_low_simplices = tokens[2].to_int();
+        } catch (std::exception& e) {
+            throw InputError(reader.line_number(), "Could not read matrix: " + std::string(e.what()));
+        }
+    }
+    unsigned num_high = std::max(num_high_simplices, 0);
+    unsigned num_columns = num_high + std::max(num_mid_simplices, 0);
+
+    //read the columns of the matrices, boundary_mat_2 first; the lines are split into parts read in parallel
+    std::vector<FileTokenizer::Lines> lines = reader.split_remaining(num_text_parts());
+    std::vector<ColumnPart> parts(lines.size());
+#pragma omp parallel for schedule(dynamic)
+    for (long k = 0; k < (long)lines.size(); k++) {
+        ColumnPart& part = parts[k];
+        try {
+            while (lines[k].next_line())
+                read_column(lines[k].tokens(), lines[k].line_number(), x_reverse, y_reverse, part);
+        } catch (...) {
+            part.error = std::current_exception();
+            part.error_line = lines[k].line_number();
+        }
+    }
+
+    //collect the columns in the order of the file, so that the first error in the file is the one reported
+    x_grades.reserve(num_columns, num_columns);
+    y_grades.reserve(num_columns, num_columns);
+    boundary_mat_2.reserve(num_high);
+    boundary_mat_1.reserve(num_columns - num_high);
+    unsigned i = 0; //index of the next column
+    for (ColumnPart& part : parts) {
+        for (std::size_t c = 0; c < part.columns.size(); c++, i++) {
+            unsigned line_number = part.line_numbers[c];
+            if (i == num_columns) {
+                throw InputError(line_number, "Could not read matrix: more than " + std::to_string(num_columns) + " columns");
+            }
+            int num_rows = (i < num_high) ? num_mid_simplices : num_low_simplices;
+            for (unsigned v : part.columns[c]) {
+                if (v >= (unsigned)num_rows) {
+                    throw InputError(line_number, "Could not read matrix: line " + std::to_string(line_number) + ": Matrix index input out of bounds.");
                 }
             }
 
-            //read boundary_mat_1
-            for (int i = 0; i < num_mid_simplices; i++) {
-                boundary_mat_1.push_back(std::vector<unsigned>());
-                line_info = reader.next_line();
-                tokens = line_info.first;
-                x_values.push_back(xrev_sign * str_to_exact(tokens.at(0)));
-                y_values.push_back(yrev_sign * str_to_exact(tokens.at(1)));
-                //store value, if it doesn't exist already
-                ret = x_set.insert(ExactValue(x_values[i + num_high_simplices]));
-                //remember that point i has this value
-                (ret.first)->indexes.push_back(i + num_high_simplices);
-
-                //store value, if it doesn't exist already
-                ret = y_set.insert(ExactValue(y_values[i + num_high_simplices]));
-                //remember that point i has this value
-                (ret.first)->indexes.push_back(i + num_high_simplices);
-
-                //Process ith column
-                if (tokens.at(2).at(0) != ';') {
-                    throw InputError(line_info.second, "Expected ';' after coordinates");
-                }
-                for (unsigned pos = 3; pos < tokens.size(); pos++) {
-                    int v = std::stoi(tokens[pos]);
-                    if (v < 0 || v >= num_low_simplices) {
-                        throw InputError(line_info.second, "Matrix index input out of bounds.");
-                    }
-                    boundary_mat_1[i].push_back(v);
-                }
+            //remember that column i has these values
+            x_grades.add(part.x_values[c], i);
+            y_grades.add(part.y_values[c], i);
+            if (i < num_high)
+                boundary_mat_2.push_back(std::move(part.columns[c]));
+            else
+                boundary_mat_1.push_back(std::move(part.columns[c]));
+        }
+        if (part.error) {
+            if (i == num_columns) {
+                throw InputError(part.error_line, "Could not read matrix: more than " + std::to_string(num_columns) + " columns");
             }
-        } catch (std::exception& e) {
-            throw InputError(line_info.second, "Could not read matrix: " + std::string(e.what()));
+            std::rethrow_exception(part.error);
         }
+        part = ColumnPart();
+    }
+    if (i < num_columns) {
+        throw InputError(reader.line_number(), "Could not read matrix: expected " + std::to_string(num_columns) + " columns, found " + std::to_string(i));
     }
 
     if (verbosity >= 4) {
@@ -753,8 +1019,8 @@ FileContent DataReader::read_firep(std::ifstream& stream, Progress& progress)
     std::vector<unsigned> x_indexes(num_high_simplices + num_mid_simplices, max_unsigned); //x_indexes[i] gives the discrete x-index for simplex i in the input order
     std::vector<unsigned> y_indexes(num_high_simplices + num_mid_simplices, max_unsigned); //y_indexes[i] gives the discrete y-index for simplex i in the input order
 
-    build_grade_vectors(*data, x_set, x_indexes, data->x_exact, input_params.x_bins);
-    build_grade_vectors(*data, y_set, y_indexes, data->y_exact, input_params.y_bins);
+    x_grades.discretize(x_indexes, data->x_exact, input_params.x_bins, input_params.x_quantiles);
+    y_grades.discretize(y_indexes, data->y_exact, input_params.y_bins, input_params.y_quantiles);
 
     //Set x_grades and y_grades
     data->bifiltration_data->set_xy_grades(data->x_exact.size(), data->y_exact.size());
@@ -767,72 +1033,66 @@ FileContent DataReader::read_firep(std::ifstream& stream, Progress& progress)
 } //end read_firep()
 
 //reads a file of previously-computed data from RIVET
-FileContent DataReader::read_RIVET_data(std::ifstream& stream, Progress& progress)
+FileContent DataReader::read_RIVET_data(const std::string& file_name, Progress& progress)
 {
     auto data = new InputData();
-    FileInputReader reader(stream);
+    FileTokenizer reader(file_name);
 
     //read parameters
-    auto line_info = reader.next_line();
-    auto line = line_info.first;
+    //  NOTE: line always refers to the line most recently returned by the reader
+    const std::vector<FileTokenizer::Token>& line = reader.next_line();
     debug() << DataReader::join(line).c_str();
-    line_info = reader.next_line();
+    reader.next_line();
     try {
-        input_params.hom_degree = std::stoi(line_info.first[0]);
-        data->x_label = DataReader::join(reader.next_line().first);
-        data->y_label = DataReader::join(reader.next_line().first);
+        input_params.hom_degree = line.at(0).to_int();
+        data->x_label = DataReader::join(reader.next_line());
+        data->y_label = DataReader::join(reader.next_line());
 
         //read x-grades
         reader.next_line(); //this line should say "x-grades"
-        line_info = reader.next_line();
-        line = line_info.first;
-        while (line[0][0] != 'y') //stop when we reach "y-grades"
+        reader.next_line();
+        while (line.at(0).at(0) != 'y') //stop when we reach "y-grades"
         {
-            exact num(line[0]);
+            exact num(line[0].str());
             data->x_exact.push_back(num);
-            line_info = reader.next_line();
-            line = line_info.first;
+            reader.next_line();
         }
 
         //read y-grades
 
-        line_info = reader.next_line();
-        line = line_info.first;
-        while (line[0][0] != 'x') //stop when we reach "xi"
+        reader.next_line();
+        while (line.at(0).at(0) != 'x') //stop when we reach "xi"
         {
-            exact num(line[0]);
+            exact num(line[0].str());
             data->y_exact.push_back(num);
-            line_info = reader.next_line();
-            line = line_info.first;
+            reader.next_line();
         }
 
         //read xi values
-        line_info = reader.next_line();
-        line = line_info.first; //because the current line says "xi"
-        while (line[0][0] != 'b') //stop when we reach "barcode templates"
+        reader.next_line(); //because the current line says "xi"
+        while (line.at(0).at(0) != 'b') //stop when we reach "barcode templates"
         {
-            unsigned x = std::stoi(line[0]);
-            unsigned y = std::stoi(line[1]);
-            int zero = std::stoi(line[2]);
-            int one = std::stoi(line[3]);
-            int two = std::stoi(line[4]);
+            unsigned x = line[0].to_int();
+            unsigned y = line[1].to_int();
+            int zero = line[2].to_int();
+            int one = line[3].to_int();
+            int two = line[4].to_int();
             data->template_points.push_back(TemplatePoint(x, y, zero, one, two));
-            line_info = reader.next_line();
-            line = line_info.first;
+            reader.next_line();
         }
 
         //read barcode templates
         //  NOTE: the current line says "barcode templates"
         while (reader.has_next_line()) {
-            line_info = reader.next_line();
-            line = line_info.first;
+            reader.next_line();
             data->barcode_templates.push_back(BarcodeTemplate()); //create a new BarcodeTemplate
 
-            if (line[0] != std::string("-")) //then the barcode is nonempty
+            if (line[0].str() != "-") //then the barcode is nonempty
             {
                 for (size_t i = 0; i < line.size(); i++) //loop over all bars
                 {
-                    std::vector<std::string> nums = split(line[i], ",");
+                    std::string bar = line[i].str();
+                    std::vector<std::string> nums = split(bar, ",");
                     unsigned a = std::stol(nums[0]);
                     unsigned b = -1; //default, for b = infinity
                     if (nums[1][0] != 'i') //then b is finite
@@ -840,11 +1100,12 @@ FileContent DataReader::read_RIVET_data(std::ifstream& stream, Progress& progres
                     unsigned m = std::stol(nums[2]);
                     data->barcode_templates.back().add_bar(a, b, m);
                 }
+                data->barcode_templates.back().finalize();
             }
         }
 
     } catch (std::exception& e) {
-        throw InputError(line_info.second, e.what());
+        throw InputError(reader.line_number(), e.what());
     }
     ///TODO: maybe make a different progress box for RIVET input???
     progress.advanceProgressStage(); //advance progress box to stage 2: building bifiltration
@@ -852,58 +1113,6 @@ FileContent DataReader::read_RIVET_data(std::ifstream& stream, Progress& progres
     return FileContent(data);
 } //end read_RIVET_data()
 
-//converts an ExactSet of values to the vectors of discrete
-// values that BifiltrationTree uses to build the bifiltration,
-// and also builds the grade vectors (floating-point and exact)
-void DataReader::build_grade_vectors(InputData& data,
-    ExactSet& value_set,
-    std::vector<unsigned>& discrete_indexes,
-    std::vector<exact>& grades_exact,
-    unsigned num_bins)
-{
-
-    if (num_bins == 0 || num_bins >= value_set.size()) //then don't use bins
-    {
-
-        grades_exact.reserve(value_set.size());
-
-        unsigned c = 0; //counter for indexes
-        for (ExactSet::iterator it = value_set.begin(); it != value_set.end(); ++it) //loop through all UNIQUE values
-        {
-            grades_exact.push_back(it->exact_value);
-
-            for (unsigned i = 0; i < it->indexes.size(); i++) //loop through all point indexes for this value
-                discrete_indexes[it->indexes[i]] = c; //store discrete index
-
-            c++;
-        }
-    } else //then use bins: then the number of discrete indexes will equal
-    // the number of bins, and exact values will be equally spaced
-    {
-        //compute bin size
-        exact min = value_set.begin()->exact_value;
-        exact max = value_set.rbegin()->exact_value;
-        exact bin_size = (max - min) / num_bins;
-
-        //store bin values
-        data.x_exact.reserve(num_bins);
-
-        ExactSet::iterator it = value_set.begin();
-        for (unsigned c = 0; c < num_bins; c++) //loop through all bins
-        {
-            ExactValue cur_bin(static_cast<exact>(min + (c + 1) * bin_size)); //store the bin value (i.e. the right endpoint of the bin interval)
-            grades_exact.push_back(cur_bin.exact_value);
-
-            //store bin index for all points whose time value is in this bin
-            while (it != value_set.end() && *it <= cur_bin) {
-                for (unsigned i = 0; i < it->indexes.size(); i++) //loop through all point indexes for this value
-                    discrete_indexes[it->indexes[i]] = c; //store discrete index
-                ++it;
-            }
-        }
-    }
-} //end build_grade_vectors()
-
 //finds a rational approximation of a floating-point value
 // precondition: x > 0
 exact DataReader::approx(double x)
@@ -26,7 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define __DataReader_H__
 
 #include "dcel/barcode_template.h"
-#include "interface/file_input_reader.h"
+#include "interface/file_tokenizer.h"
 #include "interface/input_parameters.h"
 #include "math/bifiltration_data.h"
 #include "math/firep.h"
@@ -44,60 +44,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 using namespace rivet::numeric;
 
-//first, a struct to help sort multi-grade values
-struct ExactValue {
-    double double_value;
-    exact exact_value;
-
-    mutable std::vector<unsigned> indexes; //indexes of points corresponding to this value (e.g. points whose birth time is this value)
-
-    static double epsilon;
-
-    ExactValue(exact e)
-        : exact_value(e)
-    {
-        double_value = numerator(e).convert_to<double>() / denominator(e).convert_to<double>(); //can aos use static_cast in C++11
-    }
-
-    bool operator<=(const ExactValue& other) const
-    {
-        //if the two double values are nearly equal, then compare exact values
-        if (almost_equal(double_value, other.double_value))
-            return exact_value <= other.exact_value;
-
-        //otherwise, compare double values
-        return double_value <= other.double_value;
-    }
-
-    static bool almost_equal(const double a, const double b)
-    {
-        double diff = std::abs(a - b);
-        if (diff <= epsilon)
-            return true;
-
-        if (diff <= (std::abs(a) + std::abs(b)) * epsilon)
-            return true;
-        return false;
-    }
-};
-
-//comparator for ExactValue pointers
-struct ExactValueComparator {
-    bool operator()(const ExactValue& lhs, const ExactValue& rhs) const
-    {
-        //if the two double values are nearly equal, then compare exact values
-        if (ExactValue::almost_equal(lhs.double_value, rhs.double_value))
-            return lhs.exact_value < rhs.exact_value;
-
-        //otherwise, compare double values
-        return lhs.double_value < rhs.double_value;
-    }
-};
-
-//ExactSet will help sort grades
-typedef std::set<ExactValue, ExactValueComparator> ExactSet;
-
 struct ComputationResult;
+class DistanceMatrix;
+class GreedyPermutation;
 
 struct InputData {
     std::string x_label;
@@ -139,7 +88,7 @@ struct FileType {
     std::string identifier;
     std::string description;
     bool is_data;
-    std::function<FileContent(std::ifstream&, Progress&)> parser;
+    std::function<FileContent(const std::string&, Progress&)> parser; //reads the file with the given name
 };
 
 //now the DataReader class
@@ -160,6 +109,17 @@ public:
         return ss.str();
     }
 
+    static std::string join(const std::vector<FileTokenizer::Token>& tokens)
+    {
+        std::stringstream ss;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            if (i > 0)
+                ss << " ";
+            ss << tokens[i];
+        }
+        return ss.str();
+    }
+
     static std::vector<std::string> split(std::string& str, std::string separators)
     {
         std::vector<std::string> strings;
@@ -186,14 +146,17 @@ private:
     void register_file_type(FileType file_type);
 
     // parser functions
-    FileContent read_point_cloud(std::ifstream& stream, Progress& progress); //reads a point cloud and constructs a simplex tree representing the bifiltered Vietoris-Rips complex
-    FileContent read_discrete_metric_space(std::ifstream& stream, Progress& progress); //reads data representing a discrete metric space with a real-valued function and constructs a simplex tree
-    FileContent read_bifiltration(std::ifstream& stream, Progress& progress); //reads a bifiltration and constructs a simplex tree
-    FileContent read_RIVET_data(std::ifstream& stream, Progress& progress); //reads a file of previously-computed data from RIVET
-    FileContent read_messagepack(std::ifstream& stream, Progress& progress);
-    FileContent read_firep(std::ifstream& stream, Progress& progress); //reads a free implicit representation and constructs a FIRep
-
-    void build_grade_vectors(InputData& data, ExactSet& value_set, std::vector<unsigned>& indexes, std::vector<exact>& grades_exact, unsigned num_bins); //converts an ExactSets of values to the vectors of discrete values that BifiltrationData uses to build the bifiltration, and also builds the grade vectors (floating-point and exact)
+    FileContent read_point_cloud(const std::string& file_name, Progress& progress); //reads a point cloud and constructs a simplex tree representing the bifiltered Vietoris-Rips complex
+    FileContent read_discrete_metric_space(const std::string& file_name, Progress& progress); //reads data representing a discrete metric space with a real-valued function and constructs a simplex tree
+    FileContent read_bifiltration(const std::string& file_name, Progress& progress); //reads a bifiltration and constructs a simplex tree
+    FileContent read_RIVET_data(const std::string& file_name, Progress& progress); //reads a file of previously-computed data from RIVET
+    FileContent read_messagepack(const std::string& file_name, Progress& progress);
+    FileContent read_firep(const std::string& file_name, Progress& progress); //reads a free implicit representation and constructs a FIRep
+    FileContent read_binary_point_cloud(const std::string& file_name, Progress& progress); //reads a point cloud from a binary file and constructs a simplex tree representing the bifiltered Vietoris-Rips complex
+    FileContent read_binary_metric_space(const std::string& file_name, Progress& progress); //reads a distance matrix from a binary file and constructs a simplex tree
+
+    void build_rips_bifiltration(InputData* data, DistanceMatrix& dist_mat); //builds the bifiltration and FIRep of a point cloud or discrete metric space from its distance matrix
+    std::vector<unsigned> keep_landmarks(const GreedyPermutation& permutation, unsigned num_points); //reports the landmarks chosen among num_points points and writes them to the landmark file, if any; returns them in increasing order
 
     exact approx(double x); //finds a rational approximation of a floating-point value; precondition: x > 0
 };
@@ -217,6 +180,15 @@ struct DataPoint {
 
         birth = str_to_exact(strs.back());
     }
+
+    DataPoint(const std::vector<FileTokenizer::Token>& tokens, unsigned num_coords, exact b) //first num_coords tokens are coordinates
+        : birth(b)
+    {
+        coords.reserve(num_coords);
+
+        for (unsigned i = 0; i < num_coords; i++)
+            coords.push_back(tokens[i].to_double());
+    }
 };
 
 #endif // __DataReader_H__
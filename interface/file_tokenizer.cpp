@@ -0,0 +1,348 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "file_tokenizer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+//white space, as in the classic locale
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+//separators for lines that contain a comma
+inline bool is_separator(char c)
+{
+    return c == ',' || c == ' ' || c == '\t';
+}
+
+//returns a null-terminated copy of the token, for the C conversion functions
+//  tokens that fit in small are copied there, so that no memory is allocated
+const char* terminated(const FileTokenizer::Token& token, char (&small)[64], std::string& large)
+{
+    if (token.length < sizeof(small)) {
+        std::memcpy(small, token.data, token.length);
+        small[token.length] = '\0';
+        return small;
+    }
+    large.assign(token.data, token.length);
+    return large.c_str();
+}
+
+} //end anonymous namespace
+
+char FileTokenizer::Token::at(unsigned i) const
+{
+    if (i >= length)
+        throw std::out_of_range("token index out of range");
+    return data[i];
+}
+
+std::string FileTokenizer::Token::str() const
+{
+    return std::string(data, length);
+}
+
+double FileTokenizer::Token::to_double() const
+{
+    char small[64];
+    std::string large;
+    const char* str = terminated(*this, small, large);
+
+    char* stop;
+    double value = std::strtod(str, &stop);
+    return (stop == str) ? 0 : value;
+}
+
+int FileTokenizer::Token::to_int() const
+{
+    char small[64];
+    std::string large;
+    const char* str = terminated(*this, small, large);
+
+    char* stop;
+    errno = 0;
+    long value = std::strtol(str, &stop, 10);
+    if (stop == str)
+        throw std::invalid_argument("stoi");
+    if (errno == ERANGE || value < INT_MIN || value > INT_MAX)
+        throw std::out_of_range("stoi");
+    return (int)value;
+}
+
+exact FileTokenizer::Token::to_exact() const
+{
+    rivet::numeric::SmallRational value;
+    if (rivet::numeric::SmallRational::parse(data, data + length, value))
+        return value.to_exact();
+    return rivet::numeric::str_to_exact(str());
+}
+
+rivet::numeric::SmallRational FileTokenizer::Token::to_rational() const
+{
+    rivet::numeric::SmallRational value;
+    if (rivet::numeric::SmallRational::parse(data, data + length, value))
+        return value;
+    return rivet::numeric::SmallRational(rivet::numeric::str_to_exact(str()));
+}
+
+std::ostream& operator<<(std::ostream& out, const FileTokenizer::Token& token)
+{
+    return out.write(token.data, token.length);
+}
+
+//maps the given file into memory, and finds the first line
+FileTokenizer::FileTokenizer(const std::string& file_name)
+    : begin(nullptr)
+    , end(nullptr)
+    , pos(nullptr)
+    , mapping(nullptr)
+    , length(0)
+    , lines_read(0)
+    , current_line_number(0)
+    , next_line_found(false)
+{
+#ifdef _WIN32
+    //no memory mapping; read the file into a buffer instead
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("Could not open input file.");
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    length = buffer.size();
+    begin = buffer.data();
+#else
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Could not open input file.");
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not read input file.");
+    }
+    length = info.st_size;
+    if (length > 0) { //an empty file cannot be mapped, but it has no lines anyway
+        mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            mapping = nullptr;
+            throw std::runtime_error("Could not map input file into memory.");
+        }
+        madvise(mapping, length, MADV_SEQUENTIAL);
+        begin = static_cast<const char*>(mapping);
+    }
+    ::close(fd); //the mapping remains valid after the file is closed
+#endif
+    end = begin + length;
+    pos = begin;
+
+    find_next_line(0);
+}
+
+FileTokenizer::~FileTokenizer()
+{
+#ifndef _WIN32
+    if (mapping != nullptr)
+        munmap(mapping, length);
+#endif
+}
+
+// if it starts with -- or -<non-digit> or <non-digit & non-dash>, it is a flag
+bool FileTokenizer::is_flag(const char* first, const char* last)
+{
+    // use ASCII values to check if digit or not
+    int first_char = (char)first[0];
+    int second_char = (last - first > 1) ? (char)first[1] : 0;
+
+    if (first_char == 45 && second_char == 45)
+        return true;
+    if (first_char == 45 && (second_char < 48 || second_char > 57))
+        return true;
+    if (first_char != 45 && (first_char < 48 || first_char > 57))
+        return true;
+
+    return false;
+}
+
+//finds the next line in the file that is not empty and not a comment, if such line exists, and splits it into tokens
+void FileTokenizer::find_next_line(int old)
+{
+    next_line_found = read_line(pos, end, old, lines_read, next_tokens, next_begin);
+}
+
+bool FileTokenizer::read_line(const char*& pos, const char* end, int old, unsigned& lines_read, std::vector<Token>& tokens, const char*& line_begin)
+{
+    while (pos < end) {
+        const char* line_end = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+        if (line_end == nullptr)
+            line_end = end;
+
+        const char* first = pos;
+        const char* last = line_end;
+        line_begin = pos;
+        pos = (line_end == end) ? end : line_end + 1;
+        lines_read++;
+
+        //trim white space, and skip empty lines and comments
+        while (first < last && is_space(*first))
+            first++;
+        while (last > first && is_space(*(last - 1)))
+            last--;
+        if (first == last || *first == '#')
+            continue;
+
+        tokens.clear();
+        // old = 1 means old file format, so split by space
+        if (old || std::memchr(first, ',', last - first) == nullptr || is_flag(first, last)) {
+            const char* p = first;
+            while (p < last) {
+                const char* q = p;
+                while (q < last && !is_space(*q))
+                    q++;
+                tokens.push_back(Token{ p, (unsigned)(q - p) });
+                while (q < last && is_space(*q))
+                    q++;
+                p = q;
+            }
+        }
+        // if a "," is there in the line, split by ","
+        //  as with FileInputReader, a separator at either end of the line gives an empty token
+        else {
+            const char* p = first;
+            while (true) {
+                const char* q = p;
+                while (q < last && !is_separator(*q))
+                    q++;
+                tokens.push_back(Token{ p, (unsigned)(q - p) });
+                if (q == last)
+                    break;
+                while (q < last && is_separator(*q))
+                    q++;
+                p = q;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+//indicates whether another line can be returned
+bool FileTokenizer::has_next_line() const
+{
+    return next_line_found;
+}
+
+//returns the tokens of the next line
+const std::vector<FileTokenizer::Token>& FileTokenizer::next_line(int old)
+{
+    if (!next_line_found)
+        next_tokens.clear();
+
+    current_tokens.swap(next_tokens);
+    current_line_number = lines_read;
+    next_line_found = false;
+    find_next_line(old);
+
+    return current_tokens;
+}
+
+const std::vector<FileTokenizer::Token>& FileTokenizer::current_line() const
+{
+    return current_tokens;
+}
+
+unsigned FileTokenizer::line_number() const
+{
+    return current_line_number;
+}
+
+std::vector<FileTokenizer::Lines> FileTokenizer::split_remaining(unsigned num_parts, int old)
+{
+    std::vector<Lines> parts;
+    if (!next_line_found)
+        return parts;
+
+    //end each part after the first newline at or after its share of the characters
+    const char* first = next_begin;
+    std::size_t size = end - first;
+    num_parts = std::max(1u, num_parts);
+    std::vector<const char*> bounds(1, first);
+    for (unsigned k = 1; k < num_parts; k++) {
+        const char* bound = first + size / num_parts * k;
+        if (bound <= bounds.back())
+            continue;
+        const char* newline = static_cast<const char*>(std::memchr(bound, '\n', end - bound));
+        if (newline == nullptr || newline + 1 == end)
+            break;
+        if (newline + 1 > bounds.back())
+            bounds.push_back(newline + 1);
+    }
+    bounds.push_back(end);
+
+    //count the lines of each part, to find the line number of the first line of each part
+    std::size_t count = bounds.size() - 1;
+    std::vector<unsigned> newlines(count);
+#pragma omp parallel for schedule(static)
+    for (long k = 0; k < (long)count; k++)
+        newlines[k] = std::count(bounds[k], bounds[k + 1], '\n');
+
+    unsigned lines_before = lines_read - 1; //lines before the one found by find_next_line()
+    parts.reserve(count);
+    for (std::size_t k = 0; k < count; k++) {
+        parts.emplace_back(bounds[k], bounds[k + 1], lines_before, old);
+        lines_before += newlines[k];
+    }
+    next_line_found = false;
+    return parts;
+}
+
+FileTokenizer::Lines::Lines(const char* begin, const char* end, unsigned lines_before, int old)
+    : pos(begin)
+    , end(end)
+    , lines_read(lines_before)
+    , current_line_number(lines_before)
+    , old(old)
+{
+}
+
+bool FileTokenizer::Lines::next_line()
+{
+    const char* line_begin;
+    if (!read_line(pos, end, old, lines_read, line_tokens, line_begin))
+        return false;
+    current_line_number = lines_read;
+    return true;
+}
@@ -0,0 +1,126 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	FileTokenizer
+ * \brief	Reads a memory-mapped file, ignoring white space and comments, and splits each line into tokens in place.
+ *
+ * The rules are those of FileInputReader: lines are trimmed, empty lines and lines that begin with '#' are skipped,
+ * and each line is split at white space or, unless the old format is requested, at commas. A token is a slice of
+ * the mapped file rather than a std::string, so reading a line does not allocate any memory.
+ *
+ * The rest of the file can also be split into ranges of whole lines (see Lines), which can be read in parallel.
+ */
+
+#ifndef FILETOKENIZER_H
+#define FILETOKENIZER_H
+
+#include "numerics.h"
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class FileTokenizer {
+public:
+    //a token is a slice of the file, which remains valid as long as the FileTokenizer exists
+    struct Token {
+        const char* data;
+        unsigned length;
+
+        char at(unsigned i) const; //returns the i-th character; throws std::out_of_range, as std::string::at()
+        std::string str() const;
+
+        double to_double() const; //reads a floating-point value; as with std::stringstream, returns 0 if the token does not begin with a number
+        int to_int() const; //reads an integer; as with std::stoi, throws std::invalid_argument or std::out_of_range
+        exact to_exact() const; //reads an exact value, as str_to_exact()
+        rivet::numeric::SmallRational to_rational() const; //reads the same value as to_exact(), without multiprecision arithmetic if it fits in 64 bits
+    };
+
+    //a range of whole lines of the file, read with the rules of next_line() independently of the FileTokenizer and of other ranges,
+    //  so that each range can be read by a different thread; the range remains valid as long as the FileTokenizer exists
+    class Lines {
+    public:
+        Lines(const char* begin, const char* end, unsigned lines_before, int old);
+
+        bool next_line(); //finds the next line of the range that is not empty and not a comment, and splits it; returns false if there is none
+        const std::vector<Token>& tokens() const { return line_tokens; } //the tokens of the line found by next_line()
+        unsigned line_number() const { return current_line_number; } //the line number in the file of the line found by next_line()
+
+    private:
+        const char* pos;
+        const char* end;
+        unsigned lines_read; //number of lines of the file before pos
+        unsigned current_line_number;
+        int old;
+        std::vector<Token> line_tokens;
+    };
+
+    FileTokenizer(const std::string& file_name); //maps the file into memory; throws std::runtime_error if the file cannot be read
+    ~FileTokenizer();
+
+    FileTokenizer(const FileTokenizer&) = delete;
+    FileTokenizer& operator=(const FileTokenizer&) = delete;
+
+    //true iff the file has another line of printable, non-commented characters
+    bool has_next_line() const;
+
+    //returns the tokens of the next line; the vector is overwritten by the following call
+    //  old = 1 means old file format: the line AFTER the returned line is then split only at white space
+    const std::vector<Token>& next_line(int old = 1);
+
+    //returns the tokens of the line most recently returned by next_line()
+    const std::vector<Token>& current_line() const;
+
+    //returns the line number at which the line most recently returned by next_line() was found
+    unsigned line_number() const;
+
+    //splits the lines from the one that next_line() would return to the end of the file into at most num_parts ranges of about the
+    //  same size, in the order of the file; each line is split as if read by next_line(old), and the first line is split again by
+    //  these rules; next_line() should not be called afterwards
+    std::vector<Lines> split_remaining(unsigned num_parts, int old = 1);
+
+private:
+    const char* begin; //start of the file
+    const char* end; //end of the file
+    const char* pos; //start of the first line not yet examined
+    const char* next_begin; //start of the line found by find_next_line()
+    void* mapping; //memory mapping of the file, if any
+    std::size_t length;
+    std::vector<char> buffer; //copy of the file, if it was not mapped
+
+    unsigned lines_read; //number of lines examined so far
+    unsigned current_line_number;
+    bool next_line_found;
+    std::vector<Token> current_tokens;
+    std::vector<Token> next_tokens;
+
+    void find_next_line(int old);
+
+    //finds the next line in [pos, end) that is not empty and not a comment and splits it into tokens, if such line exists
+    //  advances pos past the line, adds the number of lines examined to lines_read, and sets line_begin to the start of the line
+    static bool read_line(const char*& pos, const char* end, int old, unsigned& lines_read, std::vector<Token>& tokens, const char*& line_begin);
+
+    static bool is_flag(const char* first, const char* last);
+};
+
+std::ostream& operator<<(std::ostream& out, const FileTokenizer::Token& token);
+
+#endif // FILETOKENIZER_H
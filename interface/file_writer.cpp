@@ -70,11 +70,11 @@ void FileWriter::write_augmented_arrangement(std::ofstream& stream)
     //write barcode templates
     stream << "barcode templates" << std::endl;
     for (unsigned i = 0; i < arrangement.num_faces(); i++) {
-        BarcodeTemplate& bc = arrangement.get_barcode_template(i);
+        const BarcodeTemplate& bc = arrangement.get_barcode_template(i);
         if (bc.is_empty()) {
             stream << "-"; //this denotes an empty barcode (necessary because FileInputReader ignores white space)
         } else {
-            for (std::set<BarTemplate>::iterator it = bc.begin(); it != bc.end(); ++it) {
+            for (std::vector<BarTemplate>::const_iterator it = bc.begin(); it != bc.end(); ++it) {
                 stream << it->begin << ",";
                 if (it->end == (unsigned)-1) //then the bar ends at infinity, but we just write "i"
                     stream << "i";
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "input_manager.h"
 #include "../debug.h"
+#include "binary_array.h"
 #include "file_input_reader.h"
 #include "input_parameters.h"
 
@@ -113,6 +114,12 @@ bool InputManager::is_flag(std::string str)
 // sets up input_params
 void InputManager::parse_args()
 {
+    // binary files have no flags; their type and size are given by their headers
+    if (BinaryArray::is_binary_array(input_params.fileName)) {
+        parse_binary();
+        return;
+    }
+
     // open as a separate file, not the reference
     std::ifstream input_file(input_params.fileName);
     FileInputReader reader(input_file);
@@ -164,6 +171,20 @@ void InputManager::parse_args()
                 } catch (std::exception& e) {
                     throw std::runtime_error("Invalid argument for --maxdist");
                 }
+            } else if (line[0] == "--landmarks") {
+                try {
+                    // number of landmarks cannot be less than 0
+                    int m = std::stoi(line[1]);
+                    if (m < 0)
+                        throw std::runtime_error("Error");
+                    input_params.num_landmarks = m;
+                } catch (std::exception& e) {
+                    throw std::runtime_error("Invalid argument for --landmarks");
+                }
+            } else if (line[0] == "--landmark_file") {
+                if (line.size() < 2)
+                    throw std::runtime_error("Invalid argument for --landmark_file");
+                input_params.landmark_file = line[1];
             } else if (line[0] == "--homology" || line[0] == "-H") {
                 try {
                     // homology degree cannot be less than 0
@@ -282,6 +303,10 @@ void InputManager::parse_args()
                 input_params.x_reverse = true;
             } else if (line[0] == "--yreverse") {
                 input_params.y_reverse = true;
+            } else if (line[0] == "--xquantiles") {
+                input_params.x_quantiles = true;
+            } else if (line[0] == "--yquantiles") {
+                input_params.y_quantiles = true;
             } else if (line[0] == "--binary") {
                 input_params.binary = true;
             } else if (line[0] == "--minpres") {
@@ -354,6 +379,31 @@ void InputManager::parse_args()
     input_file.close();
 }
 
+// sets up input_params for a binary point cloud or distance matrix
+//  a .npy file is read as a point cloud unless --datatype metric_binary is given on the command line
+void InputManager::parse_binary()
+{
+    BinaryArray array(input_params.fileName);
+
+    type_set = (array.kind() != BinaryArray::UNKNOWN);
+    if (array.kind() == BinaryArray::DISTANCES) {
+        input_params.type = "metric_binary";
+        input_params.dimension = array.rows(); // the number of points, if the matrix is full
+    } else {
+        input_params.type = "points_binary";
+        input_params.dimension = array.cols();
+    }
+    input_params.to_skip = 0;
+
+    if (input_params.bifil == "")
+        input_params.bifil = "degree";
+    input_params.x_reverse = true;
+    input_params.y_reverse = false;
+
+    if (input_params.bifil == "function" && input_params.function_type == "none")
+        input_params.function_type = "balldensity";
+}
+
 // parse old point cloud input parameters
 void InputManager::parse_points_old()
 {
@@ -71,6 +71,7 @@ private:
     int to_skip; // stores the number of non-data lines in the input file
 
     void parse_args(); // goes through supplied arguments and sets parameters
+    void parse_binary(); // sets parameters from the header of a binary input file
 
     // methods to support parsing the old file formats
     void parse_points_old();
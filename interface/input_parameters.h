@@ -44,6 +44,7 @@ struct InputParameters {
     int hom_degree; //degree of homology to compute
     int x_bins; //number of bins for x-coordinate (if 0, then bins are not used for x)
     int y_bins; //number of bins for y-coordinate (if 0, then bins are not used for y)
+    bool x_quantiles, y_quantiles; //specifies if the bins of each axis hold about the same number of values, instead of being equally spaced
     int verbosity; //controls the amount of console output printed
     std::string x_label; //used by configuration dialog
     std::string y_label; //used by configuration dialog
@@ -65,6 +66,8 @@ struct InputParameters {
     int to_skip; //number of lines after which the actual data begins
     std::string function_type; //type of function values to calculate
     double filter_param; //parameter value for calculating function values
+    unsigned num_landmarks; //number of points of a point cloud or metric space to keep, chosen by a greedy permutation; 0 keeps all points
+    std::string landmark_file; //name of the file where the indexes of the landmarks are written, if not empty
 
     InputParameters()
     {
@@ -74,6 +77,8 @@ struct InputParameters {
         hom_degree = 0;
         x_bins = 0;
         y_bins = 0;
+        x_quantiles = false;
+        y_quantiles = false;
         verbosity = 0;
         outputFormat = "msgpack";
         num_threads = 0;
@@ -92,6 +97,8 @@ struct InputParameters {
         koszul = false;
         filter_param = 0;
         function_type = "none";
+        num_landmarks = 0;
+        landmark_file = "";
     }
 
     template <typename Archive>
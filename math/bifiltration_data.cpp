@@ -29,8 +29,82 @@
 
 #include <algorithm> //for std::sort
 #include <iostream> //for std::cout, for testing only
+#include <iterator>
 #include <limits> //std::numeric_limits
 #include <stdexcept>
+#include <string>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+SimplexEncoder::SimplexEncoder()
+    : vertex_count(0)
+    , max_size(0)
+{
+}
+
+//builds the table of binomial coefficients C(v, k) for v <= num_vertices and k <= max_size, by Pascal's rule
+SimplexEncoder::SimplexEncoder(unsigned num_vertices, unsigned max_size)
+    : vertex_count(num_vertices)
+    , max_size(max_size)
+    , binomials((max_size + 1) * (std::size_t)(num_vertices + 1), 0)
+{
+    for (unsigned v = 0; v <= num_vertices; v++) {
+        binomials[v] = 1;
+        for (unsigned k = 1; k <= max_size && k <= v; k++) {
+            const SimplexIndex& a = binomial(v - 1, k - 1);
+            const SimplexIndex& b = binomial(v - 1, k);
+            if (a + b < a) {
+                throw std::runtime_error("BifiltrationData: too many vertices to index simplices of dimension "
+                    + std::to_string(max_size - 1));
+            }
+            binomials[k * (std::size_t)(num_vertices + 1) + v] = a + b;
+        }
+    }
+}
+
+SimplexIndex SimplexEncoder::encode(const Simplex& vertices) const
+{
+    SimplexIndex index = 0;
+    for (unsigned i = 0; i < vertices.size(); i++)
+        index += binomial(vertices[i], i + 1);
+    return index;
+}
+
+//finds the vertices from the largest to the smallest; removing vertex j shifts the larger vertices down by one place,
+//  so the face without it is the sum of the terms of the smaller vertices and of the shifted terms of the larger ones
+void SimplexEncoder::faces(SimplexIndex index, unsigned size, SimplexIndex* faces) const
+{
+    SimplexIndex above = 0;
+    unsigned top = vertex_count;
+    for (unsigned j = size; j-- > 0;) {
+        unsigned v = max_vertex(index, j + 1, top);
+        index -= binomial(v, j + 1);
+        faces[j] = above + index;
+        above += binomial(v, j);
+        top = v;
+    }
+}
+
+Simplex SimplexEncoder::vertices(SimplexIndex index, unsigned size) const
+{
+    Simplex vertices(size);
+    unsigned top = vertex_count;
+    for (unsigned j = size; j-- > 0;) {
+        top = max_vertex(index, j + 1, top);
+        index -= binomial(top, j + 1);
+        vertices[j] = top;
+    }
+    return vertices;
+}
+
+unsigned SimplexEncoder::max_vertex(const SimplexIndex& index, unsigned k, unsigned top) const
+{
+    //C(v, k) is zero for v < k, and increasing for v >= k - 1
+    const SimplexIndex* row = &binomials[k * (std::size_t)(vertex_count + 1)];
+    return std::upper_bound(row + k - 1, row + top, index) - row - 1;
+}
 
 //BifiltrationData constructor; requires dimension of homology to be computed and verbosity parameter
 BifiltrationData::BifiltrationData(unsigned dim, int verbosity)
@@ -39,7 +113,6 @@ BifiltrationData::BifiltrationData(unsigned dim, int verbosity)
     , x_grades(0)
     , y_grades(0)
     , mid_count(0)
-    , high_count(0)
 {
     if (hom_dim > 5) {
         throw std::runtime_error("BifiltrationData: Dimensions greater than 5 probably don't make sense");
@@ -49,6 +122,12 @@ BifiltrationData::BifiltrationData(unsigned dim, int verbosity)
     }
 }
 
+//the vertices of the simplices added by add_simplex() must be less than num_vertices
+void BifiltrationData::set_num_vertices(unsigned num_vertices)
+{
+    encoder = SimplexEncoder(num_vertices, hom_dim + 2);
+}
+
 /*
 Adds a simplex to the BifiltrationData.  If the simplex does not have dimension 
 hom_dim-1, hom_dim, or hom_dim+1, does nothing.
@@ -59,30 +138,101 @@ WARNING: Assumes that simplex vertices are sorted (increasing order)
  */
 void BifiltrationData::add_simplex(Simplex const& vertices, const AppearanceGrades& grades)
 {
-    if (vertices.size() == 0) {
+    if (vertices.size() == 0 || vertices.size() > hom_dim + 2) {
         return;
     }
+    if (vertices.front() < 0 || (unsigned)vertices.back() >= encoder.num_vertices()) {
+        throw std::runtime_error("BifiltrationData: vertex out of range");
+    }
 
-    else if (vertices.size() == hom_dim) //simplex of dimension hom_dim - 1
+    if (vertices.size() == hom_dim) //simplex of dimension hom_dim - 1
     {
         //For the homology computation,
         //we only need the greatest lower bound of grades
-        low_simplices.push_back(LowSimplexData(vertices, Grade((grades.end() - 1)->x, grades.begin()->y)));
+        low_simplices.push_back(LowSimplexData(encoder.encode(vertices), Grade((grades.end() - 1)->x, grades.begin()->y)));
         return;
     } else if (vertices.size() == hom_dim + 1) //simplex of dimension hom_dim
     {
-        mid_simplices.push_back(MidHighSimplexData(vertices, grades, false));
+        mid_simplices.push_back(MidSimplexData(encoder.encode(vertices), grades));
         mid_count=mid_count+grades.size();
         return;
 
     } else if (vertices.size() == hom_dim + 2) //simplex of dimension hom_dim + 1
     {
-        high_simplices.push_back(MidHighSimplexData(vertices, grades, true));
-        high_count=high_count+grades.size();
+        SimplexIndex s = encoder.encode(vertices);
+        for (AppearanceGrades::const_iterator it = grades.begin(); it != grades.end(); it++)
+            high_simplices.push_back(HighSimplexData(s, *it));
         return;
     }
 } //end add_faces()
 
+namespace {
+
+//moves the elements of source to the end of target, which will hold total elements, and frees source
+template <typename T>
+void move_append(std::vector<T>& target, std::vector<T>& source, std::size_t total)
+{
+    if (target.empty()) {
+        target.swap(source);
+        target.reserve(total);
+    } else {
+        std::move(source.begin(), source.end(), std::back_inserter(target));
+    }
+    std::vector<T>().swap(source);
+}
+
+} //end anonymous namespace
+
+//dynamic scheduling balances the blocks among the threads, since the numbers of cofaces of the edges vary widely
+template <typename BuildItems>
+void BifiltrationData::build_in_blocks(const std::vector<unsigned>& num_items, BuildItems build)
+{
+    //offsets[i] is the number of items of the vertices before vertex i
+    std::vector<std::size_t> offsets(num_items.size() + 1, 0);
+    for (unsigned i = 0; i < num_items.size(); i++)
+        offsets[i + 1] = offsets[i] + num_items[i];
+    std::size_t total = offsets.back();
+    if (total == 0)
+        return;
+
+    unsigned num_threads = 1;
+#ifdef _OPENMP
+    num_threads = omp_get_max_threads();
+#endif
+    std::size_t num_blocks = (num_threads > 1) ? std::min<std::size_t>(total, 64 * num_threads) : 1;
+
+    std::vector<SimplexLists> blocks(num_blocks);
+#pragma omp parallel for schedule(dynamic)
+    for (long b = 0; b < (long)num_blocks; b++) {
+        std::size_t first = total * b / num_blocks;
+        std::size_t last = total * (b + 1) / num_blocks;
+
+        //vertex i is the last one whose items start at or before the first item of the block
+        unsigned i = std::upper_bound(offsets.begin(), offsets.end(), first) - offsets.begin() - 1;
+        for (; first < last; i++) {
+            std::size_t end = std::min(last, offsets[i + 1]);
+            if (end > first) {
+                build(i, first - offsets[i], end - offsets[i], blocks[b]);
+                first = end;
+            }
+        }
+    }
+
+    //store the simplices of the blocks in order, as if they were built by a single recursion
+    std::size_t num_low = low_simplices.size(), num_mid = mid_simplices.size(), num_high = high_simplices.size();
+    for (const SimplexLists& block : blocks) {
+        num_low += block.low.size();
+        num_mid += block.mid.size();
+        num_high += block.high.size();
+    }
+    for (SimplexLists& block : blocks) {
+        move_append(low_simplices, block.low, num_low);
+        move_append(mid_simplices, block.mid, num_mid);
+        move_append(high_simplices, block.high, num_high);
+        mid_count += block.mid_count;
+    }
+} //end build_in_blocks()
+
 void BifiltrationData::build_VR_complex(const std::vector<unsigned>& times,
     const std::vector<unsigned>& distances,
     const unsigned num_x,
@@ -90,38 +240,91 @@ void BifiltrationData::build_VR_complex(const std::vector<unsigned>& times,
 {
     x_grades = num_x;
     y_grades = num_y;
+    set_num_vertices(times.size());
+    unsigned num_points = times.size();
+
+    //count the neighbors of each point after it, whose edges are work items
+    std::vector<unsigned> num_items(num_points, 1);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (long i = 0; i < (long)num_points; i++) {
+        for (unsigned j = i + 1; j < num_points; j++)
+            if (distances[(j * (j - 1)) / 2 + i + 1] < std::numeric_limits<unsigned>::max())
+                num_items[i]++;
+    }
 
     //Add generation points recursively
-    for (unsigned i = 0; i < times.size(); i++) {
-        //recursion
+    build_in_blocks(num_items, [&](unsigned i, unsigned first, unsigned last, SimplexLists& lists) {
         std::vector<int> vertices;
         vertices.push_back(i);
+        if (first == 0)
+            store_simplex(vertices, Grade(times[i], 0), lists);
+
+        //recursion for the edges from i to its k-th neighbor after it, for k in [first, last)
+        unsigned k = 1;
+        for (unsigned j = i + 1; j < num_points && k < last; j++) {
+            unsigned d = distances[(j * (j - 1)) / 2 + i + 1]; //the distance between points i and j, with i < j
+            if (d == std::numeric_limits<unsigned>::max())
+                continue;
+            if (k >= first) {
+                vertices.push_back(j);
+                build_VR_subcomplex(times, distances, vertices, std::max(times[i], times[j]), d, lists);
+                vertices.pop_back();
+            }
+            k++;
+        }
+    });
+} //end build_VR_complex()
 
-        build_VR_subcomplex(times, distances, vertices, times[i], 0);
+//stores a simplex with a single grade of appearance, if it has dimension (hom_dim - 1), hom_dim, or hom_dim+1. Dimension is vertices.size() - 1
+bool BifiltrationData::store_simplex(const std::vector<int>& vertices, const Grade& grade, SimplexLists& lists) const
+{
+    if (vertices.size() == hom_dim) //simplex of dimension hom_dim - 1
+    {
+        lists.low.push_back(LowSimplexData(encoder.encode(vertices), grade));
+    } else if (vertices.size() == hom_dim + 1) //simplex of dimension hom_dim
+    {
+        lists.mid.push_back(MidSimplexData(encoder.encode(vertices), AppearanceGrades(1, grade)));
+        lists.mid_count++;
+    } else if (vertices.size() == hom_dim + 2) //simplex of dimension hom_dim + 1
+    {
+        lists.high.push_back(HighSimplexData(encoder.encode(vertices), grade));
+        return false;
     }
-} //end build_VR_complex()
+    return true;
+} //end store_simplex()
+
+//as above, for a simplex with multiple grades of appearance, sorted in reverse lexicographic order
+bool BifiltrationData::store_simplex(const std::vector<int>& vertices, const AppearanceGrades& grades, SimplexLists& lists) const
+{
+    if (vertices.size() == hom_dim) //simplex of dimension hom_dim - 1
+    {
+        //take the greatest lower bound of the grades, using the fact that the grades are ordered properly.
+        lists.low.push_back(LowSimplexData(encoder.encode(vertices), Grade((grades.end() - 1)->x, grades.begin()->y)));
+    } else if (vertices.size() == hom_dim + 1) //simplex of dimension hom_dim
+    {
+        lists.mid.push_back(MidSimplexData(encoder.encode(vertices), grades));
+        lists.mid_count += grades.size();
+    } else if (vertices.size() == hom_dim + 2) //simplex of dimension hom_dim + 1, stored once for each grade of appearance
+    {
+        SimplexIndex s = encoder.encode(vertices);
+        for (AppearanceGrades::const_iterator it = grades.begin(); it != grades.end(); it++)
+            lists.high.push_back(HighSimplexData(s, *it));
+        return false;
+    }
+    return true;
+} //end store_simplex()
 
 //function to add (recursively) a subcomplex of the bifiltration data
 void BifiltrationData::build_VR_subcomplex(const std::vector<unsigned>& times,
     const std::vector<unsigned>& distances,
     std::vector<int>& vertices,
     const unsigned prev_time,
-    const unsigned prev_dist)
+    const unsigned prev_dist,
+    SimplexLists& lists) const
 {
-    //Store the simplex info if it is of dimension (hom_dim - 1), hom_dim, or hom_dim+1. Dimension is vertices.size() - 1
-    if (vertices.size() == hom_dim) //simplex of dimension hom_dim - 1
-    {
-        low_simplices.push_back(LowSimplexData(vertices, Grade(prev_time, prev_dist)));
-    } else if (vertices.size() == hom_dim + 1) //simplex of dimension hom_dim - 1
-    {
-        mid_simplices.push_back(MidHighSimplexData(vertices, AppearanceGrades(1, Grade(prev_time, prev_dist)), false));
-        mid_count++;
-    } else if (vertices.size() == hom_dim + 2) //simplex of dimension hom_dim - 1
-    {
-        high_simplices.push_back(MidHighSimplexData(vertices, AppearanceGrades(1, Grade(prev_time, prev_dist)), true));
-        high_count++;
+    //Store the simplex info if it is of dimension (hom_dim - 1), hom_dim, or hom_dim+1
+    if (!store_simplex(vertices, Grade(prev_time, prev_dist), lists))
         return;
-    }
 
     //loop through all points that could be children of this node
     for (unsigned j = vertices.back() + 1; j < times.size(); j++) {
@@ -145,20 +348,91 @@ void BifiltrationData::build_VR_subcomplex(const std::vector<unsigned>& times,
 
             //recursion
             vertices.push_back(j); //next we will look for children of node j
-            build_VR_subcomplex(times, distances, vertices, current_time, current_dist);
+            build_VR_subcomplex(times, distances, vertices, current_time, current_dist, lists);
             vertices.pop_back(); //finished adding children of node j
         }
     }
 } //end build_VR_subcomplex()
 
+//builds BifiltrationData representing a bifiltered Vietoris-Rips complex, with the distances stored in a NeighborGraph
+void BifiltrationData::build_VR_complex(const std::vector<unsigned>& times,
+    const NeighborGraph& graph,
+    const unsigned num_x,
+    const unsigned num_y)
+{
+    x_grades = num_x;
+    y_grades = num_y;
+    set_num_vertices(times.size());
+
+    //the work items of each point are the point and its edges to its neighbors
+    std::vector<unsigned> num_items(times.size());
+    for (unsigned i = 0; i < times.size(); i++)
+        num_items[i] = 1 + (graph.starts[i + 1] - graph.starts[i]);
+
+    //Add generation points recursively
+    build_in_blocks(num_items, [&](unsigned i, unsigned first, unsigned last, SimplexLists& lists) {
+        std::vector<int> vertices;
+        vertices.push_back(i);
+        if (first == 0)
+            store_simplex(vertices, Grade(times[i], 0), lists);
+
+        //the candidates of vertex i are its neighbors; recursion for the candidates first - 1, ..., last - 2
+        std::vector<NeighborGraph::Candidate> candidates, new_candidates;
+        graph.candidates(i, candidates);
+        for (auto it = candidates.begin() + std::max(first, 1u) - 1; it != candidates.begin() + last - 1; it++) {
+            vertices.push_back(it->vertex);
+            if (vertices.size() < hom_dim + 2)
+                graph.intersect(it->vertex, it + 1, candidates.end(), new_candidates);
+            build_VR_subcomplex(times, graph, vertices, new_candidates, std::max(times[i], times[it->vertex]), it->dist, lists);
+            vertices.pop_back();
+        }
+    });
+} //end build_VR_complex()
+
+//function to add (recursively) a subcomplex of the bifiltration data, with the distances stored in a NeighborGraph
+//  the simplices are added in the same order as by the function above
+void BifiltrationData::build_VR_subcomplex(const std::vector<unsigned>& times,
+    const NeighborGraph& graph,
+    std::vector<int>& vertices,
+    const std::vector<NeighborGraph::Candidate>& candidates,
+    const unsigned prev_time,
+    const unsigned prev_dist,
+    SimplexLists& lists) const
+{
+    //Store the simplex info if it is of dimension (hom_dim - 1), hom_dim, or hom_dim+1
+    if (!store_simplex(vertices, Grade(prev_time, prev_dist), lists))
+        return;
+
+    //loop through all points that are neighbors of every vertex of the simplex, and come after its last vertex
+    //  each candidate carries the largest distance from it to the vertices of the simplex
+    std::vector<NeighborGraph::Candidate> new_candidates;
+    for (std::vector<NeighborGraph::Candidate>::const_iterator it = candidates.begin(); it != candidates.end(); it++) {
+        //distance index is maximum of prev_distance and the distances from the candidate
+        unsigned current_dist = std::max(prev_dist, it->dist);
+
+        //compute time index of this new node
+        unsigned current_time = std::max(prev_time, times[it->vertex]);
+
+        //the candidates of the larger simplex are the later candidates that are also neighbors of this one
+        vertices.push_back(it->vertex);
+        if (vertices.size() < hom_dim + 2)
+            graph.intersect(it->vertex, it + 1, candidates.end(), new_candidates);
+
+        //recursion
+        build_VR_subcomplex(times, graph, vertices, new_candidates, current_time, current_dist, lists);
+        vertices.pop_back(); //finished adding children of this candidate
+    }
+} //end build_VR_subcomplex()
+
 //TODO: will the degree vector have to be treated differently? I don't think so, because it is actually
 //the vector of degree *indexes*
 
-//builds BifiltrationData representing a bifiltered Vietoris-Rips complex from metric data
-void BifiltrationData::build_DR_complex(const unsigned num_vertices, const std::vector<unsigned>& distances, const std::vector<unsigned>& degrees, const unsigned num_x, const unsigned num_y)
+//builds BifiltrationData representing a degree-Rips complex, with the distances stored in a NeighborGraph
+void BifiltrationData::build_DR_complex(const NeighborGraph& graph, const std::vector<unsigned>& degrees, const unsigned num_x, const unsigned num_y)
 {
     x_grades = num_x;
     y_grades = num_y;
+    set_num_vertices(graph.num_points());
 
     //build complex recursively
     //this also assigns global indexes to each simplex
@@ -167,110 +441,116 @@ void BifiltrationData::build_DR_complex(const unsigned num_vertices, const std::
     }
 
     std::vector<AppearanceGrades> vertex_multigrades;
-    generate_vertex_multigrades(vertex_multigrades, num_vertices, distances, degrees);
+    generate_vertex_multigrades(vertex_multigrades, graph, degrees);
 
-    std::vector<int> simplex_indices;
-    for (unsigned i = 0; i < num_vertices; i++) {
-        //Look at simplex with smallest vertex vertex i
-        simplex_indices.push_back(i);
+    //the work items of each point are the point and its edges to its neighbors
+    std::vector<unsigned> num_items(graph.num_points());
+    for (unsigned i = 0; i < graph.num_points(); i++)
+        num_items[i] = 1 + (graph.starts[i + 1] - graph.starts[i]);
 
-        //Determine the neighbors of vertex i
-        std::vector<int> candidates;
-        for (unsigned j = i + 1; j < num_vertices; j++) //Dist of (i, j) with i < j stored in distances[j(j - 1)/2 + i]
-        {
-            if (distances[j * (j - 1) / 2 + i + 1] < std::numeric_limits<unsigned>::max()) //if an edge is between i and j
-                candidates.push_back(j);
+    build_in_blocks(num_items, [&](unsigned i, unsigned first, unsigned last, SimplexLists& lists) {
+        //Look at simplex with smallest vertex vertex i, whose candidates are the neighbors of vertex i
+        std::vector<int> simplex_indices;
+        simplex_indices.push_back(i);
+        if (first == 0)
+            store_simplex(simplex_indices, vertex_multigrades[i], lists);
+
+        //recursion for the candidates first - 1, ..., last - 2
+        std::vector<NeighborGraph::Candidate> candidates, new_candidates;
+        graph.candidates(i, candidates);
+        for (auto it = candidates.begin() + std::max(first, 1u) - 1; it != candidates.begin() + last - 1; it++) {
+            unsigned min_dist = std::max(graph.dist_indexes[0], it->dist);
+            AppearanceGrades new_grades;
+            combine_multigrades(new_grades, vertex_multigrades[i], vertex_multigrades[it->vertex], min_dist);
+
+            simplex_indices.push_back(it->vertex);
+            if (simplex_indices.size() < hom_dim + 2)
+                graph.intersect(it->vertex, it + 1, candidates.end(), new_candidates);
+            build_DR_subcomplex(graph, simplex_indices, new_candidates, new_grades, vertex_multigrades, lists);
+            simplex_indices.pop_back();
         }
-        //recursion
-        build_DR_subcomplex(distances, simplex_indices, candidates, vertex_multigrades[i], vertex_multigrades);
-        simplex_indices.pop_back();
-    }
+    });
 } //end build_DR_complex()
 
-//function to build (recursively) a subcomplex for the DRips complex
-void BifiltrationData::build_DR_subcomplex(const std::vector<unsigned>& distances, std::vector<int>& parent_vertices, const std::vector<int>& candidates, const AppearanceGrades& parent_grades, const std::vector<AppearanceGrades>& vertex_multigrades)
+//function to build (recursively) a subcomplex for the DRips complex, with the distances stored in a NeighborGraph
+//  each candidate carries the largest distance from it to the parent vertices
+void BifiltrationData::build_DR_subcomplex(const NeighborGraph& graph, std::vector<int>& parent_vertices, const std::vector<NeighborGraph::Candidate>& candidates, const AppearanceGrades& parent_grades, const std::vector<AppearanceGrades>& vertex_multigrades, SimplexLists& lists) const
 {
     //Store the simplex info if it is of dimension (hom_dim - 1), hom_dim, or hom_dim+1. Dimension is parent_vertices.size() - 1
-    if (parent_vertices.size() == hom_dim) //simplex of dimension hom_dim - 1
-    {
-        //take the greatest lower bound of parent_grades, using the fact that the grades are ordered properly.
-
-        low_simplices.push_back(LowSimplexData(parent_vertices, Grade((parent_grades.end() - 1)->x, parent_grades.begin()->y)));
-    } else if (parent_vertices.size() == hom_dim + 1) //simplex of dimension hom_dim
-    {
-        mid_simplices.push_back(MidHighSimplexData(parent_vertices, parent_grades, false));
-        mid_count += parent_grades.size();
-    } else if (parent_vertices.size() == hom_dim + 2) //simplex of dimension hom_dim + 1
-    {
-        high_simplices.push_back(MidHighSimplexData(parent_vertices, parent_grades, true));
-        high_count += parent_grades.size();
+    if (!store_simplex(parent_vertices, parent_grades, lists))
         return;
-    }
 
     //loop through all points that could be added to form a larger simplex (candidates)
-    for (std::vector<int>::const_iterator it = candidates.begin(); it != candidates.end(); it++) {
-        //Determine the grades of appearance of the clique with parent_vertices and *it
-        //First determine the minimal scale parameter necessary for all the edges between the clique parent_vertices, and *it to appear
-        unsigned min_dist = distances[0];
-        for (std::vector<int>::const_iterator it2 = parent_vertices.begin(); it2 != parent_vertices.end(); it2++)
-            if (distances[(*it) * (*it - 1) / 2 + *it2 + 1] > min_dist) //By construction, each of the parent indices are strictly less than *it
-                min_dist = distances[(*it) * (*it - 1) / 2 + *it2 + 1];
+    std::vector<NeighborGraph::Candidate> new_candidates;
+    for (std::vector<NeighborGraph::Candidate>::const_iterator it = candidates.begin(); it != candidates.end(); it++) {
+        //Determine the grades of appearance of the clique with parent_vertices and the candidate, which requires
+        //all the edges between them to appear
+        unsigned min_dist = std::max(graph.dist_indexes[0], it->dist);
         AppearanceGrades new_grades;
-        combine_multigrades(new_grades, parent_grades, vertex_multigrades[*it], min_dist);
-
-        //Determine subset of candidates which are still candidates after adding *it
-        std::vector<int> new_candidates;
-        for (std::vector<int>::const_iterator it2 = it + 1; it2 != candidates.end(); it2++) {
-            if (distances[(*it2) * (*it2 - 1) / 2 + *it + 1] < std::numeric_limits<unsigned>::max()) //We know that *it2 > *it
-            {
-                new_candidates.push_back(*it2); //We knew there was connection between *it2 and all of parent_index, and now also to *it as well
-            }
-        }
+        combine_multigrades(new_grades, parent_grades, vertex_multigrades[it->vertex], min_dist);
+
+        //Determine subset of candidates which are still candidates after adding this one
+        parent_vertices.push_back(it->vertex);
+        if (parent_vertices.size() < hom_dim + 2)
+            graph.intersect(it->vertex, it + 1, candidates.end(), new_candidates);
 
-        parent_vertices.push_back(*it);
         //recurse
-        build_DR_subcomplex(distances, parent_vertices, new_candidates, new_grades, vertex_multigrades);
-        parent_vertices.pop_back(); //Finished looking at cliques adding *it as well
+        build_DR_subcomplex(graph, parent_vertices, new_candidates, new_grades, vertex_multigrades, lists);
+        parent_vertices.pop_back(); //Finished looking at cliques adding this candidate as well
     }
-
 } //end build_DR_subcomplex()
 
-//For each point in a degree-Rips bifiltration, generates an array of incomparable grades of appearance. distances should be of size vertices(vertices - 1)/2
+//For each point in a degree-Rips bifiltration, generates an array of incomparable grades of appearance
 //Degrees are stored in negative form to align with correct ordering on R
 //Stores result in the vector container "multigrades". Each vector of grades is sorted in reverse lexicographic order
-
-void BifiltrationData::generate_vertex_multigrades(std::vector<AppearanceGrades>& multigrades, const unsigned vertices, const std::vector<unsigned>& distances, const std::vector<unsigned>& degrees)
+void BifiltrationData::generate_vertex_multigrades(std::vector<AppearanceGrades>& multigrades, const NeighborGraph& graph, const std::vector<unsigned>& degrees) const
 {
-    for (unsigned i = 0; i < vertices; i++) {
-        std::vector<unsigned> neighbor_dists; //Generate list of how far the neighbors are, vertex of the neighbor does not matter
-        for (unsigned j = 0; j < vertices; j++) //Dist of (i, j) with i < j stored in distances[j(j - 1)/2 + i]
-        {
-            if (j < i && distances[i * (i - 1) / 2 + j + 1] < std::numeric_limits<unsigned>::max()) //If i and j are neighbors
-            {
-                neighbor_dists.push_back(distances[i * (i - 1) / 2 + j + 1]);
-            } else if (j > i && distances[j * (j - 1) / 2 + i + 1] < std::numeric_limits<unsigned>::max()) {
-                neighbor_dists.push_back(distances[j * (j - 1) / 2 + i + 1]);
-            }
-        }
-        std::sort(neighbor_dists.begin(), neighbor_dists.end());
-        AppearanceGrades i_grades; //Stores grades of appearance for vertex i
-        unsigned min_scale;
-        i_grades.push_back(Grade(degrees[0], distances[0])); //Every point has a grade of appearance at degree = 0, scale = 0
-        for (unsigned j = 0; j < neighbor_dists.size();) {
-            min_scale = neighbor_dists[j];
-            while (j < neighbor_dists.size() && neighbor_dists[j] == min_scale)
-                j++; //Iterate until the next distance is > minScale
-            i_grades.push_back(Grade(degrees[j], min_scale)); //If the scale parameter is >= minScale, then vertex i has at least neighbor_dists.size() - (j + 1) neighbors.
-        }
-        update_grades(i_grades); //Makes sure all of them are incomparable after the binning
-        multigrades.push_back(i_grades);
+    //the distances to the neighbors of vertex i are stored in neighbor_dists[offsets[i]], ..., neighbor_dists[offsets[i + 1] - 1]:
+    //  first those of the neighbors before i, whose edges are stored in their rows, then those of its own row
+    unsigned num_points = graph.num_points();
+    std::vector<std::size_t> offsets(num_points + 1, 0);
+    for (std::size_t e = 1; e < graph.neighbors.size(); e++)
+        offsets[graph.neighbors[e] + 1]++;
+    for (unsigned i = 0; i < num_points; i++)
+        offsets[i + 1] += offsets[i] + (graph.starts[i + 1] - graph.starts[i]);
+
+    std::vector<unsigned> neighbor_dists(offsets[num_points]);
+    std::vector<std::size_t> next(offsets.begin(), offsets.end() - 1);
+    for (unsigned i = 0; i < num_points; i++)
+        for (std::size_t e = graph.starts[i]; e < graph.starts[i + 1]; e++)
+            neighbor_dists[next[graph.neighbors[e]]++] = graph.dist_indexes[e];
+
+    //sort the distances of each vertex, and generate its grades
+    multigrades.resize(num_points);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (long i = 0; i < (long)num_points; i++) {
+        std::copy(graph.dist_indexes.begin() + graph.starts[i], graph.dist_indexes.begin() + graph.starts[i + 1], neighbor_dists.begin() + next[i]);
+        std::sort(neighbor_dists.begin() + offsets[i], neighbor_dists.begin() + offsets[i + 1]);
+        multigrades[i] = vertex_grades(neighbor_dists.data() + offsets[i], offsets[i + 1] - offsets[i], degrees, graph.dist_indexes[0]);
     }
 } //end generate_vertex_multigrades()
 
+//Generates the array of incomparable grades of appearance of a vertex, given the sorted distances to its neighbors
+//and the discrete distance zero_dist of a point to itself
+AppearanceGrades BifiltrationData::vertex_grades(const unsigned* neighbor_dists, const std::size_t num_neighbors, const std::vector<unsigned>& degrees, const unsigned zero_dist) const
+{
+    AppearanceGrades i_grades; //Stores grades of appearance for the vertex
+    unsigned min_scale;
+    i_grades.push_back(Grade(degrees[0], zero_dist)); //Every point has a grade of appearance at degree = 0, scale = 0
+    for (std::size_t j = 0; j < num_neighbors;) {
+        min_scale = neighbor_dists[j];
+        while (j < num_neighbors && neighbor_dists[j] == min_scale)
+            j++; //Iterate until the next distance is > minScale
+        i_grades.push_back(Grade(degrees[j], min_scale)); //If the scale parameter is >= minScale, then the vertex has at least num_neighbors - (j + 1) neighbors.
+    }
+    update_grades(i_grades); //Makes sure all of them are incomparable after the binning
+    return i_grades;
+} //end vertex_grades()
+
 //Determines the grades of appearance of when both simplices exist subject to some minimal distance parameter min_dist
 //Grade arrays are assumed to be sorted in reverse lexicographic order, output will be sorted in reverse lexicographic order
 //Takes the intersection of the grades of appearances and the half plane y >= min_dist
-void BifiltrationData::combine_multigrades(AppearanceGrades& merged, const AppearanceGrades& grades1, const AppearanceGrades& grades2, const unsigned min_dist)
+void BifiltrationData::combine_multigrades(AppearanceGrades& merged, const AppearanceGrades& grades1, const AppearanceGrades& grades2, const unsigned min_dist) const
 {
     AppearanceGrades::const_iterator it1 = grades1.begin();
     AppearanceGrades::const_iterator it2 = grades2.begin();
@@ -311,7 +591,7 @@ void BifiltrationData::combine_multigrades(AppearanceGrades& merged, const Appea
 } //end combine_multigrades
 
 //Given a list of multigrades, sort them and remove all comparable multigrades
-void BifiltrationData::update_grades(AppearanceGrades& grades)
+void BifiltrationData::update_grades(AppearanceGrades& grades) const
 {
     //Sort grades
     std::sort(grades.begin(), grades.end());
@@ -365,15 +645,17 @@ void BifiltrationData::print_bifiltration()
 
     //these three similar nested loops could be combined, but it's not such a big deal.
     for (std::vector<LowSimplexData>::const_iterator it = low_simplices.begin(); it != low_simplices.end(); it++) {
-        for (Simplex::const_iterator it2 = it->s.begin(); it2 != it->s.end(); it2++) {
+        Simplex vertices = encoder.vertices(it->s, hom_dim);
+        for (Simplex::const_iterator it2 = vertices.begin(); it2 != vertices.end(); it2++) {
             std::cout << *it2 << " ";
         }
         std::cout << "; "; //Separator of vertex and grade info
         std::cout << it->gr.x << " " << it->gr.y << std::endl;
     }
 
-    for (std::vector<MidHighSimplexData>::const_iterator it = mid_simplices.begin(); it != mid_simplices.end(); it++) {
-        for (Simplex::const_iterator it2 = it->s.begin(); it2 != it->s.end(); it2++) {
+    for (std::vector<MidSimplexData>::const_iterator it = mid_simplices.begin(); it != mid_simplices.end(); it++) {
+        Simplex vertices = encoder.vertices(it->s, hom_dim + 1);
+        for (Simplex::const_iterator it2 = vertices.begin(); it2 != vertices.end(); it2++) {
             std::cout << *it2 << " ";
         }
         std::cout << "; "; //Separator of vertex and grade info
@@ -383,13 +665,16 @@ void BifiltrationData::print_bifiltration()
         std::cout << std::endl;
     }
 
-    for (std::vector<MidHighSimplexData>::const_iterator it = high_simplices.begin(); it != high_simplices.end(); it++) {
-        for (Simplex::const_iterator it2 = it->s.begin(); it2 != it->s.end(); it2++) {
+    //the grades of appearance of a simplex are stored one after another
+    for (std::vector<HighSimplexData>::const_iterator it = high_simplices.begin(); it != high_simplices.end();) {
+        Simplex vertices = encoder.vertices(it->s, hom_dim + 2);
+        for (Simplex::const_iterator it2 = vertices.begin(); it2 != vertices.end(); it2++) {
             std::cout << *it2 << " ";
         }
         std::cout << "; "; //Separator of vertex and grade info
-        for (AppearanceGrades::const_iterator it2 = it->grades_vec.begin(); it2 != it->grades_vec.end(); it2++) {
-            std::cout << it2->x << " " << it2->y << " ";
+        SimplexIndex s = it->s;
+        for (; it != high_simplices.end() && it->s == s; it++) {
+            std::cout << it->gr.x << " " << it->gr.y << " ";
         }
         std::cout << std::endl;
     }
@@ -33,59 +33,114 @@
  Replaces the SimplexTree class used in earlier versions of RIVET.
  
  
+ Class: SimplexEncoder
+
+ Description: Encodes a simplex by its index in the combinatorial number system,
+ as in DIPHA or Ripser: a simplex with vertices v_0 < v_1 < ... < v_k has index
+ C(v_0, 1) + C(v_1, 2) + ... + C(v_k, k+1).  Simplices of the same dimension have
+ distinct indices, and the faces of a simplex are computed arithmetically from
+ its index.
+
  Struct: LowSimplexData
    
  Description: Stores a simplex of dimension hom_dim - 1, together
  with the greatest lower bound of all grades of appearance of that simplex.
  
- Struct: MidHighSimplexData s
+ Struct: MidSimplexData s
  
- Description: Stores a simplex s of dimension hom_dim or
- hom_dim+1, together with the bigrades of appearance of s.  Also can store the
- column indices corresponding to copies of s, though this is only
- used for simplices of dimension hom_dim.  The reason for using a single data
- structure to handle simplces of dimension hom_dim and hom_dim+1 is that for 
- multicritical filtrations, columns in the high matrix in an FIRep can correspond 
- to either simplicies of dimension hom_dim + 1, or relations.  The relations are
- indexed by simplcies of dimension hom_dim; working with a single data structure 
- for both types is convenient for sorting the columns of the high matrix.
+ Description: Stores a simplex s of dimension hom_dim, together with the
+ bigrades of appearance of s, and the column indices in the low matrix of an
+ FIRep corresponding to copies of s.  For multicritical filtrations, the
+ relations between consecutive bigrades of s also index columns of the high
+ matrix.
+
+ Struct: HighSimplexData
+
+ Description: Stores a simplex of dimension hom_dim+1 together with one of its
+ bigrades of appearance; a simplex with several bigrades of appearance is
+ stored once for each of them.  Each of these pairs indexes a column of the
+ high matrix of an FIRep, which is computed from the index of the simplex, so
+ only 32 bytes are stored per column, less than the column itself takes.
 */
 
 #ifndef BIFILTRATION_DATA_H
 #define BIFILTRATION_DATA_H
 
 #include "grade.h"
-#include <boost/functional/hash.hpp>
+#include "neighbor_graph.h"
 #include <set>
-#include <unordered_map>
 #include <vector>
 
+#ifndef __SIZEOF_INT128__
+#include <boost/multiprecision/cpp_int.hpp>
+#endif
+
 //typedefs
-//TODO: It is probably bettter to specify a simplex using a combinatorial
-//number system, as in DIPHA or Ripser.
-typedef std::vector<int> Simplex;
+typedef std::vector<int> Simplex; //sorted vertices of a simplex
 typedef std::vector<Grade> AppearanceGrades;
 
+//index of a simplex in the combinatorial number system; 128 bits, so that
+//simplices of dimension up to 6 on about a million vertices can be indexed
+//  (__extension__ keeps -pedantic from warning about the non-standard type)
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 SimplexIndex;
+#else
+typedef boost::multiprecision::uint128_t SimplexIndex;
+#endif
+
+class SimplexEncoder {
+public:
+    SimplexEncoder();
+
+    //tabulates the binomial coefficients needed for simplices with at most max_size vertices in [0, num_vertices)
+    //  throws std::runtime_error if the indexes of these simplices do not fit in a SimplexIndex
+    SimplexEncoder(unsigned num_vertices, unsigned max_size);
+
+    unsigned num_vertices() const { return vertex_count; }
+
+    //returns the index of the simplex with the given sorted vertices
+    SimplexIndex encode(const Simplex& vertices) const;
+
+    //computes the indexes of the faces of the simplex with the given index and number of vertices;
+    //  faces[j] is the face without the j-th smallest vertex
+    void faces(SimplexIndex index, unsigned size, SimplexIndex* faces) const;
+
+    //returns the sorted vertices of the simplex with the given index and number of vertices
+    Simplex vertices(SimplexIndex index, unsigned size) const;
+
+private:
+    unsigned vertex_count;
+    unsigned max_size;
+    std::vector<SimplexIndex> binomials; //binomials[k * (vertex_count + 1) + v] is C(v, k)
+
+    const SimplexIndex& binomial(unsigned v, unsigned k) const
+    {
+        return binomials[k * (vertex_count + 1) + v];
+    }
+
+    //returns the largest vertex v < top such that C(v, k) <= index
+    unsigned max_vertex(const SimplexIndex& index, unsigned k, unsigned top) const;
+};
+
 struct LowSimplexData {
-    Simplex s;
+    SimplexIndex s;
     Grade gr;
 
-    LowSimplexData(Simplex simplex, Grade grade)
+    LowSimplexData(SimplexIndex simplex, Grade grade)
         : s(simplex)
         , gr(grade)
     {
     }
 };
 
-struct MidHighSimplexData {
-    Simplex s;
+struct MidSimplexData {
+    SimplexIndex s;
 
     //vector of grades of appearance of s
     AppearanceGrades grades_vec;
 
     //Vector of the column indices in the low matrix corresponding to s.
     //Used to construct high boundary matrix.
-    //Only used for simplcies of dimension hom_dim, not hom_dim_1.
     std::vector<unsigned> col_inds;
 
     AppearanceGrades::iterator grades_it;
@@ -94,23 +149,22 @@ struct MidHighSimplexData {
     //iterator pointing to grades_vec?
     //std::vector<unsigned>::iterator ind_it;
 
-    bool high;
-
-    virtual bool is_high() const
-    {
-        return high;
-    }
-
-    //TODO: This is a little inefficient, since high_simplex data doesn't
-    //actually need the data of col_inds or grades_it.  Since building the high
-    //simplices can be very demanding of memory, it is probably worthwhile to
-    //optimize this more.
-    MidHighSimplexData(Simplex simplex, AppearanceGrades grades, bool is_high)
+    MidSimplexData(SimplexIndex simplex, AppearanceGrades grades)
         : s(simplex)
         , grades_vec(grades)
         , col_inds(std::vector<unsigned>())
         , grades_it(grades_vec.begin())
-        , high(is_high)
+    {
+    }
+};
+
+struct HighSimplexData {
+    SimplexIndex s;
+    Grade gr;
+
+    HighSimplexData(SimplexIndex simplex, Grade grade)
+        : s(simplex)
+        , gr(grade)
     {
     }
 };
@@ -129,7 +183,8 @@ public:
     /* 
     build_VR_complex() builds BifiltrationData representing a bifiltered
     Vietoris-Rips complex from metric data, via a straighforward recursive
-    algorithm.
+    algorithm.  The recursion is split into blocks built in parallel, and
+    the simplices are stored in the same order as by a serial construction.
     NOTE: This gives a 1-critical bifiltration, i.e., one where each simplex
     has a unique bigrade of appearance.
     
@@ -146,36 +201,48 @@ public:
         const unsigned num_x,
         const unsigned num_y);
 
+    //as above, with the discrete distances between pairs of points stored in
+    //a NeighborGraph instead of a triangle
+    void build_VR_complex(const std::vector<unsigned>& times,
+        const NeighborGraph& graph,
+        const unsigned num_x,
+        const unsigned num_y);
+
     /* 
     build_DR_complex() builds BifiltrationData representing a degree-Rips 
      complex from metric data.  The algorithm for this uses a sweepline
-     procedure designed by Roy.
+     procedure designed by Roy.  As for build_VR_complex(), the recursion is
+     split into blocks built in parallel.
      
     NOTE: This gives a multi-critical bifiltration, i.e., one where each simplex
     may have multiple grades of appearance.
      
     requires:
-    -the number of vertices,
-    -a vector of distances between pairs of points,
+    -a NeighborGraph with the discrete distances between neighboring points,
     -a vector for degree to y value exchange,
     -number of grade values in x- and y-directions
     /
      /CONVENTION: the x-coordinate is "scale parameter" for points 
      and the y-coordinate is "degree parameter"
     */
-    void build_DR_complex(const unsigned num_vertices,
-        const std::vector<unsigned>& distances,
+    void build_DR_complex(const NeighborGraph& graph,
         const std::vector<unsigned>& degrees,
         const unsigned num_x,
         const unsigned num_y);
 
+    /*
+    set_num_vertices() must be called before add_simplex(), with a bound on
+    the vertices of the simplices to be added.
+    */
+    void set_num_vertices(unsigned num_vertices);
+
     /*
     add_simplex() adds a simplex to BifiltrationData.
     grades is a vector of appearance grades
     NOTE: Changed behavior of add_simplex so that it no longer recursively
           adds in faces.
     */
-    void add_simplex(const std::vector<int>& vertices,
+    void add_simplex(const Simplex& vertices,
         const AppearanceGrades& grades);
 
     //Sets x_grades and y_grades.
@@ -190,6 +257,7 @@ public:
 
     //returns the number of simplices of dimension (hom_dim-1), hom_dim,
     //or (hom_dim+1).  Assumes dim is non-negative.  Returns -1 if invalid dim.
+    //Simplices of dimension hom_dim+1 are counted once for each grade of appearance.
     int get_size(unsigned dim);
 
     //the dimension of homology to be computed.
@@ -201,7 +269,7 @@ public:
 
     //Sorts the grades of appearance in reverse lexicographic order
     //and makes sure they are all incomparable
-    void update_grades(AppearanceGrades& grades);
+    void update_grades(AppearanceGrades& grades) const;
     
     //print bifiltration in the RIVET bifiltration input format
     void print_bifiltration();
@@ -211,41 +279,89 @@ private:
     unsigned x_grades;
     unsigned y_grades;
 
+    //encodes the simplices as their indexes in the combinatorial number system
+    SimplexEncoder encoder;
+
     std::vector<LowSimplexData> low_simplices;
-    std::vector<MidHighSimplexData> mid_simplices, high_simplices;
+    std::vector<MidSimplexData> mid_simplices;
+    std::vector<HighSimplexData> high_simplices; //in the order in which they are built
+
+    //simplices built by one block of a parallel construction, in the order
+    //in which they are built
+    struct SimplexLists {
+        std::vector<LowSimplexData> low;
+        std::vector<MidSimplexData> mid;
+        std::vector<HighSimplexData> high;
+        unsigned mid_count = 0;
+    };
+
+    //splits the construction of a complex into blocks of consecutive work
+    //items, which are built in parallel and then stored in order.
+    //Vertex i has num_items[i] items: item 0 is the vertex itself, and item k
+    //is the cofaces of the edge from i to its k-th neighbor after it.
+    //build(i, first, last, lists) builds the items in [first, last) of vertex i.
+    template <typename BuildItems>
+    void build_in_blocks(const std::vector<unsigned>& num_items, BuildItems build);
+
+    //stores a simplex with the given grades of appearance if it has dimension
+    //hom_dim-1, hom_dim, or hom_dim+1; returns false if the simplex has
+    //dimension hom_dim+1, so that its cofaces are not needed
+    bool store_simplex(const std::vector<int>& vertices,
+        const Grade& grade,
+        SimplexLists& lists) const;
+    bool store_simplex(const std::vector<int>& vertices,
+        const AppearanceGrades& grades,
+        SimplexLists& lists) const;
 
     //recursive function used in build_VR_complex()
     void build_VR_subcomplex(const std::vector<unsigned>& times,
         const std::vector<unsigned>& distances,
         std::vector<int>& vertices,
         const unsigned prev_time,
-        const unsigned prev_dist);
+        const unsigned prev_dist,
+        SimplexLists& lists) const;
+
+    //recursive function used in build_VR_complex() with a NeighborGraph;
+    //candidates are the vertices that may be added to the simplex
+    void build_VR_subcomplex(const std::vector<unsigned>& times,
+        const NeighborGraph& graph,
+        std::vector<int>& vertices,
+        const std::vector<NeighborGraph::Candidate>& candidates,
+        const unsigned prev_time,
+        const unsigned prev_dist,
+        SimplexLists& lists) const;
 
     //recursive function used in build_DR_complex()
-    void build_DR_subcomplex(const std::vector<unsigned>& distances,
+    void build_DR_subcomplex(const NeighborGraph& graph,
         std::vector<int>& parent_indexes,
-        const std::vector<int>& candidates,
+        const std::vector<NeighborGraph::Candidate>& candidates,
         const AppearanceGrades& parent_grades,
-        const std::vector<AppearanceGrades>& vertex_multigrades);
+        const std::vector<AppearanceGrades>& vertex_multigrades,
+        SimplexLists& lists) const;
 
     //Generates required multigrades for build_DR_complex()
     void generate_vertex_multigrades(std::vector<AppearanceGrades>& multigrades,
-        const unsigned vertices,
-        const std::vector<unsigned>& distances,
-        const std::vector<unsigned>& degrees);
+        const NeighborGraph& graph,
+        const std::vector<unsigned>& degrees) const;
+
+    //Generates the multigrades of a vertex from the sorted distances to its
+    //num_neighbors neighbors.  Used in generate_vertex_multigrades()
+    AppearanceGrades vertex_grades(const unsigned* neighbor_dists,
+        const std::size_t num_neighbors,
+        const std::vector<unsigned>& degrees,
+        const unsigned zero_dist) const;
 
     //Finds the grades of appearance of when both simplices exist.
     //subject to minimum scale parameter. Used in build_DR_complex()
     void combine_multigrades(AppearanceGrades& merged,
         const AppearanceGrades& grades1,
         const AppearanceGrades& grades2,
-        unsigned mindist);
+        unsigned mindist) const;
 
-    //total number of simplces of dimensions hom_dim and hom_dim+1,
+    //total number of simplces of dimension hom_dim,
     //counting mutiplicity in grades of appearance.
     //Used to avoid unnecessary resizing of arrays in firep constructor.
     unsigned mid_count;
-    unsigned high_count;
 };
 
 #endif // BIFILTRATION_DATA_H
@@ -21,18 +21,29 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "distance_matrix.h"
 #include "../debug.h"
 #include "../numerics.h"
+#include "parallel_sort.h"
+#include "quantile_sketch.h"
 
+#include <algorithm>
+#include <cmath>
 #include <math.h>
+#include <numeric>
+#include <stdexcept>
 #include <string>
 
 DistanceMatrix::DistanceMatrix(InputParameters& params, int np)
     : input_params(params)
     , max_dist(input_params.max_dist)
+    , max_dist_value(max_dist)
     , num_points(np)
     , dimension(input_params.dimension)
     , filtration(input_params.bifil)
     , func_type(input_params.function_type)
+    , sparse(false)
+    , distances_binned(false)
 {
+    //the function estimators use dist_grades, so quantile bins can be estimated as the distances are stored only without them
+    stream_distances = input_params.y_quantiles && input_params.y_bins > 0 && !(filtration == "function" && func_type != "user");
 
     // we make the degree filtration only when
     // we are building a degree-Rips
@@ -50,152 +61,149 @@ DistanceMatrix::~DistanceMatrix()
     std::vector<unsigned>().swap(function_indexes);
     std::vector<unsigned>().swap(degree_indexes);
 
-    std::set<ExactValue, ExactValueComparator>().swap(dist_set);
-    std::set<ExactValue, ExactValueComparator>().swap(function_set);
-    std::set<ExactValue, ExactValueComparator>().swap(degree_set);
+    dist_grades.clear();
+    function_grades.clear();
 
     if (filtration == "degree")
         delete degree;
 }
 
-void DistanceMatrix::ball_density_estimator(double radius)
+namespace {
+
+//calls visit(i, j, distance) for each point i in [first, last) and each point j, with j in increasing order for each i
+//  the distance from a point to itself is 0, and the others are read from triangle, in the layout of compute_distances()
+//  a block of consecutive points is visited together, so that the rows of the triangle are read in order
+template <typename Visit>
+void visit_distances(const double* triangle, unsigned num_points, unsigned first, unsigned last, Visit visit)
 {
-    // first we reconstruct the actual distance matrix from the distance set
-    // it is a diagonal matrix
-    unsigned size = (num_points * (num_points - 1)) / 2 + 1;
-    double* distance_matrix = new double[size];
-    double* gvalues = new double[num_points];
-    double total = 0;
+    for (unsigned j = 0; j < num_points; j++) {
+        const double* row = triangle + (size_t)j * (j - 1) / 2 + 1; //distances from point j to points 0, ..., j - 1
+        for (unsigned i = first; i < last; i++) {
+            if (i < j)
+                visit(i, j, row[i]);
+            else if (i > j)
+                visit(i, j, triangle[(size_t)i * (i - 1) / 2 + j + 1]);
+            else
+                visit(i, j, 0.0);
+        }
+    }
+}
+
+//reads a distance matrix from the input file, after the lines to skip, and calls visit(i, j, token) for each pair of points i < j
+//  with the token that holds their distance, row by row; the rows hold either the full matrix or only the entries above its diagonal
+template <typename Visit>
+void read_rows(const InputParameters& params, unsigned num_points, Visit visit)
+{
+    FileTokenizer reader(params.fileName);
+
+    for (int i = 0; i < params.to_skip; i++)
+        reader.next_line(0);
 
-    ExactSet::iterator it;
+    unsigned expectedNumTokens = num_points;
+
+    //read distances from each point to all following points; the last point has no following points, and no line
+    for (unsigned i = 0; i + 1 < num_points; i++) {
+        // TODO: Add error more error handling?
+
+        //the reader keeps the previous line if there is no next line
+        if (reader.has_next_line())
+            reader.next_line(0);
+        const std::vector<FileTokenizer::Token>& line = reader.current_line();
+
+        //index of the token that holds the distance from point i to point i + 1
+        unsigned first_token;
+
+        // skip lower triangle if full distance matrix is supplied
+        if (line.size() == num_points && num_points == expectedNumTokens) {
+            first_token = i + 1;
+        } else if (line.size() == expectedNumTokens - 1) {
+            first_token = 0;
+            expectedNumTokens--;
+        } else {
+            throw std::runtime_error("Expected " + std::to_string(expectedNumTokens - 1) + " numbers, got " + std::to_string(line.size()) + " at line " + std::to_string(reader.line_number()));
+        }
 
-    // look at ExactValue struct to understand better
-    for (it = dist_set.begin(); it != dist_set.end(); it++) {
-        ExactValue curr_dist = *it;
-        double val = curr_dist.double_value;
-        for (unsigned j = 0; j < curr_dist.indexes.size(); j++) {
-            unsigned index = curr_dist.indexes[j];
-            distance_matrix[index] = val;
+        try {
+            for (unsigned j = i + 1; j < num_points; j++)
+                visit(i, j, line[first_token + j - i - 1]);
+        } catch (std::exception& e) {
+            throw InputError(reader.line_number(), e.what());
         }
+    } //end for
+}
+
+} //end anonymous namespace
+
+const std::vector<double>& DistanceMatrix::approximate_distances()
+{
+    if (approx_distances.empty()) {
+        approx_distances.resize((size_t)num_points * (num_points - 1) / 2 + 1);
+        dist_grades.values_by_index(approx_distances.data());
     }
+    return approx_distances;
+}
+
+double DistanceMatrix::distance_percentile(double fraction)
+{
+    //select the value that would be at this position if all entries of the triangle were sorted
+    std::vector<double> entries(approximate_distances());
+    size_t position = (size_t)(entries.size() * fraction);
+    std::nth_element(entries.begin(), entries.begin() + position, entries.end());
+    return entries[position];
+}
+
+void DistanceMatrix::ball_density_estimator(double radius)
+{
+    const std::vector<double>& distances = approximate_distances();
 
     // set a default radius if no radius parameter is supplied
-    if (radius == 0) {
-        std::vector<double> sorted; // sorted will hold sorted values of distance matrix
-        for (unsigned i = 0; i < size; i++)
-            sorted.push_back(distance_matrix[i]);
-        std::sort(sorted.begin(), sorted.end());
-        int twenty_percentile = (int)(sorted.size() * 0.2); // we select the 20th percentile
-        radius = sorted[twenty_percentile];
-        std::vector<double>().swap(sorted); // free up the memory
-    }
+    if (radius == 0)
+        radius = distance_percentile(0.2); // we select the 20th percentile
 
     // check if distance less than supplied radius
     // if yes, increase density value by 1
-    for (unsigned i = 0; i < num_points; i++) {
-        double d = 0;
-        for (unsigned j = 0; j < num_points; j++) {
-            if ((i == j)
-                || (j > i && (distance_matrix[(j * (j - 1)) / 2 + i + 1] <= radius))
-                || (i > j && (distance_matrix[(i * (i - 1)) / 2 + j + 1] <= radius))) {
-                d = d + 1;
-            }
-        }
-        gvalues[i] = d;
-        total += d;
-    }
-
-    for (unsigned i = 0; i < num_points; i++) {
-        gvalues[i] /= total;
-        exact value = gvalues[i];
-        if (input_params.x_reverse)
-            value = -1*value;
-        ret = function_set.insert(ExactValue(value));
-        (ret.first)->indexes.push_back(i);
+    std::vector<double> gvalues(num_points, 0);
+    int num_blocks = (num_points + ROW_BLOCK - 1) / ROW_BLOCK;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        visit_distances(distances.data(), num_points, b * ROW_BLOCK, std::min((b + 1) * ROW_BLOCK, num_points),
+            [&gvalues, radius](unsigned i, unsigned j, double dist) {
+                if (i == j || dist <= radius)
+                    gvalues[i] += 1;
+            });
     }
 
-    delete[] gvalues;
-    delete[] distance_matrix; // free up the memory
+    store_function_values(gvalues);
 }
 
 void DistanceMatrix::gaussian_estimator(double s)
 {
-    // first we reconstruct the actual distance matrix from the distance set
-    // it is a diagonal matrix
-    unsigned size = (num_points * (num_points - 1)) / 2 + 1;
-    double* distance_matrix = new double[size];
-    double* gvalues = new double[num_points];
-    double total = 0;
-
-    ExactSet::iterator it;
+    const std::vector<double>& distances = approximate_distances();
 
-    // look at ExactValue struct to understand better
-    for (it = dist_set.begin(); it != dist_set.end(); it++) {
-        ExactValue curr_dist = *it;
-        double val = curr_dist.double_value;
-        for (unsigned j = 0; j < curr_dist.indexes.size(); j++) {
-            unsigned index = curr_dist.indexes[j];
-            distance_matrix[index] = val;
-        }
-    }
-
-    if (s == 0) {
-        std::vector<double> sorted; // sorted will hold sorted values of distance matrix
-        for (unsigned i = 0; i < size; i++)
-            sorted.push_back(distance_matrix[i]);
-        std::sort(sorted.begin(), sorted.end());
-        int twenty_percentile = (int)(sorted.size() * 0.2); // we select the 20th percentile
-        s = sorted[twenty_percentile];
-        std::vector<double>().swap(sorted); // free up the memory
-    }
+    if (s == 0)
+        s = distance_percentile(0.2); // we select the 20th percentile
 
     s = 2*s*s;
 
-    for (unsigned i = 0; i < num_points; i++) {
-        double d = 0;
-        for (unsigned j = 0; j < num_points; j++) {
-            if (i > j)
-                d += exp(-1*pow(distance_matrix[(i * (i - 1)) / 2 + j + 1], 2)/s);
-            if (j > i)
-                d += exp(-1*pow(distance_matrix[(j * (j - 1)) / 2 + i + 1], 2)/s);
-            if (i == j)
-                d += 1;
-        }
-        gvalues[i] = d;
-        total += d;
-    }
-
-    for (unsigned i = 0; i < num_points; i++) {
-        gvalues[i] /= total;
-        exact value = gvalues[i];
-        if (input_params.x_reverse)
-            value = -1*value;
-        ret = function_set.insert(ExactValue(value));
-        (ret.first)->indexes.push_back(i);
+    std::vector<double> gvalues(num_points, 0);
+    int num_blocks = (num_points + ROW_BLOCK - 1) / ROW_BLOCK;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        visit_distances(distances.data(), num_points, b * ROW_BLOCK, std::min((b + 1) * ROW_BLOCK, num_points),
+            [&gvalues, s](unsigned i, unsigned j, double dist) {
+                if (i == j)
+                    gvalues[i] += 1;
+                else
+                    gvalues[i] += exp(-1 * (dist * dist) / s);
+            });
     }
 
-    delete[] gvalues;
-    delete[] distance_matrix; // free up the memory
+    store_function_values(gvalues);
 }
 
 void DistanceMatrix::knn_density_estimator(int k)
 {
-    // first we reconstruct the actual distance matrix from the distance set
-    // it is a diagonal matrix
-    unsigned size = (num_points * (num_points - 1)) / 2 + 1;
-    double* distance_matrix = new double[size];
-
-    ExactSet::iterator it;
-
-    // look at ExactValue struct to understand better
-    for (it = dist_set.begin(); it != dist_set.end(); it++) {
-        ExactValue curr_dist = *it;
-        double val = curr_dist.double_value;
-        for (unsigned j = 0; j < curr_dist.indexes.size(); j++) {
-            unsigned index = curr_dist.indexes[j];
-            distance_matrix[index] = val;
-        }
-    }
+    const std::vector<double>& distances = approximate_distances();
 
     if (k == 0)
         k = 1; // set default
@@ -203,50 +211,38 @@ void DistanceMatrix::knn_density_estimator(int k)
         k = num_points - 1; // return farthest neighbor if out of bounds
 
     // store all distance values of a point in a vector
-    // sort it
     // select kth value
-    for (unsigned i = 0; i < num_points; i++) {
-        exact value;
-        std::vector<double> d;
-        for (unsigned j = 0; j < num_points; j++) {
-            if (i > j)
-                d.push_back(distance_matrix[(i * (i - 1)) / 2 + j + 1]);
-            if (j > i)
-                d.push_back(distance_matrix[(j * (j - 1)) / 2 + i + 1]);
+    int num_blocks = (num_points + ROW_BLOCK - 1) / ROW_BLOCK;
+    std::vector<double> values(num_points);
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        unsigned first = b * ROW_BLOCK;
+        unsigned last = std::min(first + ROW_BLOCK, num_points);
+        std::vector<std::vector<double>> rows(last - first);
+        for (auto& row : rows)
+            row.reserve(num_points - 1);
+        visit_distances(distances.data(), num_points, first, last, [&rows, first](unsigned i, unsigned j, double dist) {
+            if (i != j)
+                rows[i - first].push_back(dist);
+        });
+        for (unsigned i = first; i < last; i++) {
+            std::vector<double>& row = rows[i - first];
+            std::nth_element(row.begin(), row.begin() + (k - 1), row.end());
+            values[i] = row[k - 1];
         }
-        std::sort(d.begin(), d.end());
-        value = d[k - 1];
-
+    }
 
+    for (unsigned i = 0; i < num_points; i++) {
+        exact value = values[i];
         if (input_params.x_reverse)
             value = -1*value;
-        ret = function_set.insert(ExactValue(value));
-        (ret.first)->indexes.push_back(i);
-
-        std::vector<double>().swap(d); // free up space used by vector
+        function_grades.add(rivet::numeric::SmallRational(value), i);
     }
-
-    delete[] distance_matrix; // free up the memory
 }
 
 void DistanceMatrix::eccentricity_estimator(int p)
 {
-    // first we reconstruct the actual distance matrix from the distance set
-    // it is a diagonal matrix
-    unsigned size = (num_points * (num_points - 1)) / 2 + 1;
-    double* distance_matrix = new double[size];
-
-    ExactSet::iterator it;
-
-    // look at ExactValue struct to understand better
-    for (it = dist_set.begin(); it != dist_set.end(); it++) {
-        ExactValue curr_dist = *it;
-        double val = curr_dist.double_value;
-        for (unsigned j = 0; j < curr_dist.indexes.size(); j++) {
-            unsigned index = curr_dist.indexes[j];
-            distance_matrix[index] = val;
-        }
-    }
+    const std::vector<double>& distances = approximate_distances();
 
     if (p == 0)
         p = 1; // set default
@@ -254,70 +250,76 @@ void DistanceMatrix::eccentricity_estimator(int p)
     // take a distance for a point
     // raise it to pth power and keep adding
     // divide by num_points and take 1/p power
+    std::vector<double> sums(num_points, 0);
+    int num_blocks = (num_points + ROW_BLOCK - 1) / ROW_BLOCK;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < num_blocks; b++) {
+        visit_distances(distances.data(), num_points, b * ROW_BLOCK, std::min((b + 1) * ROW_BLOCK, num_points),
+            [&sums, p](unsigned i, unsigned j, double dist) {
+                if (i != j)
+                    sums[i] += pow(dist, p);
+            });
+    }
+
     for (unsigned i = 0; i < num_points; i++) {
-        exact value;
-        double d = 0;
-        for (unsigned j = 0; j < num_points; j++) {
-            if (i > j)
-                d += pow(distance_matrix[(i * (i - 1)) / 2 + j + 1], p);
-            if (j > i)
-                d += pow(distance_matrix[(j * (j - 1)) / 2 + i + 1], p);
-        }
-        d = d / num_points;
+        double d = sums[i] / num_points;
         d = pow(d, 1.0 / p);
-        value = d;
+        exact value = d;
 
         if (input_params.x_reverse)
             value = -1*value;
-        ret = function_set.insert(ExactValue(value));
-        (ret.first)->indexes.push_back(i);
+        function_grades.add(rivet::numeric::SmallRational(value), i);
     }
+}
+
+//normalizes the density values so that they sum to 1, and stores them as the function values of the points
+void DistanceMatrix::store_function_values(std::vector<double>& gvalues)
+{
+    double total = 0;
+    for (unsigned i = 0; i < num_points; i++)
+        total += gvalues[i];
 
-    delete[] distance_matrix; // free up the memory
+    for (unsigned i = 0; i < num_points; i++) {
+        gvalues[i] /= total;
+        exact value = gvalues[i];
+        if (input_params.x_reverse)
+            value = -1*value;
+        function_grades.add(rivet::numeric::SmallRational(value), i);
+    }
 }
 
 void DistanceMatrix::build_distance_matrix(std::vector<DataPoint>& points)
 {
-    ret = dist_set.insert(ExactValue(exact(0))); //distance from a point to itself is always zero
-    (ret.first)->indexes.push_back(0); //store distance 0 at 0th index
-    //consider all points
+    //store the function values, and copy the coordinates of the points into a single array
+    std::vector<double> coords;
+    coords.reserve((size_t)num_points * dimension);
     for (unsigned i = 0; i < num_points; i++) {
         if (func_type == "user" && filtration == "function") {
-            //store time value, if it doesn't exist already
-            ret = function_set.insert(ExactValue(points[i].birth));
-
             //remember that point i has this birth time value
-            (ret.first)->indexes.push_back(i);
+            function_grades.add(rivet::numeric::SmallRational(points[i].birth), i);
         }
+        coords.insert(coords.end(), points[i].coords.begin(), points[i].coords.begin() + dimension);
+    }
 
-        //compute (approximate) distances from this point to all following points
-        for (unsigned j = i + 1; j < num_points; j++) {
-            //compute (approximate) distance squared between points[i] and points[j]
-            double fp_dist_squared = 0;
-            for (unsigned k = 0; k < dimension; k++) {
-                double kth_dist = points[i].coords[k] - points[j].coords[k];
-                fp_dist_squared += (kth_dist * kth_dist);
-            }
-
-            //find an approximate square root of fp_dist_squared, and store it as an exact value
-            exact cur_dist(0);
-            if (fp_dist_squared > 0)
-                cur_dist = approx(sqrt(fp_dist_squared)); //OK for now...
-
-            //store distance value, if it doesn't exist already
-            ret = dist_set.insert(ExactValue(cur_dist));
-
-            //remember that the pair of points (i,j) has this distance value, which will go in entry j(j-1)/2 + i + 1
-            (ret.first)->indexes.push_back((j * (j - 1)) / 2 + i + 1);
+    build_distance_matrix(coords.data());
+}
 
-            //need to keep track of degree for degree-Rips complex
-            if ((max_dist == -1 || cur_dist <= max_dist) && filtration == "degree") {
-                //there is an edge between i and j so update degree
-                degree[i]++;
-                degree[j]++;
-            }
-        }
-    } //end for
+void DistanceMatrix::build_distance_matrix(const double* coords)
+{
+    std::vector<double> distances;
+
+    //the function estimators use all distances, but otherwise only the pairs of points within max_dist are needed
+    if (max_dist != -1 && !(filtration == "function" && func_type != "user")) {
+        //approx() keeps 7 significant digits, so the pairs whose approximate distance is at most max_dist are within this radius
+        double radius = rivet::numeric::to_double(max_dist) * (1 + 1e-5);
+        sparse = true;
+        neighbor_graph.build(coords, num_points, dimension, radius, distances);
+        if (input_params.verbosity >= 4)
+            debug() << "  Found" << neighbor_graph.num_edges() << "pairs of points within the maximum distance.";
+    } else {
+        compute_distances(coords, distances);
+    }
+    store_distances(distances);
 }
 
 void DistanceMatrix::build_all_vectors(InputData* data)
@@ -332,19 +334,12 @@ void DistanceMatrix::build_all_vectors(InputData* data)
             eccentricity_estimator(input_params.filter_param);
         if (func_type == "gaussian")
             gaussian_estimator(input_params.filter_param);
+        std::vector<double>().swap(approx_distances); // free up the memory
     }
 
-    // remove all values from distance set that are greater than max_dist
-    // dist_set has values in ascending order
-    if (max_dist != -1) {
-        ExactSet::iterator it;
-        for (it = dist_set.begin(); it != dist_set.end(); it++) {
-            if (it->double_value > max_dist) {
-                break;
-            }
-        }
-        dist_set.erase(it, dist_set.end());
-    }
+    // remove all distance values that are greater than max_dist
+    if (max_dist != -1)
+        dist_grades.erase_greater(max_dist);
 
     if (filtration == "degree") {
         //determine the max degree
@@ -356,158 +351,354 @@ void DistanceMatrix::build_all_vectors(InputData* data)
 
         //build vector of discrete degree indices from 0 to max_degree and bins those degree values
         //WARNING: assumes that the number of distinct degree grades will be equal to max_degree which may not hold
-        for (unsigned i = 0; i <= max_degree; i++) {
-            ret = degree_set.insert(ExactValue(max_degree - i)); //store degree -i because degree is wrt opposite ordering on R
-            (ret.first)->indexes.push_back(i); //degree i is stored at index i
-        }
+        //for quantile bins, each degree counts once for each point that has it
+        std::vector<std::size_t> num_with_degree(max_degree + 1, 0);
+        for (unsigned i = 0; i < num_points; i++)
+            num_with_degree[degree[i]]++;
+        GradeDiscretizer degree_grades;
+        degree_grades.reserve(max_degree + 1, max_degree + 1);
+        for (unsigned i = 0; i <= max_degree; i++)
+            degree_grades.add_weighted(max_degree - i, i, num_with_degree[i]); //store degree -i because degree is wrt opposite ordering on R; degree i is stored at index i
         //make degrees
         degree_indexes = std::vector<unsigned>(max_degree + 1, 0);
-        build_grade_vectors(*data, degree_set, degree_indexes, data->x_exact, input_params.x_bins);
+        degree_grades.discretize(degree_indexes, data->x_exact, input_params.x_bins, input_params.x_quantiles);
     }
     //X axis is given by function in Vietoris-Rips complex
     else {
         //vector of discrete time indexes for each point; max_unsigned shall represent undefined time (is this reasonable?)
         function_indexes = std::vector<unsigned>(num_points, max_unsigned);
-        build_grade_vectors(*data, function_set, function_indexes, data->x_exact, input_params.x_bins);
+        function_grades.discretize(function_indexes, data->x_exact, input_params.x_bins, input_params.x_quantiles);
+        function_grades.clear();
     }
 
     //second, distances
-    dist_indexes = std::vector<unsigned>((num_points * (num_points - 1)) / 2 + 1, max_unsigned); //discrete distance matrix (triangle); max_unsigned shall represent undefined distance
-    build_grade_vectors(*data, dist_set, dist_indexes, data->y_exact, input_params.y_bins);
+    if (distances_binned) {
+        //bin_distances() has already stored the discrete distances
+        data->y_exact.reserve(dist_bins.size());
+        for (const auto& grade : dist_bins)
+            data->y_exact.push_back(grade.to_exact());
+        std::vector<rivet::numeric::SmallRational>().swap(dist_bins);
+        if (sparse)
+            neighbor_graph.remove_edges(max_unsigned);
+    } else if (sparse) {
+        //discrete distance of each edge; the edges whose distances are greater than max_dist are then removed
+        neighbor_graph.dist_indexes.assign(neighbor_graph.num_edges() + 1, max_unsigned);
+        dist_grades.discretize(neighbor_graph.dist_indexes, data->y_exact, input_params.y_bins, input_params.y_quantiles);
+        neighbor_graph.remove_edges(max_unsigned);
+    } else {
+        dist_indexes = std::vector<unsigned>((num_points * (num_points - 1)) / 2 + 1, max_unsigned); //discrete distance matrix (triangle); max_unsigned shall represent undefined distance
+        dist_grades.discretize(dist_indexes, data->y_exact, input_params.y_bins, input_params.y_quantiles);
+    }
+    dist_grades.clear();
 }
 
-void DistanceMatrix::read_distance_matrix(std::vector<exact>& values)
+bool DistanceMatrix::is_sparse() const
 {
-    std::ifstream input_file(input_params.fileName);
-    FileInputReader reader(input_file);
-
-    for (int i = 0; i < input_params.to_skip; i++)
-        reader.next_line(0);
+    return sparse;
+}
 
-    std::pair<std::vector<std::string>, unsigned> line_info;
-    unsigned expectedNumTokens = num_points;
+void DistanceMatrix::make_sparse()
+{
+    if (sparse)
+        return;
+    neighbor_graph.build(dist_indexes, num_points, max_unsigned);
+    std::vector<unsigned>().swap(dist_indexes);
+    sparse = true;
+}
 
-    ret = dist_set.insert(ExactValue(exact(0))); //distance from a point to itself is always zero
-    //store distance 0 at index 0
-    (ret.first)->indexes.push_back(0);
+void DistanceMatrix::read_distance_matrix(std::vector<exact>& values)
+{
+    std::vector<unsigned> points(num_points);
+    std::iota(points.begin(), points.end(), 0);
+    read_distance_matrix(values, points, num_points);
+}
 
-    //consider all points
-    for (unsigned i = 0; i < num_points; i++) {
+void DistanceMatrix::read_distance_matrix(std::vector<exact>& values, const std::vector<unsigned>& points, unsigned file_points)
+{
+    //the index of each point of the file among the points that are kept, or max_unsigned
+    std::vector<unsigned> kept(file_points, max_unsigned);
+    for (unsigned k = 0; k < num_points; k++) {
+        kept[points[k]] = k;
         if (func_type == "user" && filtration == "function") {
-            //store value, if it doesn't exist already
-            ret = function_set.insert(ExactValue(values[i]));
-
-            //remember that point i has this value
-            (ret.first)->indexes.push_back(i);
+            //remember that point k has this value
+            function_grades.add(rivet::numeric::SmallRational(values[points[k]]), k);
         }
+    }
 
-        // TODO: Add error more error handling?
+    dist_grades.reserve((size_t)num_points * (num_points - 1) / 2 + 1, (size_t)num_points * (num_points - 1) / 2 + 1);
+    dist_grades.add(0, 0); //distance from a point to itself is always zero; store distance 0 at index 0
 
-        //read distances from this point to all following points
-        if (i < num_points - 1) //then there is at least one point after point i, and there should be another line to read
-        {
-            if (reader.has_next_line())
-                line_info = reader.next_line(0);
-
-            std::vector<std::string> tokens;
-
-            // skip lower triangle if full distance matrix is supplied
-            if (line_info.first.size() == num_points && num_points == expectedNumTokens) {
-                for (unsigned k = i + 1; k < num_points; k++)
-                    tokens.push_back(line_info.first[k]);
-            } else if (line_info.first.size() == expectedNumTokens - 1) {
-                for (unsigned k = 0; k < expectedNumTokens - 1; k++)
-                    tokens.push_back(line_info.first[k]);
-                expectedNumTokens--;
-            } else {
-                throw std::runtime_error("Expected " + std::to_string(expectedNumTokens - 1) + " numbers, got " + std::to_string(line_info.first.size()) + " at line " + std::to_string(line_info.second));
-            }
+    //as the points are in increasing order, kept[i] < kept[j] for points i < j that are both kept
+    read_rows(input_params, file_points, [this, &kept](unsigned i, unsigned j, const FileTokenizer::Token& token) {
+        if (kept[i] != max_unsigned && kept[j] != max_unsigned)
+            store_distance(kept[i], kept[j], token.to_rational());
+    });
+}
 
-            try {
-                for (unsigned j = i + 1; j < num_points; j++) {
+void DistanceMatrix::read_distances(const InputParameters& params, unsigned num_points, std::vector<double>& distances)
+{
+    distances.clear();
+    distances.reserve((size_t)num_points * (num_points - 1) / 2);
+    read_rows(params, num_points, [&distances](unsigned, unsigned, const FileTokenizer::Token& token) {
+        distances.push_back(token.to_rational().to_double());
+    });
+}
 
-                    std::string str = tokens[j - i - 1];
+void DistanceMatrix::read_distance_matrix(const double* distances, bool full)
+{
+    //copy the distances into the layout of compute_distances(): the distance between points i < j goes in entry j(j-1)/2 + i + 1
+    std::vector<double> triangle((size_t)num_points * (num_points - 1) / 2 + 1);
+    triangle[0] = 0; //distance from a point to itself is always zero
 
-                    exact cur_dist = str_to_exact(str);
+    //without the lower triangle, the distances from point i to the following points start after those from points 0, ..., i - 1
+    const double* row = distances;
+    for (unsigned i = 0; i < num_points; i++) {
+        if (full)
+            row = distances + (size_t)i * num_points + i + 1;
 
-                    //store distance value, if it doesn't exist already
-                    ret = dist_set.insert(ExactValue(cur_dist));
+        for (unsigned j = i + 1; j < num_points; j++) {
+            double dist = *row++;
+            if (!(dist >= 0) || std::isinf(dist)) //also catches NaN
+                throw std::runtime_error("Invalid distance " + std::to_string(dist) + " between points " + std::to_string(i) + " and " + std::to_string(j) + ".");
+            triangle[(size_t)j * (j - 1) / 2 + i + 1] = dist;
+        }
+    } //end for
 
-                    //remember that the pair of points (i,j) has this distance value, which will go in entry j(j-1)/2 + i + 1
-                    (ret.first)->indexes.push_back((j * (j - 1)) / 2 + i + 1);
+    store_distances(triangle);
+}
 
-                    //need to keep track of degree for degree-Rips complex
-                    if ((max_dist == -1 || cur_dist <= max_dist) && filtration == "degree") {
-                        //there is an edge between i and j so update degree
-                        degree[i]++;
-                        degree[j]++;
+void DistanceMatrix::store_distance(unsigned i, unsigned j, const rivet::numeric::SmallRational& cur_dist)
+{
+    //remember that the pair of points (i,j) has this distance value, which will go in entry j(j-1)/2 + i + 1
+    dist_grades.add(cur_dist, (j * (j - 1)) / 2 + i + 1);
+
+    //need to keep track of degree for degree-Rips complex
+    if ((max_dist == -1 || cur_dist <= max_dist_value) && filtration == "degree") {
+        //there is an edge between i and j so update degree
+        degree[i]++;
+        degree[j]++;
+    }
+}
+
+void DistanceMatrix::compute_distances(const double* coords, std::vector<double>& distances)
+{
+    //store the coordinates by dimension, so that the kernel below reads the k-th coordinates of consecutive points contiguously
+    std::vector<double> columns((size_t)dimension * num_points);
+    for (unsigned i = 0; i < num_points; i++)
+        for (unsigned k = 0; k < dimension; k++)
+            columns[(size_t)k * num_points + i] = coords[(size_t)i * dimension + k];
+
+    distances.resize((size_t)num_points * (num_points - 1) / 2 + 1);
+    distances[0] = 0; //distance from a point to itself is always zero
+
+    //the distances from point j to points 0, ..., j - 1 form row j of the lower triangle, stored in entries j(j-1)/2 + 1, ..., j(j-1)/2 + j
+    //  rows are computed in blocks of ROW_BLOCK, and each block in tiles of COLUMN_BLOCK columns whose coordinates stay in cache
+    //  blocks are handed out from the bottom of the triangle, where the rows are longest
+    int num_row_blocks = (num_points + ROW_BLOCK - 1) / ROW_BLOCK;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int b = num_row_blocks - 1; b >= 0; b--) {
+        unsigned first_row = b * ROW_BLOCK;
+        unsigned last_row = std::min(first_row + ROW_BLOCK, num_points);
+        double squares[COLUMN_BLOCK];
+
+        for (unsigned first_col = 0; first_col + 1 < last_row; first_col += COLUMN_BLOCK) {
+            for (unsigned j = std::max(first_row, first_col + 1); j < last_row; j++) {
+                unsigned width = std::min(first_col + COLUMN_BLOCK, j) - first_col;
+
+                //compute distances squared between point j and points first_col, ..., first_col + width - 1, one coordinate at a time
+                std::fill(squares, squares + width, 0.0);
+                for (unsigned k = 0; k < dimension; k++) {
+                    const double* column = columns.data() + (size_t)k * num_points;
+                    const double* others = column + first_col;
+                    double x = column[j];
+#pragma omp simd
+                    for (unsigned w = 0; w < width; w++) {
+                        double kth_dist = others[w] - x;
+                        squares[w] += kth_dist * kth_dist;
                     }
                 }
-            } catch (std::exception& e) {
-                throw InputError(line_info.second, e.what());
+
+                double* row = distances.data() + (size_t)j * (j - 1) / 2 + 1 + first_col;
+#pragma omp simd
+                for (unsigned w = 0; w < width; w++)
+                    row[w] = std::sqrt(squares[w]);
             }
         }
     } //end for
-
-    input_file.close();
 }
 
-void DistanceMatrix::build_grade_vectors(InputData& data,
-    ExactSet& value_set,
-    std::vector<unsigned>& discrete_indexes,
-    std::vector<exact>& grades_exact,
-    unsigned num_bins)
+void DistanceMatrix::store_distances(std::vector<double>& distances)
 {
+    if (stream_distances) {
+        bin_distances(distances);
+    } else {
+        //sort the entries by distance, so that entries with the same (approximate) distance are consecutive
+        std::vector<unsigned> order(distances.size());
+        std::iota(order.begin(), order.end(), 0);
+        rivet::parallel_sort(order, [&distances](unsigned a, unsigned b) { return distances[a] < distances[b]; });
+
+        //store each distinct approximate value once, with the entries that have this value
+        //  approx() is nondecreasing, so the entries with the same approximate value are consecutive
+        dist_grades.reserve(0, order.size());
+        size_t run_first = 0;
+        long run_num = 0;
+        long run_denom = 0;
+        rivet::numeric::SmallRational run_value;
+        bool is_edge = true;
+        for (size_t first = 0; first < order.size();) {
+            double value = distances[order[first]];
+            size_t last = first + 1;
+            while (last < order.size() && distances[order[last]] == value)
+                last++;
+
+            //find an approximation of the distance, and store it as a rational value
+            long num = 0, denom = 1;
+            if (value > 0)
+                approx_parts(value, num, denom); //OK for now...
+            if (first == 0 || num != run_num || denom != run_denom) {
+                //remember that the pairs of points in the previous run have the previous value
+                if (first > 0)
+                    dist_grades.add(run_value, order.begin() + run_first, order.begin() + first);
+                run_first = first;
+                run_num = num;
+                run_denom = denom;
+                run_value = rivet::numeric::SmallRational(num, denom);
+                is_edge = (max_dist == -1 || run_value <= max_dist_value);
+            }
 
-    if (num_bins == 0 || num_bins >= value_set.size()) //then don't use bins
-    {
-        grades_exact.reserve(value_set.size());
-
-        unsigned c = 0; //counter for indexes
-        for (ExactSet::iterator it = value_set.begin(); it != value_set.end(); ++it) //loop through all UNIQUE values
-        {
-            grades_exact.push_back(it->exact_value);
+            //mark the pairs of points that are too far apart to be joined by an edge
+            if (!is_edge)
+                for (size_t k = first; k < last; k++)
+                    distances[order[k]] = -1;
 
-            for (unsigned i = 0; i < it->indexes.size(); i++) //loop through all point indexes for this value
-                discrete_indexes[it->indexes[i]] = c; //store discrete index
+            first = last;
+        }
+        dist_grades.add(run_value, order.begin() + run_first, order.end());
+    }
 
-            c++;
+    //need to keep track of degree for degree-Rips complex
+    if (filtration == "degree" && sparse) {
+        const NeighborGraph& graph = neighbor_graph;
+        for (unsigned i = 0; i < num_points; i++) {
+            for (std::size_t e = graph.starts[i]; e < graph.starts[i + 1]; e++) {
+                if (distances[e] >= 0) {
+                    //there is an edge between i and graph.neighbors[e] so update degree
+                    degree[i]++;
+                    degree[graph.neighbors[e]]++;
+                }
+            }
         }
-    } else //then use bins: then the number of discrete indexes will equal
-    // the number of bins, and exact values will be equally spaced
-    {
-        //compute bin size
-        exact min = value_set.begin()->exact_value;
-        exact max = value_set.rbegin()->exact_value;
-        exact bin_size = (max - min) / num_bins;
-
-        //store bin values
-        data.x_exact.reserve(num_bins);
-
-        ExactSet::iterator it = value_set.begin();
-        for (unsigned c = 0; c < num_bins; c++) //loop through all bins
+    } else if (filtration == "degree") {
+#pragma omp parallel
         {
-            ExactValue cur_bin(static_cast<exact>(min + (c + 1) * bin_size)); //store the bin value (i.e. the right endpoint of the bin interval)
-            grades_exact.push_back(cur_bin.exact_value);
-
-            //store bin index for all points whose time value is in this bin
-            while (it != value_set.end() && *it <= cur_bin) {
-                for (unsigned i = 0; i < it->indexes.size(); i++) //loop through all point indexes for this value
-                    discrete_indexes[it->indexes[i]] = c; //store discrete index
-                ++it;
+            std::vector<unsigned> local_degree(num_points, 0);
+#pragma omp for schedule(dynamic, 64)
+            for (int j = 1; j < (int)num_points; j++) {
+                const double* row = distances.data() + (size_t)j * (j - 1) / 2 + 1;
+                for (int i = 0; i < j; i++) {
+                    if (row[i] >= 0) {
+                        //there is an edge between i and j so update degree
+                        local_degree[i]++;
+                        local_degree[j]++;
+                    }
+                }
             }
+#pragma omp critical
+            for (unsigned i = 0; i < num_points; i++)
+                degree[i] += local_degree[i];
+        }
+    }
+}
+
+bool DistanceMatrix::is_within_max_dist(double dist) const
+{
+    //approx() rounds down to 7 significant digits, so the approximation is compared exactly only for distances close to max_dist
+    double max_key = max_dist_value.to_double();
+    if (dist <= max_key * (1 - 1e-12))
+        return true;
+    if (dist > max_key * (1 + 1e-5))
+        return false;
+    long num = 0, denom = 1;
+    if (dist > 0)
+        approx_parts(dist, num, denom);
+    return rivet::numeric::SmallRational(num, denom) <= max_dist_value;
+}
+
+void DistanceMatrix::bin_distances(std::vector<double>& distances)
+{
+    //estimate the quantiles of the distances within max_dist, without sorting or storing them
+    QuantileSketch sketch;
+    double largest = 0;
+    bool bounded = (max_dist != -1);
+    for (size_t e = 0; e < distances.size(); e++) {
+        if (!bounded || is_within_max_dist(distances[e])) {
+            sketch.add(distances[e]);
+            largest = std::max(largest, distances[e]);
+        } else {
+            distances[e] = -1; //too far apart to be joined by an edge
+        }
+    }
+    std::vector<double> quantiles = sketch.quantiles(input_params.y_bins);
+    quantiles.back() = largest; //the last bin must hold all distances
+
+    //the grades are the approximations of the quantiles, without repeats; limits[c] is the largest quantile whose approximation is grade c
+    //  approx() is nondecreasing, so a distance at most limits[c] has a grade at most c
+    std::vector<double> limits;
+    for (double q : quantiles) {
+        long num = 0, denom = 1;
+        if (q > 0)
+            approx_parts(q, num, denom);
+        rivet::numeric::SmallRational grade(num, denom);
+        if (!dist_bins.empty() && dist_bins.back() == grade) {
+            limits.back() = q;
+        } else {
+            dist_bins.push_back(grade);
+            limits.push_back(q);
         }
     }
-} //end build_grade_vectors()
+
+    //store the first grade that is at least the approximation of each distance
+    std::vector<unsigned>& discrete = sparse ? neighbor_graph.dist_indexes : dist_indexes;
+    discrete.assign(distances.size(), max_unsigned);
+#pragma omp parallel for schedule(static)
+    for (long e = 0; e < (long)distances.size(); e++) {
+        double dist = distances[e];
+        if (dist < 0)
+            continue;
+        unsigned c = std::lower_bound(limits.begin(), limits.end(), dist) - limits.begin();
+        //a distance just above limits[c - 1] may still have the same approximation
+        if (c > 0 && dist <= limits[c - 1] * (1 + 1e-5)) {
+            long num = 0, denom = 1;
+            approx_parts(dist, num, denom);
+            if (rivet::numeric::SmallRational(num, denom) <= dist_bins[c - 1])
+                c--;
+        }
+        discrete[e] = c;
+    }
+    distances_binned = true;
+
+    if (input_params.verbosity >= 4)
+        debug() << "  Put the distances in" << dist_bins.size() << "quantile bins, estimated from a sketch of" << sketch.size() << "distances.";
+}
 
 exact DistanceMatrix::approx(double x)
+{
+    long num, denom;
+    approx_parts(x, num, denom);
+    return exact(num, denom);
+}
+
+void DistanceMatrix::approx_parts(double x, long& num, long& denom)
 {
     int d = 7; //desired number of significant digits
     int log = (int)floor(log10(x)) + 1;
 
-    if (log >= d)
-        return exact((int)floor(x));
+    if (log >= d) {
+        num = (int)floor(x);
+        denom = 1;
+        return;
+    }
 
-    long denom = pow(10, d - log);
-    return exact((long)floor(x * denom), denom);
+    denom = pow(10, d - log);
+    num = (long)floor(x * denom);
 }
\ No newline at end of file
@@ -22,8 +22,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define _DISTANCE_MATRIX_H
 
 #include "../interface/data_reader.h"
-#include "../interface/file_input_reader.h"
+#include "../interface/file_tokenizer.h"
 #include "../interface/input_parameters.h"
+#include "grade_discretizer.h"
+#include "neighbor_graph.h"
 
 #include <fstream>
 #include <vector>
@@ -34,10 +36,17 @@ public:
     ~DistanceMatrix(); // cleanup all data structures used in distance matrix
 
     void build_distance_matrix(std::vector<DataPoint>& points); // builds a distance matrix from a set of points
+    void build_distance_matrix(const double* coords); // builds a distance matrix from the coordinates of the points, stored point by point; uses a NeighborGraph if is_sparse()
 
     void build_all_vectors(InputData* data); // builds discrete index vectors and grade vectors
 
+    bool is_sparse() const; // true iff the distances between points are stored in neighbor_graph instead of dist_indexes
+    void make_sparse(); // moves the discrete distances from dist_indexes to neighbor_graph, keeping the pairs of points at a defined distance
+
     void read_distance_matrix(std::vector<exact>& values); // reads a matrix from an input file and stores it
+    void read_distance_matrix(std::vector<exact>& values, const std::vector<unsigned>& points, unsigned file_points); // reads a matrix of file_points points from an input file, and stores the distances between the given points, in increasing order
+    static void read_distances(const InputParameters& params, unsigned num_points, std::vector<double>& distances); // reads the approximate distances above the diagonal of a matrix from an input file, row by row, without storing them
+    void read_distance_matrix(const double* distances, bool full); // stores a full matrix, stored row by row, or only the entries above its diagonal if !full
 
     void ball_density_estimator(double radius); // function to add a ball density estimator to provided data
     void knn_density_estimator(int k); // function calculate distance to kth nearest neighbor of every point
@@ -46,6 +55,7 @@ public:
 
     // these are required by bifiltration data and hence made public
     std::vector<unsigned> dist_indexes;
+    NeighborGraph neighbor_graph;
     std::vector<unsigned> function_indexes;
     std::vector<unsigned> degree_indexes;
 
@@ -59,6 +69,7 @@ private:
     bool function;
     unsigned num_points;
     exact max_dist;
+    rivet::numeric::SmallRational max_dist_value; // max_dist, for fast comparisons with distances
     unsigned max_degree;
     unsigned dimension;
     std::string filtration;
@@ -66,15 +77,31 @@ private:
 
     unsigned max_unsigned; // infinity
 
-    // sets storing unique values
-    ExactSet dist_set;
-    ExactSet degree_set;
-    ExactSet function_set;
+    bool sparse;
+    bool stream_distances; // true iff the distances computed from coordinates or read from a binary file are put in quantile bins by bin_distances()
+    bool distances_binned; // true iff bin_distances() has stored the discrete distances
+
+    // distance and function values, with the indexes of the pairs of points or points that have them
+    GradeDiscretizer dist_grades;
+    GradeDiscretizer function_grades;
+    std::vector<rivet::numeric::SmallRational> dist_bins; // the grades of the quantile bins of the distances, if distances_binned
+
+    static const unsigned ROW_BLOCK = 64; // number of points whose distances to other points are computed together
+    static const unsigned COLUMN_BLOCK = 256; // number of other points whose coordinates are reused for a block of ROW_BLOCK points
+
+    std::vector<double> approx_distances; // approximate distances in the layout of compute_distances(), used by the function estimators
 
-    std::pair<ExactSet::iterator, bool> ret; // for return value upon inserting to a set
+    const std::vector<double>& approximate_distances(); // builds approx_distances from dist_grades, if it is not built yet
+    double distance_percentile(double fraction); // returns the approximate distance at this fraction of the sorted distances, including 0 for a point to itself
+    void store_function_values(std::vector<double>& gvalues); // normalizes density values to sum to 1, and stores them in function_grades
 
     exact approx(double x);
-    void build_grade_vectors(InputData& data, ExactSet& value_set, std::vector<unsigned>& indexes, std::vector<exact>& grades_exact, unsigned num_bins); //converts an ExactSets of values to the vectors of discrete values that BifiltrationData uses to build the bifiltration, and also builds the grade vectors (floating-point and exact)
+    static void approx_parts(double x, long& num, long& denom); // approx(x) is num / denom
+    void store_distance(unsigned i, unsigned j, const rivet::numeric::SmallRational& cur_dist); // stores the distance between points i < j
+    void compute_distances(const double* coords, std::vector<double>& distances); // computes the distances between all pairs of points i < j, and stores each in entry j(j-1)/2 + i + 1
+    void store_distances(std::vector<double>& distances); // stores the distances computed by compute_distances() or neighbor_graph.build() in dist_grades, or bins them if stream_distances, and counts degrees; overwrites distances greater than max_dist
+    void bin_distances(std::vector<double>& distances); // stores the discrete distances in quantile bins of y_bins bins estimated with a QuantileSketch, and the grades in dist_bins; overwrites distances greater than max_dist with -1
+    bool is_within_max_dist(double dist) const; // true iff the approximation of dist is at most max_dist; precondition: max_dist != -1
 };
 
 #endif
\ No newline at end of file
@@ -26,6 +26,7 @@
 #include "map_matrix.h"
 
 #include "debug.h"
+#include "parallel_sort.h"
 
 #include <algorithm>
 #include <ctime>
@@ -33,6 +34,29 @@
 #include <sstream>
 #include <stdexcept>
 
+namespace {
+
+//returns the positions of the simplices, in increasing order of their indexes
+template <typename SimplexData>
+std::vector<unsigned> sorted_order(const std::vector<SimplexData>& simplices)
+{
+    std::vector<unsigned> order(simplices.size());
+    for (unsigned i = 0; i < order.size(); i++)
+        order[i] = i;
+    rivet::parallel_sort(order, [&simplices](unsigned a, unsigned b) { return simplices[a].s < simplices[b].s; });
+    return order;
+}
+
+//returns the position of the simplex with the given index, which must be one of the simplices
+template <typename SimplexData>
+unsigned find_simplex(const std::vector<SimplexData>& simplices, const std::vector<unsigned>& order, const SimplexIndex& s)
+{
+    return *std::lower_bound(order.begin(), order.end(), s,
+        [&simplices](unsigned a, const SimplexIndex& b) { return simplices[a].s < b; });
+}
+
+} //end anonymous namespace
+
 //constructor; requires verbosity parameter
 FIRep::FIRep(Presentation pres, int verbosity)
     : low_mx(BigradedMatrix(MapMatrix(0, pres.mat.height()), pres.row_ind))
@@ -72,31 +96,28 @@ FIRep::FIRep(BifiltrationData& bif_data, int verbosity)
             return left.gr < right.gr;
         });
 
-    //Enter the low simplex indices into a hash table.
+    //Sort the positions of the low simplices by their indexes in the
+    //combinatorial number system, to find the faces of the mid simplices.
     //Used to construct the low matrix
-    //key = simplex; value = index of that simplex in Low_Simplices
-    SimplexHashLow low_ht;
-    for (unsigned i = 0; i != bif_data.low_simplices.size(); i++) {
-        low_ht.emplace(&(bif_data.low_simplices[i].s), i);
-    }
+    std::vector<unsigned> low_order = sorted_order(bif_data.low_simplices);
 
     //Now process mid simplices (i.e., simplices of dimension hom_dim)
 
     //mid_gens will store all (mid-simplex,grade_of_appearance) pairs.
     //After sorting, this will index the columns of the low matrix.
-    auto mid_generators = std::vector<MidHiGenIterPair>();
+    auto mid_generators = std::vector<MidGenIterPair>();
 
     //construct the pairs
     mid_generators.reserve(bif_data.mid_count);
     for (auto it = bif_data.mid_simplices.begin(); it != bif_data.mid_simplices.end(); it++) {
-        //set aside space for indices in each MidHighSimplexData struct.
+        //set aside space for indices in each MidSimplexData struct.
         it->col_inds.reserve(it->grades_vec.size());
         //iterate through the grades
         for (auto it2 = it->grades_vec.begin(); it2 != it->grades_vec.end(); it2++)
 
             //populate mid_generators with pairs of iterators which specify a
             //simplex and its grade of appearance
-            mid_generators.push_back(MidHiGenIterPair(it, it2));
+            mid_generators.push_back(MidGenIterPair(it, it2));
     }
 
     //stably sort mid_generators according to colex order on grades
@@ -108,11 +129,11 @@ FIRep::FIRep(BifiltrationData& bif_data, int verbosity)
 
     //loop through simplices, writing columns to the matrix, and filling in the
     //low IndexMatrix
-    construct_low_mx(mid_generators, bif_data, low_ht);
+    construct_low_mx(mid_generators, bif_data, low_order);
 
-    //We no longer need low_simplices or the hash table, so clear them out.
+    //We no longer need low_simplices or their order, so clear them out.
     std::vector<LowSimplexData>().swap(bif_data.low_simplices);
-    SimplexHashLow().swap(low_ht);
+    std::vector<unsigned>().swap(low_order);
 
     if (verbosity >= 6)
         debug() << "Created low matrix";
@@ -121,7 +142,7 @@ FIRep::FIRep(BifiltrationData& bif_data, int verbosity)
     //First, we need to do more processing of the simplices in dimension hom_dim
 
     //Record the sorted indices of (mid-simplex, grade) pairs in the
-    //MidHighSimplexData structs.
+    //MidSimplexData structs.
     for (unsigned i = 0; i != mid_generators.size(); i++) {
         //this funky line uses the iterator in grades_vec to access the
         //corresponding element in col_inds, and also increments the iterator
@@ -137,29 +158,22 @@ FIRep::FIRep(BifiltrationData& bif_data, int verbosity)
         it->grades_it = it->grades_vec.begin();
     }
 
-    //Enter the mid_simplex indices into a hash table.
-    //key = simplex; value = iterator pointing to that simplex in mid_simplices
-    SimplexHashMid mid_ht;
-    for (auto it = bif_data.mid_simplices.begin();
-         it != bif_data.mid_simplices.end();
-         it++) {
-        mid_ht.emplace(&(it->s), it);
-    }
-
-    //The following vector will index the columns of the high matrix
-    auto high_generators = std::vector<MidHiGenIterPair>();
-
-    //We know in advance how many columns the high matrix will have.
-    high_generators.reserve(bif_data.high_count + bif_data.mid_count - bif_data.mid_simplices.size());
+    //Sort the positions of the mid simplices by their indexes, to find the
+    //faces of the high simplices.
+    std::vector<unsigned> mid_order = sorted_order(bif_data.mid_simplices);
 
     /* 
-    Add the relations to high_generators
+    The relations index some of the columns of the high matrix.
     Relations will be represented implicity as using two pieces of data:
     1) An AppearanceGrades::iterator it2, where the AppearanceGrades object
-       in question is a member of a MidHighSimplexData Object m.
+       in question is a member of a MidSimplexData Object m.
     2) An iterator it pointing to m in mid_simplices.  The relation represented 
        is the one between *it2 and *(it2+1). 
     */
+    auto relations = std::vector<MidGenIterPair>();
+
+    //We know in advance how many relations there are.
+    relations.reserve(bif_data.mid_count - bif_data.mid_simplices.size());
 
     for (auto it = bif_data.mid_simplices.begin();
          it != bif_data.mid_simplices.end();
@@ -167,27 +181,28 @@ FIRep::FIRep(BifiltrationData& bif_data, int verbosity)
         for (AppearanceGrades::iterator it2 = it->grades_vec.begin();
              (it2 + 1) != it->grades_vec.end();
              it2++) {
-            high_generators.push_back(MidHiGenIterPair(it, it2));
+            relations.push_back(MidGenIterPair(it, it2));
         }
     }
 
-    //Add each (simplex,grade) pair of dimension (hom_dim+1) to high_generators
-    for (auto it = bif_data.high_simplices.begin();
-         it != bif_data.high_simplices.end();
-         it++) {
-        //iterate through the grades
-        for (auto it2 = it->grades_vec.begin();
-             it2 != it->grades_vec.end();
-             it2++) {
-            //populate high_generators with pairs
-            high_generators.push_back(MidHiGenIterPair(it, it2));
-        }
-    }
+    //stably sort the relations according to colex order on their grades
+    std::stable_sort(relations.begin(),
+        relations.end(),
+        [](const MidGenIterPair& left, const MidGenIterPair& right) {
+            return relation_grade(left) < relation_grade(right);
+        });
 
-    //Now we've built the list of high_generators, and we need to sort it.
-    std::stable_sort(high_generators.begin(),
-        high_generators.end(),
-        [this](auto a, auto b) { return sort_high_gens(a, b); });
+    //The other columns are indexed by the (high-simplex, grade) pairs, which
+    //are stored in the order in which the simplices were built.  Sort their
+    //positions according to colex order on grades, keeping this order within
+    //a grade; we have seen that this is an efficient strategy in practice.
+    std::vector<unsigned> high_order(bif_data.high_simplices.size());
+    for (unsigned i = 0; i < high_order.size(); i++)
+        high_order[i] = i;
+    const std::vector<HighSimplexData>& high_simplices = bif_data.high_simplices;
+    rivet::parallel_sort(high_order, [&high_simplices](unsigned a, unsigned b) {
+        return high_simplices[a].gr < high_simplices[b].gr || (high_simplices[a].gr == high_simplices[b].gr && a < b);
+    });
 
     /*
     Compute the high matrix.  This is more complex than for the low matrix,
@@ -195,15 +210,17 @@ FIRep::FIRep(BifiltrationData& bif_data, int verbosity)
     make a valid choice from among several possible birth grades of a boundary
     simplex. 
     */
-    construct_high_mx(mid_generators, high_generators, bif_data, mid_ht);
+    construct_high_mx(mid_generators, relations, high_order, bif_data, mid_order);
 
     //We no longer need mid_simplices or high simplices, so replace with
     //something trivial.
-    std::vector<MidHighSimplexData>().swap(bif_data.mid_simplices);
-    std::vector<MidHighSimplexData>().swap(bif_data.high_simplices);
+    std::vector<MidSimplexData>().swap(bif_data.mid_simplices);
+    std::vector<HighSimplexData>().swap(bif_data.high_simplices);
 
-    //Replace hash_table with something trivial.
-    SimplexHashMid().swap(mid_ht);
+    //Replace the orders with something trivial.
+    std::vector<MidGenIterPair>().swap(relations);
+    std::vector<unsigned>().swap(high_order);
+    std::vector<unsigned>().swap(mid_order);
 
     if (verbosity >= 6)
         debug() << "Created high matrix";
@@ -219,9 +236,9 @@ FIRep::FIRep(BifiltrationData& bif_data, int verbosity)
 //Techinical function for constructing FIRep from bifiltration data.
 //loop through simplices, writing columns to the matrix, and filling in the
 //low IndexMatrix
-void FIRep::construct_low_mx(const std::vector<MidHiGenIterPair>& mid_gens,
+void FIRep::construct_low_mx(const std::vector<MidGenIterPair>& mid_gens,
     const BifiltrationData& bif_data,
-    const SimplexHashLow& low_ht)
+    const std::vector<unsigned>& low_order)
 {
     //create the MapMatrix of the appropriate size
     low_mx.mat = MapMatrix(bif_data.low_simplices.size(), mid_gens.size());
@@ -242,28 +259,18 @@ void FIRep::construct_low_mx(const std::vector<MidHiGenIterPair>& mid_gens,
 
         //If hom_dim==0, there are no columns to fill in.
         if (bif_data.hom_dim > 0) {
-            //reserve space to work
-            Simplex face;
-            face.reserve(bif_data.hom_dim);
-            //call the simplex "vertices";
-            Simplex& vertices = mid_gens[i].first->s;
-
             //TODO: reserve space in the column of low_mx for the entries we
             //will add in?  Because of the nested interfaces, a few classes
             //would have to be changed.  Probably not worth it.
 
-            //find all faces of this simplex
-            for (unsigned k = 0; k < vertices.size(); k++) {
-                //face vertices are all vertices in verts[] except verts[k]
-                for (unsigned l = 0; l < vertices.size(); l++)
-                    if (l != k)
-                        face.push_back(vertices[l]);
-                //use hash table to look up the index of this face in
-                //low_simplices;
-                auto face_node = low_ht.find(&face);
-                //now write the row index to row_indices
-                low_mx.mat.set(face_node->second, i);
-                face.clear();
+            //find all faces of this simplex; faces[k] is the face without
+            //its k-th vertex
+            SimplexIndex faces[7];
+            bif_data.encoder.faces(mid_gens[i].first->s, bif_data.hom_dim + 1, faces);
+            for (unsigned k = 0; k <= bif_data.hom_dim; k++) {
+                //look up the index of this face in low_simplices, and write
+                //it to the column
+                low_mx.mat.set(find_simplex(bif_data.low_simplices, low_order, faces[k]), i);
             }
 
             //heapify this column
@@ -278,55 +285,56 @@ void FIRep::construct_low_mx(const std::vector<MidHiGenIterPair>& mid_gens,
             mid_gens.size() - 1);
 }
 
-void FIRep::construct_high_mx(const std::vector<MidHiGenIterPair>& mid_gens,
-    const std::vector<MidHiGenIterPair>& high_gens,
-    const BifiltrationData& bif_data,
-    const SimplexHashMid& mid_ht)
+void FIRep::construct_high_mx(const std::vector<MidGenIterPair>& mid_gens,
+    const std::vector<MidGenIterPair>& relations,
+    const std::vector<unsigned>& high_order,
+    BifiltrationData& bif_data,
+    const std::vector<unsigned>& mid_order)
 {
     //create the MapMatrix
-    high_mx.mat = MapMatrix(mid_gens.size(), high_gens.size());
+    unsigned num_cols = relations.size() + high_order.size();
+    high_mx.mat = MapMatrix(mid_gens.size(), num_cols);
     if (verbosity >= 6)
-        debug() << "Creating high matrix of dimension" << mid_gens.size() << "x" << high_gens.size();
+        debug() << "Creating high matrix of dimension" << mid_gens.size() << "x" << num_cols;
 
-    //reserve space to work
-    Simplex face;
-    face.reserve(bif_data.hom_dim + 1);
+    //space to work; the faces of a simplex have at most 7 vertices, since hom_dim <= 5
+    SimplexIndex faces[7];
 
-    Grade prev_grade;
-    if (high_gens.size() > 0)
-        prev_grade = *(high_gens[0].second);
+    /*
+    The columns are ordered colexicographically according to bigrade.  Within a
+    bigrade, relations come before high simplices.  This is a choice that
+    (heurisitically speaking) seems likely to be efficient.  We merge the
+    relations and the high simplices, which are both sorted by grade.
+    */
+    auto rel_it = relations.begin();
+    auto high_it = high_order.begin();
+    //the entries of the index matrix before the first column stay -1
+    Grade prev_grade(0, 0);
 
     //add in columns of matrix and set the entries of the corresponding
     //IndexMatrix
-    for (unsigned i = 0; i < high_gens.size(); i++) {
+    for (unsigned i = 0; i < num_cols; i++) {
 
-        if (high_gens[i].first->is_high()) {
+        if (rel_it == relations.end() || (high_it != high_order.end() && bif_data.high_simplices[*high_it].gr < relation_grade(*rel_it))) {
+            //if we are here, i indexes a high simplex.
+            const HighSimplexData& simplex = bif_data.high_simplices[*high_it];
+            high_it++;
 
             //set entries of the index matrix
-            high_mx.ind.fill_index_mx(prev_grade, *(high_gens[i].second), i - 1);
+            high_mx.ind.fill_index_mx(prev_grade, simplex.gr, i - 1);
 
             //TODO: reserve space in the column of high_mx for the entries we
             //will add in?  Because of all the nested interfaces, a few classes
             //would have to be changed.  Probably not worth it.
 
-            //call the simplex "vertices";
-            Simplex& vertices = high_gens[i].first->s;
+            //find all faces of this simplex; faces[k] is the face without
+            //its k-th vertex
+            bif_data.encoder.faces(simplex.s, bif_data.hom_dim + 2, faces);
+            for (unsigned k = 0; k <= bif_data.hom_dim + 1; k++) {
+                //look up this face in mid_simplices
+                auto face_node = bif_data.mid_simplices.begin() + find_simplex(bif_data.mid_simplices, mid_order, faces[k]);
 
-            //find all faces of this simplex
-            for (unsigned k = 0; k < vertices.size(); k++) {
-                //face vertices are all vertices in verts[] except verts[k]
-                for (unsigned l = 0; l < vertices.size(); l++)
-                    if (l != k)
-                        face.push_back(vertices[l]);
-
-                //use hash table to look up the index of this face in mid_simplices;
-                auto face_node = mid_ht.find(&face);
-
-                //NOTE: Commenting out this error check for speed
-                //if (face_node == mid_ht.end())
-                //    throw std::runtime_error("FIRep constructor: face simplex not found.");
-
-                /*face_node->second gives an iterator pointing to the face.
+                /*face_node points to the face.
                  Now choose a suitable bigrade for the face.
              
                  A TRICK: Simplices are colex ordered, and so is each
@@ -346,33 +354,32 @@ void FIRep::construct_high_mx(const std::vector<MidHiGenIterPair>& mid_gens,
                     //Did we find a grade for this boundary simplex that is less
                     //than the grade of the simplex itself, in the partial order
                     //on R^2?
-                    if ((face_node->second->grades_it->x <= high_gens[i].second->x) && (face_node->second->grades_it->y <= high_gens[i].second->y)) {
+                    if ((face_node->grades_it->x <= simplex.gr.x) && (face_node->grades_it->y <= simplex.gr.y)) {
                         //insert the index in mid_generators corresponding to
                         //this (simplex,grade) pair.
-                        high_mx.mat.set(*(face_node->second->col_inds.begin() + std::distance(face_node->second->grades_vec.begin(), face_node->second->grades_it)), i);
+                        high_mx.mat.set(*(face_node->col_inds.begin() + std::distance(face_node->grades_vec.begin(), face_node->grades_it)), i);
                         found_match = true;
                     } else {
-                        face_node->second->grades_it++;
+                        face_node->grades_it++;
                     }
                 }
-                face.clear();
             }
             high_mx.mat.prepare_col(i);
         }
 
         else {
             //if we are here, i indexes a relation.
+            const MidGenIterPair& relation = *rel_it;
+            rel_it++;
 
             //Update high_mx.ind in the appropriate way.
-            Grade curr_grade = Grade(high_gens[i].second->x,
-                (high_gens[i].second + 1)->y);
-            high_mx.ind.fill_index_mx(prev_grade, curr_grade, i - 1);
+            high_mx.ind.fill_index_mx(prev_grade, relation_grade(relation), i - 1);
 
             //add the second index of the relation to the ith column of high_mx
-            high_mx.mat.set(*(high_gens[i].first->col_inds.begin() + std::distance(high_gens[i].first->grades_vec.begin(), high_gens[i].second) + 1), i);
+            high_mx.mat.set(*(relation.first->col_inds.begin() + std::distance(relation.first->grades_vec.begin(), relation.second) + 1), i);
 
             //add the first index of the relation to the ith column of high_mx
-            high_mx.mat.set(*(high_gens[i].first->col_inds.begin() + std::distance(high_gens[i].first->grades_vec.begin(), high_gens[i].second)), i);
+            high_mx.mat.set(*(relation.first->col_inds.begin() + std::distance(relation.first->grades_vec.begin(), relation.second)), i);
 
             //NOTE: The order in which we add the two elements matters; by construction,
             //column is in heap order (see documentation for std::pop_heap),
@@ -381,69 +388,16 @@ void FIRep::construct_high_mx(const std::vector<MidHiGenIterPair>& mid_gens,
     }
 
     //Now we complete construction of the high_mx.ind.
-    if (high_gens.size() > 0)
-        high_mx.ind.fill_index_mx(prev_grade, Grade(0, high_mx.ind.height()), high_gens.size() - 1);
+    if (num_cols > 0)
+        high_mx.ind.fill_index_mx(prev_grade, Grade(0, high_mx.ind.height()), num_cols - 1);
 }
 
-/*
-Technical sorting function used to sort the MidHiGenIterPair objects that
-index the high_matrix.  
- 
-Orders colexicographically according to bigrade.  Within a bigrade, orders high 
-simplices before relations.  Note that a MidHiGenIterPair can represent either a
-(high-simplex, generator) pair or a relation; this requires us to consider a
-few cases.  Note also that we represent the relations implicitly (see above),
-so the comparator has to compute the grade of a relation as part of the sorting.
- 
-For high simplices of the same bigrade, sorting doesn't change the order.  Thus, 
-because simplices are assumed to already be in lex order by vertex index, we
-maintain that order within a bigrade.  We have seen that this is an efficient 
-strategy in practice.
- 
-TODO: In this sorting algorithm, one could instead precompute the grades
-of the relations and avoid copying/recomputing grades.
-But this is probably not worth the trouble.
-*/
-
-bool FIRep::sort_high_gens(const MidHiGenIterPair& left, const MidHiGenIterPair& right)
+//The vector of appearance grades is assumed to be in colex order, so the
+//relation between two consecutive grades has the x-coordinate of the first
+//and the y-coordinate of the second
+Grade FIRep::relation_grade(const MidGenIterPair& relation)
 {
-    if (left.first->is_high() && right.first->is_high())
-        /* Both left and right are high simplices.  Order (stably) according to
-     grade.*/
-        return *(left.second) < *(right.second);
-    else {
-        Grade left_grade, right_grade;
-
-        if (left.first->is_high()) {
-            left_grade = *(left.second);
-        } else {
-            //The vector of appearance grades is aassumed to be in colex
-            //order, so the following gives the grade of the relation
-            left_grade = Grade(left.second->x, (left.second + 1)->y);
-        }
-
-        if (right.first->is_high()) {
-            right_grade = *(right.second);
-        } else {
-            //as above, the following gives the grade of the relation
-            right_grade = Grade(right.second->x, (right.second + 1)->y);
-        }
-
-        if (!(left_grade == right_grade))
-            return left_grade < right_grade;
-
-        else {
-            /* If we get here, the grades are equal and (either one
-               operand is a simplex and the other is a relation, or both
-               are relations).  In the former case, we take left < right
-               iff left is a relation and right is not.  This is a choice
-               that (heurisitically speaking) seems likely to be efficient.
-               In the latter case, we will take left and right to be
-               incomparable.  In either case, the following line gives
-               what we want. */
-            return left.first->is_high() < right.first->is_high();
-        }
-    }
+    return Grade(relation.second->x, (relation.second + 1)->y);
 }
 
 /* This constructor is used when the FIRep is given directly as text input.
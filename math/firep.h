@@ -34,12 +34,12 @@
  simple "trick" described in a paper of Scolamiero, Chacholski, and Vaccarino.
 
  
- Structs: VectorHash, deref_equal_fn
- 
- Description:  To construct an FIRep from a BifiltrationData object, we 
- construct hash tables whose keys are pointers to simplices.  These are used, 
- respectively, to define the hash function and to compare compare two keys for 
- equality.
+ To construct an FIRep from a BifiltrationData object, we compute the faces
+ of each simplex from its index in the combinatorial number system, and find
+ them by binary search in the simplices of lower dimension, sorted by index.
+ The simplices of dimension hom_dim+1 are stored with one grade each, and are
+ only ordered by grade when the high matrix is built, so that they take much
+ less memory than the high matrix.
  
 */
 
@@ -59,31 +59,6 @@ class IndexMatrix;
 #include <string>
 #include <vector>
 
-//used to build the hash tables for simplices in hom_dim-1 and hom_dim
-struct VectorHash {
-    std::size_t operator()(Simplex const* const& v) const
-    {
-        return boost::hash_range(v->begin(), v->end());
-    }
-};
-
-//used to compare compare two keys in the hash tables for equality.
-struct deref_equal_fn {
-    bool operator()(Simplex* const& lhs, Simplex* const& rhs) const
-    {
-        return *lhs == *rhs;
-    }
-};
-
-typedef std::unordered_map<Simplex* const, unsigned,
-    VectorHash, deref_equal_fn>
-    SimplexHashLow;
-typedef std::unordered_map<Simplex* const,
-    std::vector<MidHighSimplexData>::iterator,
-    VectorHash, deref_equal_fn>
-    SimplexHashMid;
-//no need for a hash table in the high dimension
-
 class FIRep {
 
 public:
@@ -142,27 +117,31 @@ private:
 
     //A pair of iterators; first points to a simplex, second points to a grade
     //of appearance of that simplex.
-    typedef std::pair<std::vector<MidHighSimplexData>::iterator, AppearanceGrades::iterator> MidHiGenIterPair;
+    typedef std::pair<std::vector<MidSimplexData>::iterator, AppearanceGrades::iterator> MidGenIterPair;
 
     //Techinical functions for constructing FIRep from bifiltration data.
 
     //loop through simplices, writing columns to the matrix, and filling in the
-    //low IndexMatrix
-    void construct_low_mx(const std::vector<MidHiGenIterPair>& mid_gens,
+    //low IndexMatrix; low_order lists the low simplices in order of their indexes
+    void construct_low_mx(const std::vector<MidGenIterPair>& mid_gens,
         const BifiltrationData& bif_data,
-        const SimplexHashLow& low_ht);
+        const std::vector<unsigned>& low_order);
 
     //construct a column for each (high-simplex, grade-of-appearance) pair,
     //and also a column for each "neighboring bigrade" relation for the
     //mid-simplices.
-    void construct_high_mx(const std::vector<MidHiGenIterPair>& mid_gens,
-        const std::vector<MidHiGenIterPair>& high_gens,
-        const BifiltrationData& bif_data,
-        const SimplexHashMid& mid_ht);
-
-    //Technical sorting function used to sort the MidHiGenIterPair objects that
-    //index the high_matrix.
-    static bool sort_high_gens(const MidHiGenIterPair& left, const MidHiGenIterPair& right);
+    //relations lists the relations sorted by grade, and high_order the
+    //positions of the high simplices sorted by grade; mid_order lists the mid
+    //simplices in order of their indexes
+    void construct_high_mx(const std::vector<MidGenIterPair>& mid_gens,
+        const std::vector<MidGenIterPair>& relations,
+        const std::vector<unsigned>& high_order,
+        BifiltrationData& bif_data,
+        const std::vector<unsigned>& mid_order);
+
+    //returns the grade of the relation between the grade of appearance
+    //relation.second and the next one
+    static Grade relation_grade(const MidGenIterPair& relation);
 
     //writes boundary, given boundary entries in column col of matrix mat
     void write_boundary_column(MapMatrix& mat,
@@ -0,0 +1,219 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "grade_discretizer.h"
+#include "parallel_sort.h"
+
+#include <cmath>
+
+double GradeDiscretizer::epsilon = std::pow(2, -30);
+
+GradeDiscretizer::GradeDiscretizer()
+    : starts(1, 0)
+    , sorted(false)
+{
+}
+
+void GradeDiscretizer::reserve(std::size_t num_values, std::size_t num_indexes)
+{
+    values.reserve(num_values);
+    keys.reserve(num_values);
+    starts.reserve(num_values + 1);
+    indexes.reserve(num_indexes);
+}
+
+void GradeDiscretizer::add(const rivet::numeric::SmallRational& value, unsigned index)
+{
+    values.push_back(value);
+    keys.push_back(value.to_double());
+    indexes.push_back(index);
+    starts.push_back(indexes.size());
+    sorted = false;
+}
+
+void GradeDiscretizer::add_weighted(const rivet::numeric::SmallRational& value, unsigned index, std::size_t weight)
+{
+    add(value, index);
+    weights.push_back(weight);
+}
+
+void GradeDiscretizer::values_by_index(double* approximations) const
+{
+    for (std::size_t v = 0; v < values.size(); v++)
+        for (std::size_t k = starts[v]; k < starts[v + 1]; k++)
+            approximations[indexes[k]] = keys[v];
+}
+
+void GradeDiscretizer::erase_greater(const exact& max)
+{
+    sort();
+
+    //values are in increasing order, so find the first distinct value whose approximation is greater than max
+    std::size_t num_groups = group_starts.size() - 1;
+    std::size_t g = 0;
+    while (g < num_groups && !(keys[order[group_starts[g]]] > max))
+        g++;
+
+    order.resize(group_starts[g]);
+    group_starts.resize(g + 1);
+}
+
+void GradeDiscretizer::discretize(std::vector<unsigned>& discrete_indexes, std::vector<exact>& grades_exact, unsigned num_bins, bool quantiles)
+{
+    sort();
+    std::size_t num_groups = group_starts.size() - 1;
+    std::vector<unsigned> group_grades(num_groups);
+
+    if (num_bins == 0 || num_bins >= num_groups) //then don't use bins
+    {
+        grades_exact.reserve(num_groups);
+        for (std::size_t g = 0; g < num_groups; g++) {
+            grades_exact.push_back(values[order[group_starts[g]]].to_exact());
+            group_grades[g] = g;
+        }
+    } else if (quantiles) //then use quantile bins: each grade is a value, and the last value of each bin
+    {
+        std::size_t total = 0;
+        for (unsigned v : order)
+            total += weight(v);
+
+        //distinct value g ends bin c if the values up to g weigh at least (c + 1) / num_bins of the total; the last value ends the last bin
+        std::size_t cumulative = 0;
+        unsigned c = 0;
+        for (std::size_t g = 0; g < num_groups; g++) {
+            for (std::size_t k = group_starts[g]; k < group_starts[g + 1]; k++)
+                cumulative += weight(order[k]);
+
+            group_grades[g] = grades_exact.size();
+            if (g + 1 == num_groups || (c + 1 < num_bins && cumulative * num_bins >= (c + 1) * total)) {
+                grades_exact.push_back(values[order[group_starts[g]]].to_exact());
+                //a heavy value may end several bins
+                while (c + 1 < num_bins && cumulative * num_bins >= (c + 1) * total)
+                    c++;
+            }
+        }
+    } else //then use bins: then the number of discrete indexes will equal
+    // the number of bins, and exact values will be equally spaced
+    {
+        //compute bin size
+        exact min = values[order[group_starts[0]]].to_exact();
+        exact max = values[order[group_starts[num_groups - 1]]].to_exact();
+        exact bin_size = (max - min) / num_bins;
+
+        //store bin values
+        grades_exact.reserve(num_bins);
+
+        std::size_t g = 0;
+        for (unsigned c = 0; c < num_bins; c++) //loop through all bins
+        {
+            exact cur_bin = static_cast<exact>(min + (c + 1) * bin_size); //store the bin value (i.e. the right endpoint of the bin interval)
+            double cur_bin_key = rivet::numeric::to_double(cur_bin);
+            grades_exact.push_back(cur_bin);
+
+            //all values in this bin get index c
+            rivet::numeric::SmallRational cur_bin_value(cur_bin);
+            while (g < num_groups && is_less_or_equal(g, cur_bin_key, cur_bin_value)) {
+                group_grades[g] = c;
+                g++;
+            }
+        }
+    }
+
+    //store the discrete index of every object; each object has only one value, so the writes do not overlap
+#pragma omp parallel for schedule(dynamic, 256)
+    for (long g = 0; g < (long)num_groups; g++) {
+        for (std::size_t k = group_starts[g]; k < group_starts[g + 1]; k++) {
+            unsigned v = order[k];
+            for (std::size_t i = starts[v]; i < starts[v + 1]; i++)
+                discrete_indexes[indexes[i]] = group_grades[g];
+        }
+    }
+} //end discretize()
+
+void GradeDiscretizer::clear()
+{
+    std::vector<rivet::numeric::SmallRational>().swap(values);
+    std::vector<double>().swap(keys);
+    std::vector<std::size_t>(1, 0).swap(starts);
+    std::vector<unsigned>().swap(indexes);
+    std::vector<std::size_t>().swap(weights);
+    std::vector<unsigned>().swap(order);
+    std::vector<std::size_t>().swap(group_starts);
+    sorted = false;
+}
+
+bool GradeDiscretizer::almost_equal(double a, double b)
+{
+    double diff = std::abs(a - b);
+    if (diff <= epsilon)
+        return true;
+
+    if (diff <= (std::abs(a) + std::abs(b)) * epsilon)
+        return true;
+    return false;
+}
+
+//sorts the values by their approximations, then sorts each window of nearly equal approximations by exact value, and groups equal values
+void GradeDiscretizer::sort()
+{
+    if (sorted)
+        return;
+
+    order.resize(values.size());
+    for (std::size_t v = 0; v < order.size(); v++)
+        order[v] = v;
+    rivet::parallel_sort(order, [this](unsigned a, unsigned b) { return keys[a] < keys[b]; });
+
+    group_starts.clear();
+    for (std::size_t first = 0; first < order.size();) {
+        //find the window of consecutive approximations that are nearly equal, and order it exactly
+        std::size_t last = first + 1;
+        while (last < order.size() && almost_equal(keys[order[last - 1]], keys[order[last]]))
+            last++;
+        if (last - first > 1)
+            std::sort(order.begin() + first, order.begin() + last, [this](unsigned a, unsigned b) { return values[a] < values[b]; });
+
+        //each run of equal values in the window is one distinct value
+        group_starts.push_back(first);
+        for (std::size_t k = first + 1; k < last; k++)
+            if (values[order[k]] != values[order[k - 1]])
+                group_starts.push_back(k);
+
+        first = last;
+    }
+    group_starts.push_back(order.size());
+    sorted = true;
+} //end sort()
+
+std::size_t GradeDiscretizer::weight(unsigned v) const
+{
+    if (weights.empty())
+        return starts[v + 1] - starts[v];
+    return weights[v];
+}
+
+//returns true iff distinct value g is at most the given value, comparing exact values only if the approximations are nearly equal
+bool GradeDiscretizer::is_less_or_equal(std::size_t g, double key, const rivet::numeric::SmallRational& value) const
+{
+    unsigned v = order[group_starts[g]];
+    if (almost_equal(keys[v], key))
+        return values[v] <= value;
+    return keys[v] <= key;
+}
@@ -0,0 +1,92 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	GradeDiscretizer
+ * \brief	Collects exact values (such as function values, distances, or grades of appearance), each with the indexes of the objects that have it,
+ *          and converts them to discrete grades.
+ *
+ * Values are stored as SmallRationals, so that typical inputs are compared without multiprecision arithmetic,
+ * and values and indexes are stored in flat arrays. discretize() sorts the values by their floating-point approximations,
+ * comparing exact values only where approximations are within epsilon of each other, merges equal values, and
+ * assigns one discrete grade to each distinct value (or bin of values). Bins are either equally spaced, or quantile bins
+ * that each hold about the same number of objects.
+ */
+
+#ifndef GRADE_DISCRETIZER_H
+#define GRADE_DISCRETIZER_H
+
+#include "numerics.h"
+
+#include <cstddef>
+#include <vector>
+
+class GradeDiscretizer {
+public:
+    GradeDiscretizer();
+
+    void reserve(std::size_t num_values, std::size_t num_indexes);
+
+    void add(const rivet::numeric::SmallRational& value, unsigned index); //records that the object with the given index has this value
+    void add_weighted(const rivet::numeric::SmallRational& value, unsigned index, std::size_t weight); //as add(), but the value counts weight times in quantile bins; either all values or none must be added this way
+
+    template <typename Iterator>
+    void add(const rivet::numeric::SmallRational& value, Iterator first, Iterator last) //records that the objects with the indexes in [first, last) have this value
+    {
+        values.push_back(value);
+        keys.push_back(value.to_double());
+        indexes.insert(indexes.end(), first, last);
+        starts.push_back(indexes.size());
+        sorted = false;
+    }
+
+    void values_by_index(double* approximations) const; //stores the approximation of the value of each object at position index
+
+    void erase_greater(const exact& max); //removes all values whose approximation is greater than max
+
+    //stores the discrete grade of each object at position index of discrete_indexes, and the exact grades in grades_exact
+    //  if num_bins is 0 or at least the number of distinct values, each distinct value is a grade;
+    //  otherwise the grades are num_bins equally spaced values, or if quantiles, at most num_bins of the values: for c = 1, ..., num_bins,
+    //  the smallest value that is at least the values of a fraction c / num_bins of the objects (counting their weights)
+    //  each value belongs to the first grade that is at least the value
+    void discretize(std::vector<unsigned>& discrete_indexes, std::vector<exact>& grades_exact, unsigned num_bins, bool quantiles = false);
+
+    void clear(); //frees all memory
+
+    static double epsilon; //approximations closer than this (absolutely or relatively) are ordered by their exact values
+    static bool almost_equal(double a, double b);
+
+private:
+    std::vector<rivet::numeric::SmallRational> values;
+    std::vector<double> keys; //keys[v] approximates values[v]
+    std::vector<std::size_t> starts; //the indexes of the objects with value v are indexes[starts[v]], ..., indexes[starts[v + 1] - 1]
+    std::vector<unsigned> indexes;
+    std::vector<std::size_t> weights; //weights[v] is the weight of value v, if the values are added by add_weighted()
+
+    //after sort(), order lists the values in increasing order, and distinct value g consists of values order[group_starts[g]], ..., order[group_starts[g + 1] - 1]
+    bool sorted;
+    std::vector<unsigned> order;
+    std::vector<std::size_t> group_starts;
+
+    void sort();
+    std::size_t weight(unsigned v) const; //the number of times value v counts in quantile bins
+    bool is_less_or_equal(std::size_t g, double key, const rivet::numeric::SmallRational& value) const; //compares distinct value g with the given value
+};
+
+#endif // GRADE_DISCRETIZER_H
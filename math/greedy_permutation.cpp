@@ -0,0 +1,126 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "greedy_permutation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+GreedyPermutation::GreedyPermutation()
+    : covering_radius(0)
+{
+}
+
+void GreedyPermutation::build(const double* coords, unsigned num_points, unsigned dimension, unsigned num_landmarks)
+{
+    select(num_points, num_landmarks, [coords, dimension](unsigned i, unsigned j) {
+        const double* p = coords + (std::size_t)i * dimension;
+        const double* q = coords + (std::size_t)j * dimension;
+        double sum = 0;
+        for (unsigned k = 0; k < dimension; k++)
+            sum += (p[k] - q[k]) * (p[k] - q[k]);
+        return std::sqrt(sum);
+    });
+}
+
+void GreedyPermutation::build_metric(const double* distances, unsigned num_points, bool full, unsigned num_landmarks)
+{
+    if (full) {
+        select(num_points, num_landmarks, [distances, num_points](unsigned i, unsigned j) {
+            return distances[(std::size_t)i * num_points + j];
+        });
+    } else {
+        //without the lower triangle, the distances from point i to the following points start after those from points 0, ..., i - 1
+        select(num_points, num_landmarks, [distances, num_points](unsigned i, unsigned j) {
+            if (i == j)
+                return 0.0;
+            if (i > j)
+                std::swap(i, j);
+            return distances[(std::size_t)i * num_points - (std::size_t)i * (i + 1) / 2 + j - i - 1];
+        });
+    }
+}
+
+std::vector<unsigned> GreedyPermutation::sorted_landmarks() const
+{
+    std::vector<unsigned> sorted(landmarks);
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+}
+
+//adds the landmarks one at a time, keeping the distance from each point to its nearest landmark
+//  the distances from the new landmark are computed in parallel, and each thread finds a farthest point in its part of the
+//  points; as the parts are ranges of consecutive points, the farthest point with the smallest index wins ties
+template <typename Distance>
+void GreedyPermutation::select(unsigned num_points, unsigned num_landmarks, Distance distance)
+{
+    num_landmarks = std::min(num_landmarks, num_points);
+    landmarks.clear();
+    radii.clear();
+    landmarks.reserve(num_landmarks);
+    radii.reserve(num_landmarks);
+    covering_radius = 0;
+    if (num_landmarks == 0)
+        return;
+
+    //nearest[i] is the distance from point i to the nearest landmark, or -1 if point i is a landmark
+    std::vector<double> nearest(num_points, std::numeric_limits<double>::infinity());
+    unsigned next = 0;
+    double next_radius = std::numeric_limits<double>::infinity();
+
+    for (unsigned k = 0; k < num_landmarks; k++) {
+        unsigned landmark = next;
+        landmarks.push_back(landmark);
+        radii.push_back(next_radius);
+        nearest[landmark] = -1;
+        if (k + 1 == num_points)
+            break;
+
+        //after the last landmark, this finds the covering radius
+        next = num_points;
+        next_radius = -1;
+#pragma omp parallel
+        {
+            unsigned farthest = num_points;
+            double farthest_dist = -1;
+#pragma omp for schedule(static)
+            for (long i = 0; i < (long)num_points; i++) {
+                if (nearest[i] < 0)
+                    continue;
+                double dist = distance(landmark, i);
+                if (dist < nearest[i])
+                    nearest[i] = dist;
+                if (nearest[i] > farthest_dist) {
+                    farthest = i;
+                    farthest_dist = nearest[i];
+                }
+            }
+#pragma omp critical(greedy_permutation)
+            if (farthest_dist > next_radius || (farthest_dist == next_radius && farthest < next)) {
+                next = farthest;
+                next_radius = farthest_dist;
+            }
+        }
+    }
+    if (num_landmarks < num_points)
+        covering_radius = next_radius;
+} //end select()
@@ -0,0 +1,57 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	GreedyPermutation
+ * \brief	Chooses landmarks among the points of a point cloud or finite metric space by farthest-point sampling.
+ *
+ * The first landmark is point 0, and each following landmark is a point farthest from the landmarks already chosen, the
+ * point with the smallest index among those that are equally far. Each prefix of the landmarks is therefore spread out
+ * over the whole space. Choosing m landmarks among n points takes O(nm) distance computations, made in parallel.
+ */
+
+#ifndef GREEDY_PERMUTATION_H
+#define GREEDY_PERMUTATION_H
+
+#include <vector>
+
+class GreedyPermutation {
+public:
+    GreedyPermutation();
+
+    //chooses num_landmarks landmarks among points in Euclidean space, by their coordinates, stored point by point
+    void build(const double* coords, unsigned num_points, unsigned dimension, unsigned num_landmarks);
+
+    //chooses num_landmarks landmarks among the points of a metric space, from the distances between them: either the full
+    //  matrix, stored row by row, or only the entries above its diagonal if !full, as for DistanceMatrix::read_distance_matrix()
+    void build_metric(const double* distances, unsigned num_points, bool full, unsigned num_landmarks);
+
+    //returns the landmarks in increasing order, so that the points keep the order in which they were given
+    std::vector<unsigned> sorted_landmarks() const;
+
+    std::vector<unsigned> landmarks; //the landmarks, in the order in which they were chosen
+    std::vector<double> radii; //radii[k] is the distance from landmarks[k] to the landmarks chosen before it; infinity for the first landmark
+    double covering_radius; //the largest distance from a point to its nearest landmark
+
+private:
+    template <typename Distance>
+    void select(unsigned num_points, unsigned num_landmarks, Distance distance);
+};
+
+#endif // GREEDY_PERMUTATION_H
@@ -0,0 +1,336 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "neighbor_graph.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+//a k-d tree over a set of points, used to find the points within a given distance of each point
+class KdTree {
+public:
+    KdTree(const double* coords, unsigned num_points, unsigned dimension);
+
+    //stores in result the points j > i whose distance from point i is at most radius, with their distances
+    void neighbors(unsigned i, double radius, std::vector<std::pair<unsigned, double>>& result) const;
+
+private:
+    struct Node {
+        unsigned first, last; //the node contains points[first], ..., points[last - 1]
+        unsigned max_point; //the largest index of a point in the node
+        unsigned split_dim; //for an internal node, the points of the left child have coordinate split_dim at most split, and those of the right child at least split
+        double split;
+        unsigned left, right; //children of an internal node; 0 for a leaf
+    };
+
+    static const unsigned LEAF_SIZE = 16;
+
+    const double* coords;
+    unsigned dimension;
+    std::vector<unsigned> points;
+    std::vector<Node> nodes;
+
+    unsigned build(unsigned first, unsigned last); //builds the subtree containing points[first], ..., points[last - 1], and returns its root
+    void search(unsigned node, unsigned i, double radius_squared, std::vector<std::pair<unsigned, double>>& result) const;
+};
+
+KdTree::KdTree(const double* coords, unsigned num_points, unsigned dimension)
+    : coords(coords)
+    , dimension(dimension)
+    , points(num_points)
+{
+    for (unsigned i = 0; i < num_points; i++)
+        points[i] = i;
+    nodes.reserve(2 * (num_points / LEAF_SIZE + 1));
+    build(0, num_points);
+}
+
+unsigned KdTree::build(unsigned first, unsigned last)
+{
+    unsigned index = nodes.size();
+    nodes.push_back(Node{ first, last, 0, 0, 0, 0, 0 });
+    nodes[index].max_point = *std::max_element(points.begin() + first, points.begin() + last);
+    if (last - first <= LEAF_SIZE)
+        return index;
+
+    //split along the dimension in which the points are most spread out
+    unsigned split_dim = 0;
+    double max_spread = 0;
+    for (unsigned k = 0; k < dimension; k++) {
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        for (unsigned p = first; p < last; p++) {
+            double x = coords[(std::size_t)points[p] * dimension + k];
+            min = std::min(min, x);
+            max = std::max(max, x);
+        }
+        if (max - min > max_spread) {
+            max_spread = max - min;
+            split_dim = k;
+        }
+    }
+    if (max_spread == 0) //then all points are equal
+        return index;
+
+    unsigned mid = first + (last - first) / 2;
+    std::nth_element(points.begin() + first, points.begin() + mid, points.begin() + last, [this, split_dim](unsigned a, unsigned b) {
+        return coords[(std::size_t)a * dimension + split_dim] < coords[(std::size_t)b * dimension + split_dim];
+    });
+    double split = coords[(std::size_t)points[mid] * dimension + split_dim];
+
+    unsigned left = build(first, mid);
+    unsigned right = build(mid, last);
+    nodes[index].split_dim = split_dim;
+    nodes[index].split = split;
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+void KdTree::neighbors(unsigned i, double radius, std::vector<std::pair<unsigned, double>>& result) const
+{
+    result.clear();
+    search(0, i, radius * radius, result);
+}
+
+void KdTree::search(unsigned node, unsigned i, double radius_squared, std::vector<std::pair<unsigned, double>>& result) const
+{
+    const Node& n = nodes[node];
+    if (n.max_point <= i) //then the node has no points j > i
+        return;
+
+    const double* x = coords + (std::size_t)i * dimension;
+    if (n.left == 0) {
+        for (unsigned p = n.first; p < n.last; p++) {
+            unsigned j = points[p];
+            if (j <= i)
+                continue;
+
+            //add the squares in the same order as DistanceMatrix, so that the distance is the same
+            const double* y = coords + (std::size_t)j * dimension;
+            double square = 0;
+            unsigned k = 0;
+            for (; k < dimension && square <= radius_squared; k++) {
+                double kth_dist = x[k] - y[k];
+                square += kth_dist * kth_dist;
+            }
+            if (square <= radius_squared)
+                result.push_back(std::make_pair(j, std::sqrt(square)));
+        }
+        return;
+    }
+
+    //search the side of the splitting plane that contains point i first, and the other side if it is close enough
+    double diff = x[n.split_dim] - n.split;
+    unsigned near = (diff <= 0) ? n.left : n.right;
+    unsigned far = (diff <= 0) ? n.right : n.left;
+    search(near, i, radius_squared, result);
+    if (diff * diff <= radius_squared)
+        search(far, i, radius_squared, result);
+}
+
+} //end anonymous namespace
+
+NeighborGraph::NeighborGraph()
+    : starts(1, 1)
+    , neighbors(1, 0)
+    , dist_indexes(1, 0)
+    , words_per_row(0)
+{
+}
+
+void NeighborGraph::build(const double* coords, unsigned num_points, unsigned dimension, double radius, std::vector<double>& distances)
+{
+    KdTree tree(coords, num_points, dimension);
+
+    //find the neighbors of each point in parallel, then store the rows one after another
+    std::vector<std::vector<std::pair<unsigned, double>>> rows(num_points);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (long i = 0; i < (long)num_points; i++) {
+        tree.neighbors(i, radius, rows[i]);
+        std::sort(rows[i].begin(), rows[i].end());
+    }
+
+    starts.assign(num_points + 1, 1);
+    for (unsigned i = 0; i < num_points; i++)
+        starts[i + 1] = starts[i] + rows[i].size();
+    if (starts[num_points] > std::numeric_limits<unsigned>::max())
+        throw std::runtime_error("Too many pairs of points within the maximum distance; choose a smaller maximum distance.");
+
+    neighbors.resize(starts[num_points]);
+    neighbors[0] = 0;
+    distances.resize(starts[num_points]);
+    distances[0] = 0; //distance from a point to itself is always zero
+#pragma omp parallel for schedule(dynamic, 64)
+    for (long i = 0; i < (long)num_points; i++) {
+        std::size_t e = starts[i];
+        for (const auto& neighbor : rows[i]) {
+            neighbors[e] = neighbor.first;
+            distances[e] = neighbor.second;
+            e++;
+        }
+        std::vector<std::pair<unsigned, double>>().swap(rows[i]);
+    }
+    dist_indexes.assign(starts[num_points], 0);
+    index_rows();
+} //end build()
+
+//block b of rows reads the entries of each row of the triangle for the points of the block, which are stored together
+void NeighborGraph::build(const std::vector<unsigned>& triangle, unsigned num_points, unsigned absent)
+{
+    const unsigned BLOCK = 256;
+    long num_blocks = (num_points + BLOCK - 1) / BLOCK;
+
+    //count the neighbors j > i of each point i
+    starts.assign(num_points + 1, 0);
+#pragma omp parallel for schedule(dynamic)
+    for (long b = 0; b < num_blocks; b++) {
+        unsigned first = b * BLOCK;
+        unsigned last = std::min(num_points, first + BLOCK);
+        for (unsigned j = first + 1; j < num_points; j++) {
+            const unsigned* row = &triangle[(std::size_t)j * (j - 1) / 2 + 1];
+            for (unsigned i = first; i < last && i < j; i++)
+                if (row[i] != absent)
+                    starts[i + 1]++;
+        }
+    }
+    starts[0] = 1;
+    for (unsigned i = 0; i < num_points; i++)
+        starts[i + 1] += starts[i];
+
+    neighbors.resize(starts[num_points]);
+    neighbors[0] = 0;
+    dist_indexes.resize(starts[num_points]);
+    dist_indexes[0] = triangle[0];
+#pragma omp parallel for schedule(dynamic)
+    for (long b = 0; b < num_blocks; b++) {
+        unsigned first = b * BLOCK;
+        unsigned last = std::min(num_points, first + BLOCK);
+        std::vector<std::size_t> next(starts.begin() + first, starts.begin() + last);
+        for (unsigned j = first + 1; j < num_points; j++) {
+            const unsigned* row = &triangle[(std::size_t)j * (j - 1) / 2 + 1];
+            for (unsigned i = first; i < last && i < j; i++) {
+                if (row[i] != absent) {
+                    neighbors[next[i - first]] = j;
+                    dist_indexes[next[i - first]] = row[i];
+                    next[i - first]++;
+                }
+            }
+        }
+    }
+    index_rows();
+} //end build()
+
+void NeighborGraph::remove_edges(unsigned absent)
+{
+    std::size_t kept = 1;
+    std::size_t first = starts[0];
+    for (std::size_t i = 0; i + 1 < starts.size(); i++) {
+        std::size_t last = starts[i + 1];
+        starts[i] = kept;
+        for (std::size_t e = first; e < last; e++) {
+            if (dist_indexes[e] != absent) {
+                neighbors[kept] = neighbors[e];
+                dist_indexes[kept] = dist_indexes[e];
+                kept++;
+            }
+        }
+        first = last;
+    }
+    starts.back() = kept;
+
+    neighbors.resize(kept);
+    neighbors.shrink_to_fit();
+    dist_indexes.resize(kept);
+    dist_indexes.shrink_to_fit();
+    index_rows();
+}
+
+void NeighborGraph::candidates(unsigned i, std::vector<Candidate>& result) const
+{
+    result.clear();
+    for (std::size_t e = starts[i]; e < starts[i + 1]; e++)
+        result.push_back(Candidate{ neighbors[e], dist_indexes[e] });
+}
+
+void NeighborGraph::intersect(unsigned v, std::vector<Candidate>::const_iterator first, std::vector<Candidate>::const_iterator last,
+    std::vector<Candidate>& result) const
+{
+    result.clear();
+    if (is_dense()) {
+        //test the bit of each candidate in the row of v; the edge to it comes after the neighbors of v before it
+        const std::uint64_t* bits = &row_bits[v * words_per_row];
+        const unsigned* ranks = &row_ranks[v * words_per_row];
+        for (; first != last; ++first) {
+            unsigned w = first->vertex / 64;
+            std::uint64_t bit = std::uint64_t(1) << (first->vertex % 64);
+            if (bits[w] & bit) {
+                std::size_t e = starts[v] + ranks[w] + std::bitset<64>(bits[w] & (bit - 1)).count();
+                result.push_back(Candidate{ first->vertex, std::max(first->dist, dist_indexes[e]) });
+            }
+        }
+        return;
+    }
+
+    std::size_t e = starts[v];
+    std::size_t end = starts[v + 1];
+    while (first != last && e != end) {
+        if (neighbors[e] < first->vertex) {
+            e++;
+        } else if (first->vertex < neighbors[e]) {
+            ++first;
+        } else {
+            result.push_back(Candidate{ first->vertex, std::max(first->dist, dist_indexes[e]) });
+            ++first;
+            e++;
+        }
+    }
+}
+
+//the bitsets take about 3n^2/16 bytes for n points, which is at most the memory of the edges when the graph is dense
+void NeighborGraph::index_rows()
+{
+    unsigned num_points = this->num_points();
+    if (num_edges() * 32 < (std::size_t)num_points * (num_points - 1)) {
+        words_per_row = 0;
+        std::vector<std::uint64_t>().swap(row_bits);
+        std::vector<unsigned>().swap(row_ranks);
+        return;
+    }
+
+    words_per_row = (num_points + 63) / 64;
+    row_bits.assign(num_points * words_per_row, 0);
+    row_ranks.assign(num_points * words_per_row, 0);
+#pragma omp parallel for schedule(dynamic, 64)
+    for (long i = 0; i < (long)num_points; i++) {
+        std::uint64_t* bits = &row_bits[i * words_per_row];
+        unsigned* ranks = &row_ranks[i * words_per_row];
+        for (std::size_t e = starts[i]; e < starts[i + 1]; e++)
+            bits[neighbors[e] / 64] |= std::uint64_t(1) << (neighbors[e] % 64);
+        for (std::size_t w = 1; w < words_per_row; w++)
+            ranks[w] = ranks[w - 1] + std::bitset<64>(bits[w - 1]).count();
+    }
+} //end index_rows()
@@ -0,0 +1,87 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	NeighborGraph
+ * \brief	Stores the pairs of points that are joined by an edge of a Rips complex, with the discrete distance of each pair,
+ *          in compressed sparse row form.
+ *
+ * Row i lists the neighbors j > i of point i in increasing order. Edges are numbered from 1 in row order, so that entry 0
+ * of a vector indexed by edge can hold the distance from a point to itself, as in the triangular layout used by DistanceMatrix.
+ * Memory is proportional to the number of edges, so this is used instead of the triangle when the maximum distance is small.
+ *
+ * When at least one pair of points in 16 is joined by an edge, each row also keeps a bitset of its neighbors, so that
+ * intersect() tests each candidate in constant time instead of merging it with the whole row.
+ */
+
+#ifndef NEIGHBOR_GRAPH_H
+#define NEIGHBOR_GRAPH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class NeighborGraph {
+public:
+    //a vertex that may be added to a clique, with the largest discrete distance from it to the vertices of the clique
+    struct Candidate {
+        unsigned vertex;
+        unsigned dist;
+    };
+
+    NeighborGraph();
+
+    //finds the pairs of points within distance radius of each other with a k-d tree, and stores them as the edges;
+    //  coords holds the coordinates of the points, stored point by point
+    //  stores the distance of edge e in distances[e], computed as by DistanceMatrix, and 0 in distances[0]
+    void build(const double* coords, unsigned num_points, unsigned dimension, double radius, std::vector<double>& distances);
+
+    //stores the pairs of points i < j whose discrete distance triangle[j(j-1)/2 + i + 1] is not absent as the edges, with these
+    //  discrete distances, and triangle[0] as the discrete distance of a point to itself
+    void build(const std::vector<unsigned>& triangle, unsigned num_points, unsigned absent);
+
+    //removes the edges e with dist_indexes[e] == absent
+    void remove_edges(unsigned absent);
+
+    unsigned num_points() const { return starts.size() - 1; }
+    std::size_t num_edges() const { return neighbors.size() - 1; }
+    bool is_dense() const { return !row_bits.empty(); } //true iff the rows have bitsets of their neighbors
+
+    //stores the neighbors of vertex i as candidates, in increasing order
+    void candidates(unsigned i, std::vector<Candidate>& result) const;
+
+    //stores in result the candidates in [first, last) that are neighbors of vertex v, with their dist increased to the distance from v
+    //  if that is larger; the candidates must be greater than v and in increasing order, and so are the results
+    void intersect(unsigned v, std::vector<Candidate>::const_iterator first, std::vector<Candidate>::const_iterator last,
+        std::vector<Candidate>& result) const;
+
+    std::vector<std::size_t> starts; //the edges of row i are starts[i], ..., starts[i + 1] - 1
+    std::vector<unsigned> neighbors; //neighbors[e] is the larger endpoint of edge e; neighbors[0] is unused
+    std::vector<unsigned> dist_indexes; //dist_indexes[e] is the discrete distance of edge e, and dist_indexes[0] that of a point to itself
+
+private:
+    //builds the bitsets of the rows if the graph is dense, and frees them otherwise; called whenever the edges change
+    void index_rows();
+
+    std::size_t words_per_row;
+    std::vector<std::uint64_t> row_bits; //bit j of word j / 64 of row i is set iff j is a neighbor of i; rows have words_per_row words
+    std::vector<unsigned> row_ranks; //the number of neighbors of i in the words of row i before word w
+};
+
+#endif // NEIGHBOR_GRAPH_H
@@ -0,0 +1,66 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \brief	Sorts a vector with OpenMP: each thread sorts one chunk, and then the sorted chunks are merged pairwise.
+ */
+
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace rivet {
+
+template <typename T, typename Compare>
+void parallel_sort(std::vector<T>& values, Compare comp)
+{
+    int num_chunks = 1;
+#ifdef _OPENMP
+    num_chunks = omp_get_max_threads();
+#endif
+    if (num_chunks <= 1 || values.size() < 65536) {
+        std::sort(values.begin(), values.end(), comp);
+        return;
+    }
+
+    std::vector<std::size_t> bounds(num_chunks + 1);
+    for (int c = 0; c <= num_chunks; c++)
+        bounds[c] = values.size() * c / num_chunks;
+
+#pragma omp parallel for schedule(static, 1)
+    for (int c = 0; c < num_chunks; c++)
+        std::sort(values.begin() + bounds[c], values.begin() + bounds[c + 1], comp);
+
+    for (int width = 1; width < num_chunks; width *= 2) {
+#pragma omp parallel for schedule(static, 1)
+        for (int c = 0; c < num_chunks - width; c += 2 * width)
+            std::inplace_merge(values.begin() + bounds[c], values.begin() + bounds[c + width], values.begin() + bounds[std::min(c + 2 * width, num_chunks)], comp);
+    }
+} //end parallel_sort()
+
+} //end namespace rivet
+
+#endif // PARALLEL_SORT_H
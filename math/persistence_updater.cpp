@@ -30,17 +30,24 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "map_matrix.h"
 #include "multi_betti.h"
 
+#include <algorithm>
 #include <chrono>
+#include <exception>
+#include <iterator>
+#include <set>
 #include <stdexcept> //for error-checking and debugging
 #include <stdlib.h> //for rand()
 #include <timer.h>
 
+const std::pair<unsigned, unsigned> PersistenceUpdater::NO_BAR(0, 0);
+
 //constructor for when we must compute all of the barcode templates
 PersistenceUpdater::PersistenceUpdater(Arrangement& m, FIRep& b, std::vector<TemplatePoint>& xi_pts, unsigned verbosity)
     : arrangement(m)
     , fir(b)
     , verbosity(verbosity)
     , template_points_matrix(m.x_exact.size(), m.y_exact.size())
+    , all_columns_dirty(true)
 //    , testing(false)
 {
     //fill the xiSupportMatrix with the xi support points and anchors
@@ -51,6 +58,17 @@ PersistenceUpdater::PersistenceUpdater(Arrangement& m, FIRep& b, std::vector<Tem
     }
 }
 
+//constructor for a worker that traverses one segment of the path, concurrently with other workers
+//  the worker has its own copy of the TemplatePointsMatrix, so that its lift map is independent of the lift maps of the other workers
+PersistenceUpdater::PersistenceUpdater(Arrangement& m, FIRep& b, const TemplatePointsMatrix& tpm, unsigned verbosity)
+    : arrangement(m)
+    , fir(b)
+    , verbosity(verbosity)
+    , template_points_matrix(tpm)
+    , all_columns_dirty(true)
+{
+}
+
 ////constructor for when we load the pre-computed barcode templates from a RIVET data file
 //PersistenceUpdater::PersistenceUpdater(Arrangement& m, std::vector<TemplatePoint>& xi_pts) :
 //    arrangement(m),
@@ -159,25 +177,163 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<Halfedge*>& path,
     }
 
     //data members for analyzing the computation
-    unsigned long total_transpositions = 0;
-    unsigned total_time_for_transpositions = 0; //NEW
-    unsigned number_of_resets = 1; //we count the initial RU-decomposition as the first reset
-    int max_time = 0;
+    TraversalStats stats;
+    stats.total_transpositions = 0;
+    stats.total_time_for_transpositions = 0; //NEW
+    stats.total_time_for_resets = total_time_for_resets;
+    stats.number_of_resets = 1; //we count the initial RU-decomposition as the first reset
+    stats.max_time = 0;
 
     // choose the initial value of the threshold intelligently
-    unsigned long threshold;
-    choose_initial_threshold(total_time_for_resets, total_transpositions, total_time_for_transpositions, threshold);
+    choose_initial_threshold(stats.total_time_for_resets, stats.total_transpositions, stats.total_time_for_transpositions, stats.threshold);
     //if the number of swaps might exceed this threshold, then we will do a persistence calculation from scratch instead of vineyard updates
     if (verbosity >= 4) {
-        debug() << "initial reset threshold set to" << threshold;
+        debug() << "initial reset threshold set to" << stats.threshold;
     }
 
+    //determine the direction of each anchor crossing, and the cells in which we will store barcode templates
+    std::vector<bool> from_below;
+    std::vector<bool> store_template;
+    prepare_path(path, first_cell, from_below, store_template);
+
+    //split the path into segments, one for each thread
+    unsigned num_segments = 1;
+    if (omp_get_max_threads() > 1)
+        num_segments = std::min((unsigned)omp_get_max_threads(), (unsigned)(path.size() / MIN_SEGMENT_LENGTH));
+    std::vector<unsigned> bounds;
+    split_path(path, num_segments, bounds);
+    num_segments = bounds.size() - 1;
+
     timer.restart();
 
+    if (num_segments <= 1) {
+        traverse_path(path, 0, path.size(), from_below, store_template, R_low_initial, R_high_initial, stats, &progress);
+    } else {
+        if (verbosity >= 4) {
+            debug() << "  path split into" << num_segments << "segments, which will be traversed concurrently";
+        }
+
+        //each segment begins with the statistics gathered so far; this thread's matrices are used for the first segment
+        std::vector<TraversalStats> segment_stats(num_segments, stats);
+        unsigned steps_done = 0;
+        std::exception_ptr error = nullptr;
+
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int k = 0; k < (int)num_segments; k++) {
+            try {
+                if (k == 0) {
+                    traverse_path(path, bounds[0], bounds[1], from_below, store_template, R_low_initial, R_high_initial, segment_stats[0], NULL);
+                } else {
+                    PersistenceUpdater worker(arrangement, fir, template_points_matrix, verbosity);
+                    worker.traverse_segment(path, bounds[k], bounds[k + 1], from_below, store_template, R_low_initial, R_high_initial, segment_stats[k]);
+                }
+            } catch (...) {
+#pragma omp critical
+                error = std::current_exception();
+            }
+
+#pragma omp critical
+            {
+                steps_done += bounds[k + 1] - bounds[k];
+                progress.progress(steps_done); //update progress bar
+            }
+        }
+
+        if (error)
+            std::rethrow_exception(error);
+
+        //combine the statistics for all segments
+        stats = segment_stats[0];
+        for (unsigned k = 1; k < num_segments; k++) {
+            stats.total_transpositions += segment_stats[k].total_transpositions;
+            stats.number_of_resets += segment_stats[k].number_of_resets;
+            stats.total_time_for_resets += segment_stats[k].total_time_for_resets;
+            if (segment_stats[k].max_time > stats.max_time)
+                stats.max_time = segment_stats[k].max_time;
+        }
+    }
+
+    //number the templates in the order of the faces, so that the output does not depend on the order of the segments
+    arrangement.renumber_barcode_templates();
+
+    //print runtime data
+    if (verbosity >= 2) {
+        debug() << "BARCODE TEMPLATE COMPUTATION COMPLETE: path traversal and persistence updates took" << timer.elapsed() << "milliseconds";
+        if (verbosity >= 4) {
+            debug() << "    max time per anchor crossing:" << stats.max_time;
+            debug() << "    total number of transpositions:" << stats.total_transpositions;
+            debug() << "    matrices were reset" << stats.number_of_resets << "times when estimated number of transpositions exceeded" << stats.threshold;
+            if (stats.number_of_resets > 0) {
+                debug() << "    average time for reset:" << (stats.total_time_for_resets / stats.number_of_resets) << "milliseconds";
+            }
+        }
+    }
+
+    // PART 4: CLEAN UP
+
+    delete R_low;
+    delete R_high;
+    delete U_low;
+    delete U_high;
+
+    delete R_low_initial;
+    delete R_high_initial;
+} //end store_barcodes_with_reset()
+
+//records the direction in which the anchor is crossed at each step of the path (and toggles the anchors accordingly),
+//  and marks the steps at which a cell is visited for the first time (the first cell has already been visited)
+void PersistenceUpdater::prepare_path(std::vector<Halfedge*>& path, Face* first_cell, std::vector<bool>& from_below, std::vector<bool>& store_template)
+{
+    from_below.resize(path.size());
+    store_template.resize(path.size());
+
+    std::set<Face*> visited;
+    visited.insert(first_cell);
+
+    for (unsigned i = 0; i < path.size(); i++) {
+        //determine whether the anchor is crossed from below, then remember that we have crossed it
+        Anchor* cur_anchor = (path[i])->get_anchor();
+        from_below[i] = cur_anchor->is_above();
+        cur_anchor->toggle();
+
+        //the barcode template is stored the first time we enter each cell
+        store_template[i] = visited.insert((path[i])->get_face()).second;
+    }
+} //end prepare_path()
+
+//splits the path into at most num_segments segments of roughly equal cost
+//  the cost of each step is estimated from the weight of the anchor crossed at that step
+void PersistenceUpdater::split_path(std::vector<Halfedge*>& path, unsigned num_segments, std::vector<unsigned>& bounds)
+{
+    bounds.clear();
+    bounds.push_back(0);
+
+    if (num_segments > 1) {
+        double total_cost = 0;
+        for (unsigned i = 0; i < path.size(); i++)
+            total_cost += 1 + (path[i])->get_anchor()->get_weight();
+
+        //end a segment each time the cumulative cost passes the next multiple of (total_cost / num_segments)
+        double cost = 0;
+        for (unsigned i = 0; i + 1 < path.size() && bounds.size() < num_segments; i++) {
+            cost += 1 + (path[i])->get_anchor()->get_weight();
+            if (cost >= total_cost * bounds.size() / num_segments)
+                bounds.push_back(i + 1);
+        }
+    }
+
+    bounds.push_back(path.size());
+} //end split_path()
+
+//traverses steps begin to (end - 1) of the path, updating persistence at each step and storing barcode templates in the cells marked by store_template
+void PersistenceUpdater::traverse_path(std::vector<Halfedge*>& path, unsigned begin, unsigned end, const std::vector<bool>& from_below, const std::vector<bool>& store_template,
+    MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial, TraversalStats& stats, Progress* progress)
+{
     //traverse the path
     Timer steptimer;
-    for (unsigned i = 0; i < path.size(); i++) {
-        progress.progress(i); //update progress bar
+    for (unsigned i = begin; i < end; i++) {
+        if (progress != NULL)
+            progress->progress(i); //update progress bar
 
         steptimer.restart(); //time update at each step of the path
         unsigned long num_trans = 0; //count of how many transpositions we will have to do if we do vineyard updates
@@ -185,7 +341,7 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<Halfedge*>& path,
 
         //determine which anchor is represented by this edge
         Anchor* cur_anchor = (path[i])->get_anchor();
-        TemplatePointsMatrixEntry* at_anchor = cur_anchor->get_entry();
+        TemplatePointsMatrixEntry* at_anchor = template_points_matrix.get_entry(cur_anchor->get_entry()->index);
 
         //get equivalence classes for this anchor
         TemplatePointsMatrixEntry* down = at_anchor->down;
@@ -199,21 +355,21 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<Halfedge*>& path,
             }
 
             //find out how many transpositions we will have to process if we do vineyard updates
-            num_trans = count_transpositions(at_anchor, cur_anchor->is_above());
+            num_trans = count_transpositions(at_anchor, from_below[i]);
 
-            if (cur_anchor->is_above()) //then the anchor is crossed from below to above
+            if (from_below[i]) //then the anchor is crossed from below to above
             {
                 remove_lift_entries(at_anchor); //this block of the partition might become empty
                 remove_lift_entries(down); //this block of the partition will move
 
-                if (num_trans < threshold) //then do vineyard updates
+                if (num_trans < stats.threshold) //then do vineyard updates
                 {
                     swap_counter += split_grade_lists(at_anchor, left, true); //move grades that come before left from anchor to left -- vineyard updates
                     swap_counter += move_columns(down, left, true); //swaps blocks of columns at down and at left -- vineyard updates
                 } else //then reset the matrices
                 {
                     split_grade_lists_no_vineyards(at_anchor, left, true); //only updates the xiSupportMatrix and permutation vectors; no vineyard updates
-                    update_order_and_reset_matrices(down, left, true, R_low_initial, R_high_initial); //recompute the RU-decomposition
+                    update_order_and_reset_matrices(down, left, true, RL_initial, RH_initial); //recompute the RU-decomposition
                 }
 
                 merge_grade_lists(at_anchor, down); //move all grades from down to anchor
@@ -224,14 +380,14 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<Halfedge*>& path,
                 remove_lift_entries(at_anchor); //this block of the partition might become empty
                 remove_lift_entries(left); //this block of the partition will move
 
-                if (num_trans < threshold) //then do vineyard updates
+                if (num_trans < stats.threshold) //then do vineyard updates
                 {
                     swap_counter += split_grade_lists(at_anchor, down, false); //move grades that come before left from anchor to left -- vineyard updates
                     swap_counter += move_columns(left, down, false); //swaps blocks of columns at down and at left -- vineyard updates
                 } else //then reset the matrices
                 {
                     split_grade_lists_no_vineyards(at_anchor, down, false); //only updates the xiSupportMatrix and permutation vectors; no vineyard updates
-                    update_order_and_reset_matrices(left, down, false, R_low_initial, R_high_initial); //recompute the RU-decomposition
+                    update_order_and_reset_matrices(left, down, false, RL_initial, RH_initial); //recompute the RU-decomposition
                 }
 
                 merge_grade_lists(at_anchor, left); //move all grades from down to anchor
@@ -248,7 +404,7 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<Halfedge*>& path,
             if (generator == nullptr)
                 generator = at_anchor->left;
 
-            if ((cur_anchor->is_above() && generator == at_anchor->down) || (!cur_anchor->is_above() && generator == at_anchor->left))
+            if ((from_below[i] && generator == at_anchor->down) || (!from_below[i] && generator == at_anchor->left))
             //then merge classes -- there will never be any transpositions in this case
             {
                 remove_lift_entries(generator);
@@ -265,12 +421,12 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<Halfedge*>& path,
                 //now do the updates
                 remove_lift_entries(at_anchor); //this is necessary because the class corresponding to at_anchor might become empty
 
-                if (num_trans < threshold) //then do vineyard updates
+                if (num_trans < stats.threshold) //then do vineyard updates
                     swap_counter += split_grade_lists(at_anchor, generator, horiz);
                 else //then reset the matrices
                 {
                     split_grade_lists_no_vineyards(at_anchor, generator, horiz); //only updates the xiSupportMatrix; no vineyard updates
-                    update_order_and_reset_matrices(R_low_initial, R_high_initial); //recompute the RU-decomposition
+                    update_order_and_reset_matrices(RL_initial, RH_initial); //recompute the RU-decomposition
                 }
 
                 add_lift_entries(at_anchor);
@@ -278,18 +434,14 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<Halfedge*>& path,
             }
         }
 
-        //remember that we have crossed this anchor
-        cur_anchor->toggle();
-
-        //if this cell does not yet have a barcode template, then store it now
-        Face* cur_face = (path[i])->get_face();
-        if (!cur_face->has_been_visited())
-            store_barcode_template(cur_face);
+        //if this is the first time we enter this cell, then store its barcode template now
+        if (store_template[i])
+            store_barcode_template((path[i])->get_face());
 
         //print/store data for analysis
         int step_time = steptimer.elapsed();
 
-        if (num_trans < threshold) //then we did vineyard-updates
+        if (num_trans < stats.threshold) //then we did vineyard-updates
         {
             if (verbosity >= 6) {
                 debug() << "  --> this step took" << step_time << "milliseconds and involved" << swap_counter << "transpositions; estimate was" << num_trans;
@@ -299,8 +451,8 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<Halfedge*>& path,
 
             if (swap_counter > 0) //don't track time for overhead that doesn't result in any transpositions
             {
-                total_transpositions += swap_counter;
-                total_time_for_transpositions += step_time;
+                stats.total_transpositions += swap_counter;
+                stats.total_time_for_transpositions += step_time;
             }
         } else {
             if (verbosity >= 6) {
@@ -308,50 +460,102 @@ void PersistenceUpdater::store_barcodes_with_reset(std::vector<Halfedge*>& path,
             }
             //TESTING: if (swap_counter > 0)
             //    debug() << "    ========>>> ERROR: swaps occurred on a matrix reset!";
-            number_of_resets++;
-            total_time_for_resets += step_time;
+            stats.number_of_resets++;
+            stats.total_time_for_resets += step_time;
         }
 
-        if (step_time > max_time)
-            max_time = step_time;
+        if (step_time > stats.max_time)
+            stats.max_time = step_time;
 
         //update the treshold
-        if (swap_counter > 0 || num_trans >= threshold) {
-            threshold = (unsigned long)(((double)total_transpositions / total_time_for_transpositions) * ((double)total_time_for_resets / number_of_resets));
+        if (swap_counter > 0 || num_trans >= stats.threshold) {
+            stats.threshold = (unsigned long)(((double)stats.total_transpositions / stats.total_time_for_transpositions) * ((double)stats.total_time_for_resets / stats.number_of_resets));
             if (verbosity >= 6) {
                 // debug() << "===>>> UPDATING THRESHOLD:";
                 // debug() << "    total_trans: " << total_transpositions;
                 // debug() << "    total_time_for_trans: " << total_time_for_transpositions;
                 // debug() << "    total time for resets: " << total_time_for_resets;
                 // debug() << "    number of resets:" << number_of_resets;
-                debug() << "  -- new threshold:" << threshold;
+                debug() << "  -- new threshold:" << stats.threshold;
             }
         }
     } //end path traversal
+} //end traverse_path()
 
-    //print runtime data
-    if (verbosity >= 2) {
-        debug() << "BARCODE TEMPLATE COMPUTATION COMPLETE: path traversal and persistence updates took" << timer.elapsed() << "milliseconds";
-        if (verbosity >= 4) {
-            debug() << "    max time per anchor crossing:" << max_time;
-            debug() << "    total number of transpositions:" << total_transpositions;
-            debug() << "    matrices were reset" << number_of_resets << "times when estimated number of transpositions exceeded" << threshold;
-            if (number_of_resets > 0) {
-                debug() << "    average time for reset:" << (total_time_for_resets / number_of_resets) << "milliseconds";
+//called on a worker: moves the lift map to the cell at the start of step begin, resets the matrices there, and then traverses steps begin to (end - 1) of the path
+//  the initial matrices RL_initial and RH_initial belong to the parent, and are only read
+void PersistenceUpdater::traverse_segment(std::vector<Halfedge*>& path, unsigned begin, unsigned end, const std::vector<bool>& from_below, const std::vector<bool>& store_template,
+    MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial, TraversalStats& stats)
+{
+    Timer timer;
+
+    //build the lift map at the initial cell, as the parent did
+    IndexMatrix* ind_low = &(fir.low_mx.ind);
+    store_multigrades(ind_low, true);
+    IndexMatrix* ind_high = &(fir.high_mx.ind);
+    store_multigrades(ind_high, false);
+
+    std::vector<int> low_simplex_order;
+    build_simplex_order(ind_low, true, low_simplex_order);
+    std::vector<int> high_simplex_order;
+    build_simplex_order(ind_high, false, high_simplex_order);
+
+    //store the position of the rightmost column of each multigrade at the initial cell;
+    //  columns at the same multigrade stay together, in the same relative order, as we move along the path
+    for (unsigned row = 0; row < template_points_matrix.height(); row++) {
+        for (TemplatePointsMatrixEntry* cur = template_points_matrix.get_row(row); cur != nullptr; cur = cur->left) {
+            for (Multigrade* mg : cur->low_simplices)
+                mg->simplex_index = low_simplex_order[mg->simplex_index];
+            for (Multigrade* mg : cur->high_simplices)
+                mg->simplex_index = high_simplex_order[mg->simplex_index];
+        }
+    }
+
+    //move the lift map along the path to the start of this segment, without doing anything to the matrices
+    for (unsigned i = 0; i < begin; i++) {
+        TemplatePointsMatrixEntry* at_anchor = template_points_matrix.get_entry((path[i])->get_anchor()->get_entry()->index);
+        TemplatePointsMatrixEntry* down = at_anchor->down;
+        TemplatePointsMatrixEntry* left = at_anchor->left;
+
+        if (down != nullptr && left != nullptr) //then this is a strict anchor
+        {
+            if (from_below[i]) {
+                do_separations(at_anchor, left, true);
+                move_grade_lists(down, left, true);
+                merge_grade_lists(at_anchor, down);
+            } else {
+                do_separations(at_anchor, down, false);
+                move_grade_lists(left, down, false);
+                merge_grade_lists(at_anchor, left);
             }
+        } else //this is a non-strict anchor
+        {
+            TemplatePointsMatrixEntry* generator = (down != nullptr) ? down : left;
+
+            if ((from_below[i] && generator == down) || (!from_below[i] && generator == left))
+                merge_grade_lists(at_anchor, generator);
+            else
+                do_separations(at_anchor, generator, (generator == left));
         }
     }
 
-    // PART 4: CLEAN UP
+    //reset the matrices at the start of this segment
+    R_low = new MapMatrix_Perm(*RL_initial);
+    R_high = new MapMatrix_Perm(*RH_initial);
+    reset_matrices_from_grade_lists(RL_initial, RH_initial);
+
+    if (verbosity >= 6) {
+        debug() << "  -- moving to step" << begin << "of the path and resetting the matrices took" << timer.elapsed() << "milliseconds";
+    }
+
+    //now traverse this segment
+    traverse_path(path, begin, end, from_below, store_template, RL_initial, RH_initial, stats, NULL);
 
     delete R_low;
     delete R_high;
     delete U_low;
     delete U_high;
-
-    delete R_low_initial;
-    delete R_high_initial;
-} //end store_barcodes_with_reset()
+} //end traverse_segment()
 
 //function to set the "edge weights" for each anchor line
 void PersistenceUpdater::set_anchor_weights(std::vector<Halfedge*>& path)
@@ -954,6 +1158,10 @@ void PersistenceUpdater::vineyard_update_low(unsigned a)
 {
     unsigned b = a + 1;
 
+    //the bars of columns a and b may change, and no others
+    mark_low_column(a);
+    mark_low_column(b);
+
     bool a_pos = (R_low->low(a) == -1); //true iff simplex corresponding to column a is positive
     bool b_pos = (R_low->low(b) == -1); //true iff simplex corresponding to column b=a+1 is positive
 
@@ -1061,6 +1269,10 @@ void PersistenceUpdater::vineyard_update_high(unsigned a)
 {
     unsigned b = a + 1;
 
+    //the "low" columns paired with columns a and b, before and after the update, may change their bars
+    mark_high_column(a);
+    mark_high_column(b);
+
     bool a_pos = (R_high->low(a) == -1); //true iff simplex corresponding to column a is positive
     bool b_pos = (R_high->low(b) == -1); //true iff simplex corresponding to column b is positive
 
@@ -1120,11 +1332,63 @@ void PersistenceUpdater::vineyard_update_high(unsigned a)
         //finally, for Cases 2 and 3, transpose columns of U
         U_high->swap_columns(a);
     }
+
+    mark_high_column(a);
+    mark_high_column(b);
 } //end vineyard update_high()
 
+//moves grades associated with TemplatePointsMatrixEntry first to their new positions after or among the grades associated with TemplatePointsMatrixEntry second
+//  this function updates the lift map (and column indexes of each equivalence class) exactly as move_columns() does, but does NOT modify the matrices or permutation vectors
+void PersistenceUpdater::move_grade_lists(TemplatePointsMatrixEntry* first, TemplatePointsMatrixEntry* second, bool from_below)
+{
+    //set column indexes for the first class to their final position
+    first->low_index = second->low_index;
+    first->high_index = second->high_index;
+
+    //"low" simplices
+    for (std::list<Multigrade*>::iterator it = first->low_simplices.begin(); it != first->low_simplices.end();) //NOTE: iterator advances in loop
+    {
+        Multigrade* cur_grade = *it;
+
+        if ((from_below && cur_grade->x > second->x) || (!from_below && cur_grade->y > second->y)) //then columns at cur_grade move past columns at second
+        {
+            second->low_index -= cur_grade->num_cols;
+            ++it;
+        } else //then cur_grade now lifts to TemplatePointsMatrixEntry second
+        {
+            second->insert_multigrade(cur_grade, true);
+            it = first->low_simplices.erase(it); //NOTE: advances the iterator!!!
+
+            first->low_count -= cur_grade->num_cols;
+            second->low_count += cur_grade->num_cols;
+        }
+    }
+
+    //"high" simplices
+    for (std::list<Multigrade*>::iterator it = first->high_simplices.begin(); it != first->high_simplices.end();) //NOTE: iterator advances in loop
+    {
+        Multigrade* cur_grade = *it;
+
+        if ((from_below && cur_grade->x > second->x) || (!from_below && cur_grade->y > second->y)) //then columns at cur_grade move past columns at second
+        {
+            second->high_index -= cur_grade->num_cols;
+            ++it;
+        } else //then cur_grade now lifts to TemplatePointsMatrixEntry second
+        {
+            second->insert_multigrade(cur_grade, false);
+            it = first->high_simplices.erase(it); //NOTE: advances the iterator!!!
+
+            first->high_count -= cur_grade->num_cols;
+            second->high_count += cur_grade->num_cols;
+        }
+    }
+} //end move_grade_lists()
+
 //swaps two blocks of columns by updating the total order on columns, then rebuilding the matrices and computing a new RU-decomposition
 void PersistenceUpdater::update_order_and_reset_matrices(TemplatePointsMatrixEntry* first, TemplatePointsMatrixEntry* second, bool from_below, MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial)
 {
+    all_columns_dirty = true;
+
     //STEP 1: update the lift map for all multigrades and store the current column index for each multigrade
 
     //store current column index for each multigrade that lifts to TemplatePointsMatrixEntry second
@@ -1268,6 +1532,8 @@ void PersistenceUpdater::update_order_and_reset_matrices(TemplatePointsMatrixEnt
 //updates the total order on columns, rebuilds the matrices, and computing a new RU-decomposition for a NON-STRICT anchor
 void PersistenceUpdater::update_order_and_reset_matrices(MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial)
 {
+    all_columns_dirty = true;
+
     //anything to do here?????
 
     //re-build the matrix R based on the new order
@@ -1283,6 +1549,58 @@ void PersistenceUpdater::update_order_and_reset_matrices(MapMatrix_Perm* RL_init
 
 } //end update_order_and_reset_matrices()
 
+//rebuilds the lift entries and permutation vectors from the grade lists, then rebuilds the matrices and computes a new RU-decomposition
+//  precondition: the simplex_index of each multigrade is the position of its rightmost column at the initial cell
+void PersistenceUpdater::reset_matrices_from_grade_lists(MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial)
+{
+    all_columns_dirty = true;
+
+    //rebuild the maps from column indexes to equivalence classes
+    lift_low.clear();
+    lift_high.clear();
+    for (unsigned row = 0; row < template_points_matrix.height(); row++) {
+        for (TemplatePointsMatrixEntry* cur = template_points_matrix.get_row(row); cur != nullptr; cur = cur->left)
+            add_lift_entries(cur);
+    }
+
+    //within each equivalence class, multigrades occupy consecutive blocks of columns, starting with the rightmost block
+    perm_low.resize(R_low->width());
+    inv_perm_low.resize(R_low->width());
+    for (auto it = lift_low.begin(); it != lift_low.end(); ++it) {
+        int low_col = it->second->low_index;
+        for (Multigrade* cur_grade : it->second->low_simplices) {
+            for (unsigned i = 0; i < cur_grade->num_cols; i++) {
+                perm_low[cur_grade->simplex_index - i] = low_col;
+                low_col--;
+            }
+        }
+    }
+
+    perm_high.resize(R_high->width());
+    inv_perm_high.resize(R_high->width());
+    for (auto it = lift_high.begin(); it != lift_high.end(); ++it) {
+        int high_col = it->second->high_index;
+        for (Multigrade* cur_grade : it->second->high_simplices) {
+            for (unsigned i = 0; i < cur_grade->num_cols; i++) {
+                perm_high[cur_grade->simplex_index - i] = high_col;
+                high_col--;
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < perm_low.size(); i++)
+        inv_perm_low[perm_low[i]] = i;
+    for (unsigned i = 0; i < perm_high.size(); i++)
+        inv_perm_high[perm_high[i]] = i;
+
+    //re-build the matrix R based on the new order, and compute the new RU-decomposition
+    R_low->rebuild(RL_initial, perm_low);
+    R_high->rebuild(RH_initial, perm_high, perm_low);
+
+    U_low = R_low->decompose_RU();
+    U_high = R_high->decompose_RU();
+} //end reset_matrices_from_grade_lists()
+
 //swaps two blocks of simplices in the total order, and returns the number of transpositions that would be performed on the matrix columns if we were doing vineyard updates
 void PersistenceUpdater::count_switches_and_separations(TemplatePointsMatrixEntry* at_anchor, bool from_below, unsigned long& switches, unsigned long& seps)
 {
@@ -1366,13 +1684,17 @@ void PersistenceUpdater::remove_lift_entries(TemplatePointsMatrixEntry* entry)
 
     //low simplices
     std::map<unsigned, TemplatePointsMatrixEntry*>::iterator it1 = lift_low.find(entry->low_index);
-    if (it1 != lift_low.end() && it1->second == entry)
+    if (it1 != lift_low.end() && it1->second == entry) {
+        mark_lift_range(lift_low, it1, true);
         lift_low.erase(it1);
+    }
 
     //high simplices
     std::map<unsigned, TemplatePointsMatrixEntry*>::iterator it2 = lift_high.find(entry->high_index);
-    if (it2 != lift_high.end() && it2->second == entry)
+    if (it2 != lift_high.end() && it2->second == entry) {
+        mark_lift_range(lift_high, it2, false);
         lift_high.erase(it2);
+    }
 
 } //end remove_lift_entries()
 
@@ -1384,16 +1706,97 @@ void PersistenceUpdater::add_lift_entries(TemplatePointsMatrixEntry* entry)
     }
 
     //low simplices
-    if (entry->low_count > 0)
-        lift_low.insert(std::pair<unsigned, TemplatePointsMatrixEntry*>(entry->low_index, entry));
+    if (entry->low_count > 0) {
+        auto ins = lift_low.insert(std::pair<unsigned, TemplatePointsMatrixEntry*>(entry->low_index, entry));
+        if (ins.second)
+            mark_lift_range(lift_low, ins.first, true);
+    }
 
     //high simplices
-    if (entry->high_count > 0)
-        lift_high.insert(std::pair<unsigned, TemplatePointsMatrixEntry*>(entry->high_index, entry));
+    if (entry->high_count > 0) {
+        auto ins = lift_high.insert(std::pair<unsigned, TemplatePointsMatrixEntry*>(entry->high_index, entry));
+        if (ins.second)
+            mark_lift_range(lift_high, ins.first, false);
+    }
 } //end add_lift_entries()
 
+//marks a "low" column, whose bar must be re-examined before the next template is stored
+void PersistenceUpdater::mark_low_column(unsigned c)
+{
+    if (all_columns_dirty || column_is_dirty[c])
+        return;
+
+    column_is_dirty[c] = true;
+    dirty_columns.push_back(c);
+}
+
+//marks the "low" column paired with "high" column j, if any
+void PersistenceUpdater::mark_high_column(unsigned j)
+{
+    if (all_columns_dirty)
+        return;
+
+    int c = R_high->low(j);
+    if (c != -1)
+        mark_low_column(c);
+}
+
+//marks the columns that lift to the class whose rightmost column is it->first
+//  these are the columns after the previous entry of the map, up to and including column it->first
+void PersistenceUpdater::mark_lift_range(const std::map<unsigned, TemplatePointsMatrixEntry*>& lift, std::map<unsigned, TemplatePointsMatrixEntry*>::const_iterator it, bool low)
+{
+    if (all_columns_dirty)
+        return;
+
+    unsigned first = (it == lift.begin()) ? 0 : std::prev(it)->first + 1;
+    for (unsigned j = first; j <= it->first; j++) {
+        if (low)
+            mark_low_column(j);
+        else
+            mark_high_column(j);
+    }
+}
+
+//recomputes the bar contributed by "low" column c, and updates current_bars
+void PersistenceUpdater::update_column_bar(unsigned c)
+{
+    std::pair<unsigned, unsigned> bar = NO_BAR;
+
+    if (R_low->col_is_empty(c)) //then simplex corresponding to column c is positive
+    {
+        //find index of template point corresponding to simplex c
+        std::map<unsigned, TemplatePointsMatrixEntry*>::iterator tp1 = lift_low.lower_bound(c);
+        unsigned a = (tp1 != lift_low.end()) ? tp1->second->index : -1; //index is -1 iff the simplex maps to infinity
+
+        //is simplex s paired?
+        int s = R_high->find_low(c);
+        if (s != -1) //then simplex c is paired with negative simplex s
+        {
+            //find index of xi support point corresponding to simplex s
+            std::map<unsigned, TemplatePointsMatrixEntry*>::iterator tp2 = lift_high.lower_bound(s);
+            unsigned b = (tp2 != lift_high.end()) ? tp2->second->index : -1; //index is -1 iff the simplex maps to infinity
+
+            if (a != b) //then we have a bar of positive length
+                bar = std::make_pair(a, b);
+        } else //then simplex c generates an essential cycle
+            bar = std::make_pair(a, (unsigned)-1); //b = -1 = MAX_UNSIGNED indicates this is an essential cycle
+    }
+
+    if (bar == column_bars[c])
+        return;
+
+    if (column_bars[c] != NO_BAR) {
+        auto it = current_bars.find(column_bars[c]);
+        if (--(it->second) == 0)
+            current_bars.erase(it);
+    }
+    if (bar != NO_BAR)
+        current_bars[bar]++;
+    column_bars[c] = bar;
+} //end update_column_bar()
+
 //stores a barcode template in a 2-cell of the arrangement
-///TODO: IMPROVE THIS!!! (store previous barcode at the simplicial level, and only examine columns that were modified in the recent update)
+//  only the "low" columns marked since the last template was stored are re-examined, so the cost is proportional to the change in the barcode
 /// Is there a better way to handle endpoints at infinity?
 void PersistenceUpdater::store_barcode_template(Face* cell)
 {
@@ -1405,41 +1808,39 @@ void PersistenceUpdater::store_barcode_template(Face* cell)
     //mark this cell as visited
     cell->mark_as_visited();
 
-    //get a reference to the barcode template object
-    BarcodeTemplate& dbc = cell->get_barcode();
+    //bring the bars up to date
+    if (all_columns_dirty) //then examine all columns in matrix R_low
+    {
+        column_bars.assign(R_low->width(), NO_BAR);
+        current_bars.clear();
+        dirty_columns.clear();
+        column_is_dirty.assign(R_low->width(), false);
 
-    //loop over all zero-columns in matrix R_low
-    for (unsigned c = 0; c < R_low->width(); c++) {
-        if (R_low->col_is_empty(c)) //then simplex corresponding to column c is positive
-        {
-            //find index of template point corresponding to simplex c
-            std::map<unsigned, TemplatePointsMatrixEntry*>::iterator tp1 = lift_low.lower_bound(c);
-            unsigned a = (tp1 != lift_low.end()) ? tp1->second->index : -1; //index is -1 iff the simplex maps to infinity
+        for (unsigned c = 0; c < R_low->width(); c++)
+            update_column_bar(c);
 
-            //is simplex s paired?
-            int s = R_high->find_low(c);
-            if (s != -1) //then simplex c is paired with negative simplex s
-            {
-                //find index of xi support point corresponding to simplex s
-                std::map<unsigned, TemplatePointsMatrixEntry*>::iterator tp2 = lift_high.lower_bound(s);
-                unsigned b = (tp2 != lift_high.end()) ? tp2->second->index : -1; //index is -1 iff the simplex maps to infinity
+        all_columns_dirty = false;
+    } else //examine only the marked columns
+    {
+        for (unsigned c : dirty_columns) {
+            column_is_dirty[c] = false;
+            update_column_bar(c);
+        }
+        dirty_columns.clear();
+    }
 
-                if (a != b) //then we have a bar of positive length
-                {
-                    dbc.add_bar(a, b);
-                    if (verbosity >= 6) {
-                        qd << "(" << c << "," << s << ")-->(" << a << "," << b << ") ";
-                    }
-                }
-            } else //then simplex c generates an essential cycle
-            {
-                dbc.add_bar(a, -1); //b = -1 = MAX_UNSIGNED indicates this is an essential cycle
-                if (verbosity >= 6) {
-                    qd << c << "-->" << a << " ";
-                }
-            }
+    //build the barcode template, which is then stored in the arrangement's pool of distinct templates
+    //  current_bars is ordered by endpoints, so the bars are added in sorted order
+    BarcodeTemplate dbc;
+    for (auto it = current_bars.begin(); it != current_bars.end(); ++it) {
+        dbc.add_bar(it->first.first, it->first.second, it->second);
+        if (verbosity >= 6) {
+            qd << "(" << it->first.first << "," << it->first.second << ")x" << it->second << " ";
         }
     }
+    dbc.finalize();
+    arrangement.set_barcode_template(cell, dbc);
+
     if (verbosity >= 6) {
         qd << "\n ";
     }
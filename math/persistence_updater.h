@@ -55,6 +55,7 @@ public:
 
     //functions to compute and store barcode templates in each 2-cell of the arrangement
     void store_barcodes_with_reset(std::vector<Halfedge*>& path, Progress& progress); //hybrid approach -- for expensive crossings, resets the matrices and does a standard persistence calculation
+    //  if more than one OpenMP thread is available, the path is split into segments which are traversed concurrently
     void store_barcodes_quicksort(std::vector<Halfedge*>& path); ///TODO -- for expensive crossings, rearranges columns via quicksort and fixes the RU-decomposition globally
 
     //function to set the "edge weights" for each anchor line
@@ -64,6 +65,23 @@ public:
     void clear_levelsets();
 
 private:
+    //constructor for a worker that traverses one segment of the path, concurrently with other workers
+    //  the worker shares the arrangement and the FIRep with its parent, but has its own copy of the TemplatePointsMatrix
+    PersistenceUpdater(Arrangement& m, FIRep& b, const TemplatePointsMatrix& tpm, unsigned verbosity);
+
+    //minimum average number of steps in each segment of the path, when the path is split into segments for parallel traversal
+    static const unsigned MIN_SEGMENT_LENGTH = 32;
+
+    //statistics used to decide, at each step of the path, whether to do vineyard updates or to reset the matrices
+    struct TraversalStats {
+        unsigned long total_transpositions;
+        unsigned total_time_for_transpositions;
+        unsigned total_time_for_resets;
+        unsigned number_of_resets;
+        int max_time;
+        unsigned long threshold; //if the number of transpositions might exceed this threshold, then we reset the matrices
+    };
+
     //data structures
 
     Arrangement& arrangement; //pointer to the DCEL arrangement in which the barcodes will be stored
@@ -87,6 +105,16 @@ private:
     std::vector<unsigned> perm_high; //map from column index at initial cell to column index at current cell
     std::vector<unsigned> inv_perm_high; //inverse of the previous map
 
+    //the current barcode at the simplicial level, maintained so that each barcode template is built by re-examining only the "low" columns that changed since the last template was stored
+    //  the bar of a "low" column depends only on whether the column is zero, on its pair in R_high, and on the lift map; these change only in vineyard updates, lift map updates, and resets
+    std::vector<std::pair<unsigned, unsigned>> column_bars; //bar (a,b) contributed by each "low" column when the last template was stored, or NO_BAR
+    std::map<std::pair<unsigned, unsigned>, unsigned> current_bars; //multiplicity of each bar in column_bars
+    std::vector<unsigned> dirty_columns; //"low" columns whose bars must be re-examined before the next template is stored
+    std::vector<bool> column_is_dirty; //column_is_dirty[c] is true iff c is in dirty_columns
+    bool all_columns_dirty; //true iff the matrices have been reset since the last template was stored, so that every column must be re-examined
+
+    static const std::pair<unsigned, unsigned> NO_BAR; //a finite bar never has equal endpoints, and an essential bar never ends at 0
+
     ///TESTING ONLY
     //bool testing;
     //MapMatrix_Perm* D_low;
@@ -138,12 +166,37 @@ private:
     void vineyard_update_low(unsigned a);
     void vineyard_update_high(unsigned a);
 
+    //moves grades associated with TemplatePointsMatrixEntry first to their new positions after or among the grades associated with TemplatePointsMatrixEntry second,
+    //  updating only the lift map (and not the matrices or permutation vectors); used to replay the path up to the start of a segment
+    void move_grade_lists(TemplatePointsMatrixEntry* first, TemplatePointsMatrixEntry* second, bool from_below);
+
     //swaps two blocks of columns by updating the total order on columns, then rebuilding the matrices and computing a new RU-decomposition
     void update_order_and_reset_matrices(TemplatePointsMatrixEntry* first, TemplatePointsMatrixEntry* second, bool from_below, MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial);
 
     //updates the total order on columns, rebuilds the matrices, and computes a new RU-decomposition for a NON-STRICT anchor
     void update_order_and_reset_matrices(MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial);
 
+    //rebuilds the lift entries and permutation vectors from the grade lists, then rebuilds the matrices and computes a new RU-decomposition
+    //  precondition: the simplex_index of each multigrade is the position of its rightmost column at the initial cell
+    void reset_matrices_from_grade_lists(MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial);
+
+    //records the direction in which the anchor is crossed at each step of the path (and toggles the anchors accordingly),
+    //  and marks the steps at which a cell is visited for the first time
+    void prepare_path(std::vector<Halfedge*>& path, Face* first_cell, std::vector<bool>& from_below, std::vector<bool>& store_template);
+
+    //splits the path into at most num_segments segments of roughly equal cost, estimated from the anchor weights
+    //  segment k consists of steps bounds[k] to (bounds[k+1] - 1)
+    void split_path(std::vector<Halfedge*>& path, unsigned num_segments, std::vector<unsigned>& bounds);
+
+    //traverses steps begin to (end - 1) of the path, updating persistence at each step and storing barcode templates in the cells marked by store_template
+    //  progress may be NULL, in which case no progress is reported
+    void traverse_path(std::vector<Halfedge*>& path, unsigned begin, unsigned end, const std::vector<bool>& from_below, const std::vector<bool>& store_template,
+        MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial, TraversalStats& stats, Progress* progress);
+
+    //called on a worker: moves the lift map to the cell at the start of step begin (without vineyard updates), resets the matrices there, and then traverses steps begin to (end - 1) of the path
+    void traverse_segment(std::vector<Halfedge*>& path, unsigned begin, unsigned end, const std::vector<bool>& from_below, const std::vector<bool>& store_template,
+        MapMatrix_Perm* RL_initial, MapMatrix_Perm* RH_initial, TraversalStats& stats);
+
     //swaps two blocks of simplices in the total order, and counts switches and separations
     void count_switches_and_separations(TemplatePointsMatrixEntry* at_anchor, bool from_below, unsigned long& switches, unsigned long& seps);
 
@@ -156,8 +209,20 @@ private:
     //creates the appropriate entries in lift_low and lift_high for an TemplatePointsMatrixEntry with nonempty sets of "low" or "high" simplices
     void add_lift_entries(TemplatePointsMatrixEntry* entry);
 
+    //marks a "low" column, whose bar must be re-examined before the next template is stored
+    void mark_low_column(unsigned c);
+
+    //marks the "low" column paired with "high" column j, if any
+    void mark_high_column(unsigned j);
+
+    //marks the columns that lift to the class whose rightmost column is it->first, i.e. the columns whose lift changes if this entry is added to or removed from the map
+    void mark_lift_range(const std::map<unsigned, TemplatePointsMatrixEntry*>& lift, std::map<unsigned, TemplatePointsMatrixEntry*>::const_iterator it, bool low);
+
+    //recomputes the bar contributed by "low" column c, and updates current_bars
+    void update_column_bar(unsigned c);
+
     //stores a barcode template in a 2-cell of the arrangement
-    ///TODO: IMPROVE THIS -- track most recent barcode at the simplicial level and re-examine only the necessary columns!!!
+    //  only the "low" columns marked since the last template was stored are re-examined
     void store_barcode_template(Face* cell);
 
     //chooses an initial threshold by timing vineyard updates corresponding to random transpositions
@@ -0,0 +1,93 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+
+#include "quantile_sketch.h"
+
+#include <algorithm>
+#include <utility>
+
+QuantileSketch::QuantileSketch(std::size_t capacity)
+    : capacity(std::max<std::size_t>(capacity, 2))
+    , count(0)
+    , levels(1)
+    , keep_odd(1, false)
+{
+}
+
+void QuantileSketch::add(double value)
+{
+    levels[0].push_back(value);
+    count++;
+    if (levels[0].size() >= capacity)
+        compact(0);
+}
+
+void QuantileSketch::compact(std::size_t h)
+{
+    if (h + 1 == levels.size()) {
+        levels.emplace_back();
+        keep_odd.push_back(false);
+    }
+
+    //an odd value out stays at this level, so that the total weight is unchanged
+    std::vector<double>& level = levels[h];
+    std::sort(level.begin(), level.end());
+    double left_over = level.back();
+    bool odd_size = level.size() % 2 == 1;
+    if (odd_size)
+        level.pop_back();
+
+    std::vector<double>& above = levels[h + 1];
+    for (std::size_t k = keep_odd[h] ? 1 : 0; k < level.size(); k += 2)
+        above.push_back(level[k]);
+    keep_odd[h] = !keep_odd[h];
+
+    level.clear();
+    if (odd_size)
+        level.push_back(left_over);
+
+    if (above.size() >= capacity)
+        compact(h + 1);
+}
+
+std::vector<double> QuantileSketch::quantiles(unsigned num_parts) const
+{
+    //sort the values of all levels, each with its weight
+    std::vector<std::pair<double, std::size_t>> weighted;
+    for (std::size_t h = 0; h < levels.size(); h++)
+        for (double value : levels[h])
+            weighted.emplace_back(value, (std::size_t)1 << h);
+    std::sort(weighted.begin(), weighted.end());
+
+    //the value at position p is the first whose cumulative weight exceeds p
+    std::vector<double> result;
+    result.reserve(num_parts);
+    std::size_t cumulative = 0;
+    std::size_t k = 0;
+    for (unsigned c = 1; c <= num_parts; c++) {
+        std::size_t position = (c * count + num_parts - 1) / num_parts - 1;
+        while (k + 1 < weighted.size() && cumulative + weighted[k].second <= position) {
+            cumulative += weighted[k].second;
+            k++;
+        }
+        result.push_back(weighted[k].first);
+    }
+    return result;
+}
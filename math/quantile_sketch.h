@@ -0,0 +1,58 @@
+/**********************************************************************
+Copyright 2014-2016 The RIVET Developers. See the COPYRIGHT file at
+the top-level directory of this distribution.
+
+This file is part of RIVET.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**********************************************************************/
+/**
+ * \class	QuantileSketch
+ * \brief	Summarizes a stream of floating-point values in a small amount of memory, so that their quantiles can be estimated.
+ *
+ * The values are kept in levels of at most capacity values each, where a value at level h stands for 2^h values of the stream.
+ * When a level is full, it is sorted, and every other value is moved up one level; the levels alternate between keeping the
+ * values at even and odd positions, so that the errors tend to cancel. The estimated position of a value among the values
+ * added is off by at most about size() * log2(size() / capacity) / capacity, and is exact if at most capacity values are added.
+ * The sketch is deterministic: the same values added in the same order give the same quantiles.
+ */
+
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <cstddef>
+#include <vector>
+
+class QuantileSketch {
+public:
+    explicit QuantileSketch(std::size_t capacity = 4096);
+
+    void add(double value);
+
+    std::size_t size() const { return count; } //the number of values added
+
+    //returns, for c = 1, ..., num_parts, an estimate of the value at position ceil(c * size() / num_parts) - 1 among the values
+    //  added, in increasing order; each estimate is one of the values added; precondition: size() > 0
+    std::vector<double> quantiles(unsigned num_parts) const;
+
+private:
+    std::size_t capacity;
+    std::size_t count;
+    std::vector<std::vector<double>> levels;
+    std::vector<bool> keep_odd; //keep_odd[h] says which values of level h are moved up at its next compaction
+
+    void compact(std::size_t h); //moves half of the values of level h to level h + 1
+};
+
+#endif // QUANTILE_SKETCH_H
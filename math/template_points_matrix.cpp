@@ -128,6 +128,37 @@ TemplatePointsMatrix::TemplatePointsMatrix(unsigned width, unsigned height)
 {
 }
 
+//copies the entries (support points and anchors) of other, but not their grade lists
+//  the copy has the same structure as other, so that corresponding entries have the same indexes
+TemplatePointsMatrix::TemplatePointsMatrix(const TemplatePointsMatrix& other)
+    : columns(other.columns.size())
+    , rows(other.rows.size())
+{
+    //insert entries in lexicographical order, so that the down and left pointers are set as in other
+    for (unsigned i = 0; i < columns.size(); i++) {
+        std::vector<TemplatePointsMatrixEntry*> column; //entries in column i, from top to bottom
+        for (TemplatePointsMatrixEntry* cur = other.columns[i]; cur != NULL; cur = cur->down)
+            column.push_back(cur);
+
+        for (auto it = column.rbegin(); it != column.rend(); ++it)
+            insert_entry((*it)->x, (*it)->y, (*it)->index);
+    }
+}
+
+//destructor: deletes all entries and the multigrades in their grade lists
+TemplatePointsMatrix::~TemplatePointsMatrix()
+{
+    for (TemplatePointsMatrixEntry* entry : entries) {
+        if (entry == NULL)
+            continue;
+        for (Multigrade* mg : entry->low_simplices)
+            delete mg;
+        for (Multigrade* mg : entry->high_simplices)
+            delete mg;
+        delete entry;
+    }
+}
+
 //stores the supplied xi support points in the TemplatePointsMatrix
 //  also finds anchors, which are stored in the matrix and in the vector xi_pts
 //  precondition: xi_pts contains the support points in lexicographical order
@@ -168,9 +199,7 @@ std::vector<TemplatePointsMatrixEntry*> TemplatePointsMatrix::fill_and_find_anch
             }
 
             //create a new TemplatePointsMatrixEntry
-            TemplatePointsMatrixEntry* new_entry(new TemplatePointsMatrixEntry(i, j, insertion_point, columns[i], rows[j]));
-            columns[i] = new_entry;
-            rows[j] = new_entry;
+            TemplatePointsMatrixEntry* new_entry = insert_entry(i, j, insertion_point);
 
             if (anchor) {
                 matrix_entries.push_back(new_entry);
@@ -180,6 +209,27 @@ std::vector<TemplatePointsMatrixEntry*> TemplatePointsMatrix::fill_and_find_anch
     return matrix_entries;
 } //end fill_and_find_anchors()
 
+//creates a new entry with index i at position (x,y), and links it into the matrix
+//  precondition: entries are inserted in lexicographical order, so that the new entry is the top entry in its column and the rightmost entry in its row
+TemplatePointsMatrixEntry* TemplatePointsMatrix::insert_entry(unsigned x, unsigned y, unsigned i)
+{
+    TemplatePointsMatrixEntry* new_entry(new TemplatePointsMatrixEntry(x, y, i, columns[x], rows[y]));
+    columns[x] = new_entry;
+    rows[y] = new_entry;
+
+    if (entries.size() <= i)
+        entries.resize(i + 1, NULL);
+    entries[i] = new_entry;
+
+    return new_entry;
+}
+
+//gets a pointer to the entry with the given index; returns NULL if there is no such entry
+TemplatePointsMatrixEntry* TemplatePointsMatrix::get_entry(unsigned i)
+{
+    return (i < entries.size()) ? entries[i] : NULL;
+}
+
 //gets a pointer to the rightmost entry in row r; returns NULL if row r is empty
 TemplatePointsMatrixEntry* TemplatePointsMatrix::get_row(unsigned r)
 {
@@ -81,6 +81,8 @@ struct Multigrade {
 class TemplatePointsMatrix {
 public:
     TemplatePointsMatrix(unsigned width, unsigned height); //constructor
+    TemplatePointsMatrix(const TemplatePointsMatrix& other); //copies the entries (support points and anchors) of other, but not their grade lists
+    ~TemplatePointsMatrix(); //destructor: deletes all entries and the multigrades in their grade lists
 
     std::vector<TemplatePointsMatrixEntry*> fill_and_find_anchors(std::vector<TemplatePoint>& xi_pts); //stores xi support points in the xiSupportMatrix
     //also finds anchors, which are stored both in the matrix and in the vector xi_pts
@@ -89,6 +91,8 @@ public:
     TemplatePointsMatrixEntry* get_row(unsigned r); //gets a pointer to the rightmost entry in row r; returns NULL if row r is empty
     TemplatePointsMatrixEntry* get_col(unsigned c); //gets a pointer to the top entry in column c; returns NULL if column c is empty
 
+    TemplatePointsMatrixEntry* get_entry(unsigned i); //gets a pointer to the entry with the given index; returns NULL if there is no such entry
+
     unsigned height(); //retuns the number of rows;
 
     void clear_grade_lists(); //clears the level set lists for all entries in the matrix
@@ -96,6 +100,11 @@ public:
 private:
     std::vector<TemplatePointsMatrixEntry*> columns;
     std::vector<TemplatePointsMatrixEntry*> rows;
+    std::vector<TemplatePointsMatrixEntry*> entries; //all entries, ordered by index
+
+    TemplatePointsMatrix& operator=(const TemplatePointsMatrix&) = delete;
+
+    TemplatePointsMatrixEntry* insert_entry(unsigned x, unsigned y, unsigned i); //creates a new entry with index i at position (x,y); entries must be inserted in lexicographical order
 };
 
 #endif // TEMPLATE_POINT_MATRIX_H
@@ -23,14 +23,202 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "numerics.h"
 
+#include <climits>
+
 namespace rivet {
 
 namespace numeric {
-    std::vector<double> to_doubles(const std::vector<exact> exacts)
+    namespace {
+        //integers of absolute value at most 2^53 are exactly representable as doubles
+        const long long MAX_EXACT_DOUBLE = 1LL << 53;
+
+        //powers of ten that fit in a long long
+        const long long POWERS_OF_TEN[] = { 1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+            100000000LL, 1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+            100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL, 1000000000000000000LL };
+        const int MAX_POWER_OF_TEN = 18;
+
+#ifdef __SIZEOF_INT128__
+        //wide enough for the product of two long longs; __extension__ marks the non-standard type as intended under -pedantic
+        __extension__ typedef __int128 int128;
+#endif
+
+        long long gcd(long long a, long long b) //for nonnegative a and b
+        {
+            while (b != 0) {
+                long long t = a % b;
+                a = b;
+                b = t;
+            }
+            return a;
+        }
+    }
+
+    SmallRational::SmallRational(long long numerator, long long denominator)
+    {
+        //negating LLONG_MIN overflows, so reduce such values exactly
+        if (numerator == LLONG_MIN || denominator == LLONG_MIN) {
+            *this = SmallRational(exact(numerator, denominator));
+            return;
+        }
+        if (denominator < 0) {
+            numerator = -numerator;
+            denominator = -denominator;
+        }
+        long long g = gcd(numerator < 0 ? -numerator : numerator, denominator);
+        num = numerator / g;
+        den = denominator / g;
+    }
+
+    SmallRational::SmallRational(const exact& value)
+        : num(0)
+        , den(1)
+    {
+        const boost::multiprecision::cpp_int& n = numerator(value);
+        const boost::multiprecision::cpp_int& d = denominator(value);
+        if (n > LLONG_MIN && n <= LLONG_MAX && d <= LLONG_MAX) {
+            num = n.convert_to<long long>();
+            den = d.convert_to<long long>();
+        } else {
+            big = std::make_shared<const exact>(value);
+        }
+    }
+
+    bool SmallRational::parse(const char* first, const char* last, SmallRational& result)
+    {
+        const char* it = first;
+        bool neg = false;
+        if (it != last && *it == '-') {
+            neg = true;
+            ++it;
+        }
+
+        //read the digits of the base, ignoring the decimal point
+        const char* digits_first = it;
+        long long n = 0;
+        int num_digits = 0;
+        int frac_digits = 0;
+        bool point = false;
+        for (; it != last && *it != 'e'; ++it) {
+            if (*it == '.' && !point) {
+                point = true;
+            } else if (*it >= '0' && *it <= '9') {
+                if (n > (LLONG_MAX - 9) / 10)
+                    return false;
+                n = 10 * n + (*it - '0');
+                num_digits++;
+                if (point)
+                    frac_digits++;
+            } else {
+                return false;
+            }
+        }
+        if (num_digits == 0)
+            return false;
+
+        //str_to_exact() reads a negative integer with leading zeros as an octal number, so leave that case to it
+        if (neg && !point && *digits_first == '0' && num_digits > 1)
+            return false;
+
+        //read the exponent, if any
+        int exponent = 0;
+        if (it != last) {
+            ++it; //skip 'e'
+            bool neg_exp = false;
+            if (it != last && (*it == '-' || *it == '+')) {
+                neg_exp = (*it == '-');
+                ++it;
+            }
+            for (; it != last; ++it) {
+                if (*it < '0' || *it > '9' || exponent > 2 * MAX_POWER_OF_TEN)
+                    return false;
+                exponent = 10 * exponent + (*it - '0');
+            }
+            if (neg_exp)
+                exponent = -exponent;
+        }
+
+        //the value is n * 10^(exponent - frac_digits)
+        long long d = 1;
+        int power = exponent - frac_digits;
+        if (power < 0) {
+            if (-power > MAX_POWER_OF_TEN)
+                return false;
+            d = POWERS_OF_TEN[-power];
+        } else if (power > 0) {
+            if (power > MAX_POWER_OF_TEN || (n != 0 && n > LLONG_MAX / POWERS_OF_TEN[power]))
+                return false;
+            n *= POWERS_OF_TEN[power];
+        }
+
+        result = SmallRational(neg ? -n : n, d);
+        return true;
+    } //end parse()
+
+    exact SmallRational::to_exact() const
+    {
+        if (big)
+            return *big;
+        return exact(num, den);
+    }
+
+    double SmallRational::to_double() const
+    {
+        if (!big && num >= -MAX_EXACT_DOUBLE && num <= MAX_EXACT_DOUBLE && den <= MAX_EXACT_DOUBLE)
+            return static_cast<double>(num) / static_cast<double>(den);
+        return rivet::numeric::to_double(to_exact());
+    }
+
+    SmallRational SmallRational::operator-() const
+    {
+        if (big || num == LLONG_MIN)
+            return SmallRational(exact(-to_exact()));
+        SmallRational result;
+        result.num = -num;
+        result.den = den;
+        return result;
+    }
+
+    int SmallRational::compare(const SmallRational& other) const
+    {
+        if (!big && !other.big) {
+            if (den == other.den)
+                return num < other.num ? -1 : (num > other.num ? 1 : 0);
+#ifdef __SIZEOF_INT128__
+            int128 left = static_cast<int128>(num) * other.den;
+            int128 right = static_cast<int128>(other.num) * den;
+            return left < right ? -1 : (left > right ? 1 : 0);
+#endif
+        }
+        exact a = to_exact();
+        exact b = other.to_exact();
+        return a < b ? -1 : (a > b ? 1 : 0);
+    }
+
+    //both forms are kept reduced, and a value is stored exactly only if it does not fit in 64 bits, so equal values have equal representations
+    bool SmallRational::equals(const SmallRational& other) const
+    {
+        if (!big && !other.big)
+            return num == other.num && den == other.den;
+        if (big && other.big)
+            return *big == *other.big;
+        return false;
+    }
+
+    double to_double(const exact& value)
+    {
+        const boost::multiprecision::cpp_int& n = numerator(value);
+        const boost::multiprecision::cpp_int& d = denominator(value);
+        if (n >= -MAX_EXACT_DOUBLE && n <= MAX_EXACT_DOUBLE && d <= MAX_EXACT_DOUBLE)
+            return static_cast<double>(n.convert_to<long long>()) / static_cast<double>(d.convert_to<long long>());
+        return n.convert_to<double>() / d.convert_to<double>();
+    }
+
+    std::vector<double> to_doubles(const std::vector<exact>& exacts)
     {
         std::vector<double> doubles(exacts.size());
-        std::transform(exacts.begin(), exacts.end(), doubles.begin(), [](exact num) {
-            return numerator(num).convert_to<double>() / denominator(num).convert_to<double>();
+        std::transform(exacts.begin(), exacts.end(), doubles.begin(), [](const exact& num) {
+            return to_double(num);
         });
         return doubles;
     }
@@ -49,6 +237,11 @@ namespace numeric {
     //accepts string such as "12.34", "765", "-10.8421", "23.8e5", "60.31e-04"
     exact str_to_exact(const std::string& str)
     {
+        //most input values are short decimals, which can be read without multiprecision arithmetic
+        SmallRational small;
+        if (SmallRational::parse(str.data(), str.data() + str.size(), small))
+            return small.to_exact();
+
         exact r; //this will hold the result
 
         //first look for "e", indicating scientific notation
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <boost/algorithm/string.hpp>
 #include <boost/multi_array.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
+#include <memory>
 #include <string>
 
 typedef boost::multiprecision::cpp_rational exact;
@@ -35,9 +36,58 @@ typedef boost::multi_array<unsigned, 2> unsigned_matrix;
 
 namespace rivet {
 namespace numeric {
+    //a rational number stored as a reduced 64-bit numerator and positive 64-bit denominator;
+    //  values that do not fit in 64 bits are stored as an exact value instead, so results never depend on which form is used
+    class SmallRational {
+    public:
+        SmallRational()
+            : num(0)
+            , den(1)
+        {
+        }
+
+        SmallRational(long long value)
+            : num(value)
+            , den(1)
+        {
+        }
+
+        SmallRational(long long numerator, long long denominator); //denominator must be nonzero
+
+        explicit SmallRational(const exact& value);
+
+        //parses a decimal string such as "12.34", "-765", or "60.31e-04" without multiprecision arithmetic;
+        //  returns false (leaving result unchanged) if the string is not of this form or the value does not fit in 64 bits,
+        //  in which case str_to_exact() should be used
+        static bool parse(const char* first, const char* last, SmallRational& result);
+
+        bool is_small() const { return !big; }
+        exact to_exact() const;
+        double to_double() const; //same result as converting to_exact() numerator and denominator to double and dividing
+
+        SmallRational operator-() const;
+
+        int compare(const SmallRational& other) const; //returns -1, 0, or 1
+
+        friend bool operator==(const SmallRational& a, const SmallRational& b) { return a.equals(b); }
+        friend bool operator!=(const SmallRational& a, const SmallRational& b) { return !a.equals(b); }
+        friend bool operator<(const SmallRational& a, const SmallRational& b) { return a.compare(b) < 0; }
+        friend bool operator<=(const SmallRational& a, const SmallRational& b) { return a.compare(b) <= 0; }
+        friend bool operator>(const SmallRational& a, const SmallRational& b) { return a.compare(b) > 0; }
+        friend bool operator>=(const SmallRational& a, const SmallRational& b) { return a.compare(b) >= 0; }
+
+    private:
+        long long num;
+        long long den;
+        std::shared_ptr<const exact> big; //if not null, the value is *big and num and den are unused
+
+        bool equals(const SmallRational& other) const;
+    };
+
     exact str_to_exact(const std::string& str);
     bool is_number(const std::string& str);
-    std::vector<double> to_doubles(const std::vector<exact> exacts);
+    double to_double(const exact& value);
+    std::vector<double> to_doubles(const std::vector<exact>& exacts);
     double project_to_line(double angle, double offset, double x_0, double y_0);
     const double INFTY(std::numeric_limits<double>::infinity());
     const double PI(3.14159265358979323846);
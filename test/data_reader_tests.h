@@ -8,8 +8,20 @@
 #endif //RIVET_CONSOLE_INPUT_MANAGER_TESTS_H
 
 #include "catch.hpp"
+#include "interface/binary_array.h"
 #include "interface/data_reader.h"
+#include "interface/file_input_reader.h"
+#include "interface/file_tokenizer.h"
+#include "math/bifiltration_data.h"
+#include "math/grade_discretizer.h"
+#include "math/greedy_permutation.h"
+#include "math/neighbor_graph.h"
+#include "math/quantile_sketch.h"
 #include "numerics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <vector>
 
@@ -22,3 +34,372 @@ TEST_CASE("DataPoint parses correctly", "[InputManager]")
     REQUIRE(point.coords[1] == -1.2);
     REQUIRE(point.birth == exact(112, 100));
 }
+
+TEST_CASE("FileTokenizer splits lines as FileInputReader does", "[InputManager]")
+{
+    const char* file_name = "file_tokenizer_test.txt";
+    {
+        std::ofstream out(file_name);
+        out << "# comment\n\n  1.5 2\t3  \r\n1, 2,,3\n--flag, x\n,4\n5,\n-1,2\n   \n;1 2 ; 3\nlast line";
+    }
+
+    std::ifstream in(file_name);
+    FileInputReader expected(in);
+    FileTokenizer reader(file_name);
+    while (expected.has_next_line()) {
+        REQUIRE(reader.has_next_line());
+        auto line_info = expected.next_line(0);
+        auto& tokens = reader.next_line(0);
+        REQUIRE(reader.line_number() == line_info.second);
+        REQUIRE(tokens.size() == line_info.first.size());
+        for (size_t i = 0; i < tokens.size(); i++)
+            REQUIRE(tokens[i].str() == line_info.first[i]);
+    }
+    REQUIRE(!reader.has_next_line());
+    in.close();
+    std::remove(file_name);
+}
+
+TEST_CASE("FileTokenizer splits the rest of the file into parts", "[InputManager]")
+{
+    const char* file_name = "file_tokenizer_parts_test.txt";
+    {
+        std::ofstream out(file_name);
+        out << "--flag\n1, 2\n";
+        for (int i = 0; i < 50; i++)
+            out << ((i % 7 == 0) ? "\n# comment\n" : "") << i << " ; " << i + 1 << "\n";
+        out << "last, line";
+    }
+
+    for (unsigned num_parts : { 1u, 3u, 8u, 200u }) {
+        FileTokenizer expected(file_name);
+        FileTokenizer reader(file_name);
+        expected.next_line(0);
+        reader.next_line(0);
+        REQUIRE(reader.next_line().size() == 2);
+        expected.next_line();
+
+        std::vector<FileTokenizer::Lines> parts = reader.split_remaining(num_parts);
+        REQUIRE(parts.size() <= num_parts);
+        for (FileTokenizer::Lines& part : parts) {
+            while (part.next_line()) {
+                REQUIRE(expected.has_next_line());
+                auto& tokens = expected.next_line();
+                REQUIRE(part.line_number() == expected.line_number());
+                REQUIRE(part.tokens().size() == tokens.size());
+                for (size_t i = 0; i < tokens.size(); i++)
+                    REQUIRE(part.tokens()[i].str() == tokens[i].str());
+            }
+        }
+        REQUIRE(!expected.has_next_line());
+        REQUIRE(!reader.has_next_line());
+    }
+    std::remove(file_name);
+}
+
+TEST_CASE("FileTokenizer parses numbers", "[InputManager]")
+{
+    const char* text = "1.0 -1.2 1.12 42 x";
+    std::vector<FileTokenizer::Token> tokens{ { text, 3 }, { text + 4, 4 }, { text + 9, 4 }, { text + 14, 2 }, { text + 17, 1 } };
+    DataPoint point(tokens, 2, tokens[2].to_exact());
+
+    REQUIRE(point.coords[0] == 1.0);
+    REQUIRE(point.coords[1] == -1.2);
+    REQUIRE(point.birth == exact(112, 100));
+    REQUIRE(tokens[3].to_int() == 42);
+    REQUIRE(tokens[4].to_double() == 0);
+    REQUIRE_THROWS_AS(tokens[4].to_int(), std::invalid_argument);
+}
+
+TEST_CASE("BinaryArray reads raw and .npy files", "[InputManager]")
+{
+    const char* raw_name = "binary_array_test.bin";
+    const char* npy_name = "binary_array_test.npy";
+    const char* vector_name = "binary_array_test_vector.npy";
+    const double values[] = { 1.5, -2, 0.25, 3, 4, 1e-3 };
+    {
+        std::ofstream out(raw_name, std::ios::binary);
+        BinaryArray::write(out, BinaryArray::DISTANCES, 2, 3, values);
+    }
+    {
+        //a 3 x 2 array of big-endian float32 values, stored column by column
+        std::string header = "{'descr': '>f4', 'fortran_order': True, 'shape': (3, 2), }";
+        header.append(128 - 10 - header.size() - 1, ' '); //the data starts at an offset that is a multiple of 64
+        header += '\n';
+        std::ofstream out(npy_name, std::ios::binary);
+        out.write("\x93NUMPY\x01\x00", 8);
+        out.put(static_cast<char>(header.size()));
+        out.put(0);
+        out << header;
+        const unsigned char column_values[] = { 0x3f, 0x80, 0, 0, 0x40, 0, 0, 0, 0x40, 0x40, 0, 0, //1, 2, 3
+            0xc0, 0x80, 0, 0, 0xc0, 0xa0, 0, 0, 0xc0, 0xc0, 0, 0 }; //-4, -5, -6
+        out.write(reinterpret_cast<const char*>(column_values), sizeof(column_values));
+    }
+    {
+        //a one-dimensional array with a single little-endian float64 value, such as the distances between two points
+        std::string header = "{'descr': '<f8', 'fortran_order': False, 'shape': (1,), }";
+        header.append(128 - 10 - header.size() - 1, ' ');
+        header += '\n';
+        std::ofstream out(vector_name, std::ios::binary);
+        out.write("\x93NUMPY\x01\x00", 8);
+        out.put(static_cast<char>(header.size()));
+        out.put(0);
+        out << header;
+        out.write(reinterpret_cast<const char*>(values), sizeof(double));
+    }
+
+    REQUIRE(BinaryArray::is_binary_array(raw_name));
+    REQUIRE(BinaryArray::is_binary_array(npy_name));
+    {
+        BinaryArray raw(raw_name);
+        REQUIRE(raw.kind() == BinaryArray::DISTANCES);
+        REQUIRE(raw.rows() == 2);
+        REQUIRE(raw.cols() == 3);
+        REQUIRE(!raw.is_one_dimensional());
+        for (size_t i = 0; i < 6; i++)
+            REQUIRE(raw.data()[i] == values[i]);
+
+        BinaryArray npy(npy_name);
+        REQUIRE(npy.kind() == BinaryArray::UNKNOWN);
+        REQUIRE(npy.rows() == 3);
+        REQUIRE(npy.cols() == 2);
+        REQUIRE(!npy.is_one_dimensional());
+        const double expected[] = { 1, -4, 2, -5, 3, -6 };
+        for (size_t i = 0; i < 6; i++)
+            REQUIRE(npy.data()[i] == expected[i]);
+
+        BinaryArray vector(vector_name);
+        REQUIRE(vector.rows() == 1);
+        REQUIRE(vector.cols() == 1);
+        REQUIRE(vector.is_one_dimensional());
+        REQUIRE(vector.data()[0] == values[0]);
+    }
+    std::remove(raw_name);
+    std::remove(npy_name);
+    std::remove(vector_name);
+}
+
+TEST_CASE("GradeDiscretizer sorts and merges values", "[InputManager]")
+{
+    GradeDiscretizer grades;
+    grades.add(rivet::numeric::SmallRational(1, 3), 0);
+    grades.add(2, 1);
+    grades.add(rivet::numeric::SmallRational(exact(1, 3)), 2);
+    grades.add(rivet::numeric::SmallRational(6004799503160661, 18014398509481984), 3); //the double closest to 1/3
+    std::vector<unsigned> more{ 4, 5 };
+    grades.add(-1, more.begin(), more.end());
+
+    std::vector<unsigned> indexes(6);
+    std::vector<exact> exact_grades;
+    grades.discretize(indexes, exact_grades, 0);
+
+    REQUIRE(exact_grades.size() == 4);
+    REQUIRE(exact_grades[0] == -1);
+    REQUIRE(exact_grades[1] == exact(6004799503160661, 18014398509481984));
+    REQUIRE(exact_grades[2] == exact(1, 3));
+    REQUIRE(exact_grades[3] == 2);
+    REQUIRE(indexes == std::vector<unsigned>({ 2, 3, 2, 1, 0, 0 }));
+
+    //two bins: (-1, 1/2] and (1/2, 2]
+    std::vector<exact> bins;
+    grades.discretize(indexes, bins, 2);
+    REQUIRE(bins == std::vector<exact>({ exact(1, 2), exact(2) }));
+    REQUIRE(indexes == std::vector<unsigned>({ 0, 1, 0, 0, 0, 0 }));
+
+    //two quantile bins: the three objects with the smallest values, up to the double closest to 1/3, and the other three
+    std::vector<exact> quantile_bins;
+    grades.discretize(indexes, quantile_bins, 2, true);
+    REQUIRE(quantile_bins == std::vector<exact>({ exact(6004799503160661, 18014398509481984), exact(2) }));
+    REQUIRE(indexes == std::vector<unsigned>({ 1, 1, 1, 0, 0, 0 }));
+
+    //values greater than 1 get no grade
+    std::vector<unsigned> bounded_indexes(6, 9);
+    std::vector<exact> bounded_grades;
+    grades.erase_greater(exact(1));
+    grades.discretize(bounded_indexes, bounded_grades, 0);
+    REQUIRE(bounded_grades.size() == 3);
+    REQUIRE(bounded_indexes == std::vector<unsigned>({ 2, 9, 2, 1, 0, 0 }));
+}
+
+TEST_CASE("NeighborGraph finds the pairs of points within a distance", "[InputManager]")
+{
+    //points on a 7 x 7 x 2 grid with spacing 1, with some repeated points
+    std::vector<double> coords;
+    for (int i = 0; i < 100; i++) {
+        int p = i % 98;
+        coords.push_back(p % 7);
+        coords.push_back((p / 7) % 7);
+        coords.push_back(p / 49);
+    }
+    unsigned num_points = coords.size() / 3;
+
+    NeighborGraph graph;
+    std::vector<double> distances;
+    graph.build(coords.data(), num_points, 3, 1.5, distances);
+    REQUIRE(graph.num_points() == num_points);
+    REQUIRE(distances.size() == graph.num_edges() + 1);
+    REQUIRE(distances[0] == 0);
+
+    //compare with all pairs of points
+    std::size_t e = graph.starts[0];
+    for (unsigned i = 0; i < num_points; i++) {
+        REQUIRE(graph.starts[i] == e);
+        for (unsigned j = i + 1; j < num_points; j++) {
+            double square = 0;
+            for (unsigned k = 0; k < 3; k++)
+                square += (coords[3 * i + k] - coords[3 * j + k]) * (coords[3 * i + k] - coords[3 * j + k]);
+            if (std::sqrt(square) <= 1.5) {
+                REQUIRE(graph.neighbors[e] == j);
+                REQUIRE(distances[e] == std::sqrt(square));
+                e++;
+            }
+        }
+    }
+    REQUIRE(graph.starts[num_points] == e);
+
+    //keep the edges of length at most 1, and intersect candidate lists
+    for (std::size_t f = 1; f < distances.size(); f++)
+        graph.dist_indexes[f] = distances[f] <= 1 ? (unsigned)distances[f] : 7;
+    graph.remove_edges(7);
+    std::vector<NeighborGraph::Candidate> candidates, common;
+    graph.candidates(0, candidates);
+    REQUIRE(candidates.size() == 5); //points 1, 7, 49, and the copies 98 and 99 of points 0 and 1
+    REQUIRE(candidates[3].vertex == 98);
+    REQUIRE(candidates[3].dist == 0);
+    graph.intersect(1, candidates.begin() + 1, candidates.end(), common);
+    REQUIRE(common.size() == 2);
+    REQUIRE(common[0].vertex == 98);
+    REQUIRE(common[0].dist == 1);
+    REQUIRE(common[1].vertex == 99);
+    REQUIRE(common[1].dist == 1);
+    REQUIRE(!graph.is_dense());
+}
+
+TEST_CASE("NeighborGraph intersects candidates with bitsets in dense graphs", "[InputManager]")
+{
+    //about half of the pairs of 150 points are at a defined distance
+    const unsigned num_points = 150;
+    const unsigned absent = 1000;
+    std::vector<unsigned> triangle(1, 0);
+    for (unsigned j = 1; j < num_points; j++)
+        for (unsigned i = 0; i < j; i++)
+            triangle.push_back((i * 7 + j * 13) % 5 < 2 ? absent : (i + j) % 11);
+
+    NeighborGraph graph;
+    graph.build(triangle, num_points, absent);
+    REQUIRE(graph.is_dense());
+
+    //the candidates common to vertices 0 and v are those at a defined distance from both
+    std::vector<NeighborGraph::Candidate> candidates, common;
+    graph.candidates(0, candidates);
+    for (unsigned v = 1; v < num_points; v++) {
+        auto first = std::upper_bound(candidates.begin(), candidates.end(), v,
+            [](unsigned v, const NeighborGraph::Candidate& c) { return v < c.vertex; });
+        graph.intersect(v, first, candidates.end(), common);
+        auto it = common.begin();
+        for (unsigned j = v + 1; j < num_points; j++) {
+            unsigned d0 = triangle[j * (j - 1) / 2 + 1], dv = triangle[j * (j - 1) / 2 + v + 1];
+            if (d0 != absent && dv != absent) {
+                REQUIRE(it != common.end());
+                REQUIRE(it->vertex == j);
+                REQUIRE(it->dist == std::max(d0, dv));
+                ++it;
+            }
+        }
+        REQUIRE(it == common.end());
+    }
+}
+
+TEST_CASE("SimplexEncoder numbers simplices and finds their faces", "[InputManager]")
+{
+    //the simplices with 4 vertices in [0, 9), in colex order, have indexes 0, 1, ..., C(9, 4) - 1
+    SimplexEncoder encoder(9, 4);
+    std::vector<Simplex> simplices;
+    for (int d = 3; d < 9; d++)
+        for (int c = 2; c < d; c++)
+            for (int b = 1; b < c; b++)
+                for (int a = 0; a < b; a++)
+                    simplices.push_back({ a, b, c, d });
+    REQUIRE(simplices.size() == 126);
+
+    for (unsigned i = 0; i < simplices.size(); i++) {
+        const Simplex& simplex = simplices[i];
+        REQUIRE((encoder.encode(simplex) == i)); //parenthesized, since Catch cannot print a SimplexIndex
+        REQUIRE(encoder.vertices(i, 4) == simplex);
+
+        SimplexIndex faces[4];
+        encoder.faces(i, 4, faces);
+        for (unsigned j = 0; j < 4; j++) {
+            Simplex face = simplex;
+            face.erase(face.begin() + j);
+            REQUIRE((faces[j] == encoder.encode(face)));
+        }
+    }
+
+    REQUIRE_THROWS_AS(SimplexEncoder(2000000, 7), std::runtime_error);
+}
+
+TEST_CASE("GreedyPermutation chooses the farthest points first", "[InputManager]")
+{
+    //points 0, 1, ..., 8 on a line, and a copy of point 8
+    std::vector<double> coords = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 8 };
+    unsigned num_points = coords.size();
+
+    GreedyPermutation permutation;
+    permutation.build(coords.data(), num_points, 1, 5);
+    REQUIRE(permutation.landmarks == std::vector<unsigned>({ 0, 8, 4, 2, 6 }));
+    REQUIRE(std::isinf(permutation.radii[0]));
+    REQUIRE(std::vector<double>(permutation.radii.begin() + 1, permutation.radii.end()) == std::vector<double>({ 8, 4, 2, 2 }));
+    REQUIRE(permutation.covering_radius == 1);
+    REQUIRE(permutation.sorted_landmarks() == std::vector<unsigned>({ 0, 2, 4, 6, 8 }));
+
+    //the same points given by the distances above the diagonal of their distance matrix
+    std::vector<double> distances;
+    for (unsigned i = 0; i < num_points; i++)
+        for (unsigned j = i + 1; j < num_points; j++)
+            distances.push_back(std::abs(coords[i] - coords[j]));
+    GreedyPermutation metric_permutation;
+    metric_permutation.build_metric(distances.data(), num_points, false, 5);
+    REQUIRE(metric_permutation.landmarks == permutation.landmarks);
+    REQUIRE(metric_permutation.covering_radius == 1);
+
+    //asking for more landmarks than points keeps all points, and the copy of point 8 comes last
+    permutation.build(coords.data(), num_points, 1, 20);
+    REQUIRE(permutation.landmarks.size() == num_points);
+    REQUIRE(permutation.landmarks.back() == 9);
+    REQUIRE(permutation.radii.back() == 0);
+    REQUIRE(permutation.covering_radius == 0);
+}
+
+TEST_CASE("Quantile bins hold about the same number of values", "[InputManager]")
+{
+    //values 1, 2, 3, 4 with weights 3, 1, 1, 5: the first bin ends where the weights reach 10 / 3, at value 2, and the last at value 4,
+    //  so there are only two grades
+    GradeDiscretizer grades;
+    grades.add_weighted(1, 0, 3);
+    grades.add_weighted(4, 1, 5);
+    grades.add_weighted(2, 2, 1);
+    grades.add_weighted(3, 3, 1);
+    std::vector<unsigned> indexes(4);
+    std::vector<exact> bins;
+    grades.discretize(indexes, bins, 3, true);
+    REQUIRE(bins == std::vector<exact>({ exact(2), exact(4) }));
+    REQUIRE(indexes == std::vector<unsigned>({ 0, 1, 0, 1 }));
+
+    //a sketch of few values has exact quantiles
+    QuantileSketch small;
+    for (int i = 0; i < 1000; i++)
+        small.add((i * 7919) % 1000);
+    REQUIRE(small.size() == 1000);
+    REQUIRE(small.quantiles(4) == std::vector<double>({ 249, 499, 749, 999 }));
+
+    //a sketch of many values has quantiles within a small fraction of the values of the exact ones
+    QuantileSketch sketch(256);
+    const int num_values = 1000000;
+    for (int i = 0; i < num_values; i++)
+        sketch.add((i * 7919LL) % num_values);
+    std::vector<double> quantiles = sketch.quantiles(10);
+    REQUIRE(quantiles.size() == 10);
+    for (int c = 1; c <= 10; c++)
+        REQUIRE(std::abs(quantiles[c - 1] - (c * num_values / 10 - 1)) < 0.02 * num_values);
+}
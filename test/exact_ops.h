@@ -32,3 +32,30 @@ TEST_CASE("Exact parser parses -10.8421", "[Exact]")
     exact v = rivet::numeric::str_to_exact("-10.8421");
     REQUIRE(v == exact(-108421, 10000));
 }
+
+TEST_CASE("SmallRational agrees with exact values", "[Exact]")
+{
+    using rivet::numeric::SmallRational;
+
+    std::vector<std::string> strs{ "12.34", "-765", "0.000", "-0.5e-3", "23.8e5", "60.31e-04", "1e", "-010",
+        "9223372036854775807", "92233720368547758070", "1.5e40", "0.1234567890123456789" };
+    for (const std::string& str : strs) {
+        exact value = rivet::numeric::str_to_exact(str);
+        SmallRational small;
+        if (SmallRational::parse(str.data(), str.data() + str.size(), small))
+            REQUIRE(small.to_exact() == value);
+        small = SmallRational(value);
+        REQUIRE(small.to_exact() == value);
+        REQUIRE(small.to_double() == numerator(value).convert_to<double>() / denominator(value).convert_to<double>());
+        REQUIRE((-small).to_exact() == -value);
+    }
+
+    //values that do not fit in 64 bits fall back to exact arithmetic
+    SmallRational huge(rivet::numeric::str_to_exact("92233720368547758070"));
+    REQUIRE(!huge.is_small());
+    REQUIRE(SmallRational(3, -6) == SmallRational(-1, 2));
+    REQUIRE(SmallRational(6004799503160661, 18014398509481984) < SmallRational(1, 3));
+    REQUIRE(SmallRational(-1, 2) < huge);
+    REQUIRE(SmallRational(9223372036854775807LL) < huge);
+    REQUIRE(SmallRational(exact(9223372036854775807LL) + 1) == -SmallRational(exact(-9223372036854775807LL) - 1));
+}
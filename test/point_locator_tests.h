@@ -0,0 +1,32 @@
+#include "catch.hpp"
+#include "dcel/point_locator.h"
+#include <vector>
+
+TEST_CASE("PointLocator finds faces on both sides of a crossing", "[PointLocator]")
+{
+    //lines y = x - 2 and y = -x cross at (1, -1)
+    //  faces: 0 above both lines, 1 below both lines, 2 between the lines left of the crossing, 3 between the lines right of the crossing
+    PointLocator locator;
+    locator.initialize({ 1, -1 }, { 2, 0 }, { 1, 2 }, 0);
+    locator.add_crossing(1, { { 0, 3 }, { 1, 1 } });
+    locator.build();
+
+    REQUIRE(locator.is_valid());
+    REQUIRE(locator.find_face(0.5, -1) == 2);
+    REQUIRE(locator.find_face(2, -1) == 3);
+    REQUIRE(locator.find_face(0.5, -3) == 1);
+    REQUIRE(locator.find_face(3, -5) == 1);
+    REQUIRE(locator.find_face(0.5, 5) == 0);
+    REQUIRE(locator.find_face(2, 0) == 0); //on the line y = x - 2, so in the face to its left
+}
+
+TEST_CASE("PointLocator rejects crossings of non-adjacent lines", "[PointLocator]")
+{
+    PointLocator locator;
+    locator.initialize({ 1, 2, 3 }, { 3, 2, 1 }, { 1, 2, 3 }, 0);
+    locator.add_crossing(1, { { 0, 4 }, { 2, 5 } });
+    locator.build();
+
+    REQUIRE(locator.is_built());
+    REQUIRE(!locator.is_valid());
+}
@@ -3,4 +3,5 @@
 #include "data_reader_tests.h"
 #include "exact_ops.h"
 #include "map_matrix_tests.h"
+#include "point_locator_tests.h"
 #include "serialization_tests.h"